@@ -0,0 +1,701 @@
+/*
+ *  Clipping
+ *
+ *  A layer on top of the drawing operations clips all primitives to the
+ *  current clip rectangle, so applications can draw partially (or
+ *  completely) off-screen. Coordinates are interpreted as signed integers,
+ *  hence a primitive may start left of or above the screen.
+ *
+ *  Each primitive is checked once on entry. Fully visible primitives are
+ *  passed unmodified to the layer below, so they don't suffer from any
+ *  per-pixel checks. Rectangles, bitmaps and pixmaps are intersected with the
+ *  clip rectangle. Lines are accepted or rejected using Cohen-Sutherland
+ *  outcodes, and of the other lines only the visible runs are drawn.
+ *  Partially visible circles and ellipses are drawn using clipped pixels and
+ *  spans.
+ *
+ *  The clip rectangle is the intersection of the screen (or the back buffer
+ *  when page flipping) and all rectangles pushed using clip_push().
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "clip.h"
+#include "dlist.h"
+#include "rotate.h"
+#include "util.h"
+
+
+#define CLIP_STACK_DEPTH	16
+#define CLIP_SPANS		64
+
+struct clip_rect {
+    int x0, y0, x1, y1;		/* x1 and y1 are exclusive */
+};
+
+    /*
+     *  Clip state, per frame buffer context
+     */
+
+struct clip {
+    struct clip_rect screen;
+    struct clip_rect stack[CLIP_STACK_DEPTH];
+    u32 depth;
+    struct clip_rect cur;
+    struct drawops below;
+    struct drawops clipped;	/* clipped frame buffer level operations */
+    struct drawops *fbops;
+};
+
+#define clip_screen	(fb_current->clip->screen)
+#define clip_stack	(fb_current->clip->stack)
+#define clip_depth	(fb_current->clip->depth)
+#define clip_x0		(fb_current->clip->cur.x0)
+#define clip_y0		(fb_current->clip->cur.y0)
+#define clip_x1		(fb_current->clip->cur.x1)
+#define clip_y1		(fb_current->clip->cur.y1)
+#define clip_below	(fb_current->clip->below)
+
+
+static void clip_intersect(struct clip_rect *r, const struct clip_rect *s)
+{
+    r->x0 = max(r->x0, s->x0);
+    r->y0 = max(r->y0, s->y0);
+    r->x1 = min(r->x1, s->x1);
+    r->y1 = min(r->y1, s->y1);
+}
+
+static void clip_update(void)
+{
+    struct clip *clip = fb_current->clip;
+    u32 i;
+
+    clip->cur = clip->screen;
+    for (i = 0; i < clip->depth; i++)
+	clip_intersect(&clip->cur, &clip->stack[i]);
+}
+
+
+    /*
+     *  Clip rectangle
+     */
+
+void clip_set_screen(u32 width, u32 height)
+{
+    if (!fb_current->clip)
+	return;
+
+    dlist_submit();
+    clip_screen.x1 = width;
+    clip_screen.y1 = height;
+    clip_update();
+}
+
+void clip_push(int x, int y, int width, int height)
+{
+    struct clip_rect *r;
+
+    if (!fb_current->clip)
+	return;
+    if (clip_depth == CLIP_STACK_DEPTH)
+	Fatal("Clip stack overflow\n");
+
+    dlist_submit();
+    rotate_map_rect(&x, &y, &width, &height);
+    r = &clip_stack[clip_depth++];
+    r->x0 = x;
+    r->y0 = y;
+    r->x1 = x+width;
+    r->y1 = y+height;
+    clip_intersect(&fb_current->clip->cur, r);
+}
+
+void clip_pop(void)
+{
+    if (!fb_current->clip)
+	return;
+    if (!clip_depth)
+	Fatal("Clip stack underflow\n");
+
+    dlist_submit();
+    clip_depth--;
+    clip_update();
+}
+
+
+    /*
+     *  Intersect a rectangle with the clip rectangle
+     *
+     *  Returns 0 if nothing is visible. dx and dy are set to the number of
+     *  pixels clipped at the left and top.
+     */
+
+static inline int clip_rect(int *x, int *y, int *width, int *height, int *dx,
+			    int *dy)
+{
+    int x1 = *x+*width, y1 = *y+*height;
+
+    *dx = max(clip_x0-*x, 0);
+    *dy = max(clip_y0-*y, 0);
+    *x += *dx;
+    *y += *dy;
+    *width = min(x1, clip_x1)-*x;
+    *height = min(y1, clip_y1)-*y;
+    return *width > 0 && *height > 0;
+}
+
+static inline int clip_point(int x, int y)
+{
+    return x >= clip_x0 && x < clip_x1 && y >= clip_y0 && y < clip_y1;
+}
+
+static inline int clip_inside(int x, int y, int width, int height)
+{
+    return x >= clip_x0 && y >= clip_y0 && x+width <= clip_x1 &&
+	   y+height <= clip_y1;
+}
+
+
+    /*
+     *  Clipped frame buffer level operations
+     *
+     *  Partially visible circles and ellipses are drawn by the generic
+     *  routines, which draw using the frame buffer level operations. While
+     *  they run, the pixels and spans they draw are clipped by temporarily
+     *  replacing the frame buffer level operations.
+     */
+
+static void clip_fb_set_pixel(u32 x, u32 y, pixel_t pixel)
+{
+    if (clip_point(x, y))
+	(fb_current->clip->fbops->set_pixel)(x, y, pixel);
+}
+
+static void clip_fb_draw_hline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    int x0 = x, y0 = y, len = length, height = 1, dx, dy;
+
+    if (clip_rect(&x0, &y0, &len, &height, &dx, &dy))
+	(fb_current->clip->fbops->draw_hline)(x0, y0, len, pixel);
+}
+
+static void clip_fb_draw_vline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    int x0 = x, y0 = y, len = length, width = 1, dx, dy;
+
+    if (clip_rect(&x0, &y0, &width, &len, &dx, &dy))
+	(fb_current->clip->fbops->draw_vline)(x0, y0, len, pixel);
+}
+
+static void clip_generic_begin(void)
+{
+    struct clip *clip = fb_current->clip;
+
+    clip->fbops = fb_current->fbops;
+    clip->clipped = *clip->fbops;
+    clip->clipped.set_pixel = clip_fb_set_pixel;
+    clip->clipped.draw_hline = clip_fb_draw_hline;
+    clip->clipped.draw_vline = clip_fb_draw_vline;
+    clip->clipped.fill_spans = generic_fill_spans;
+    clip->clipped.draw_circle = generic_draw_circle;
+    clip->clipped.fill_circle = generic_fill_circle;
+    fb_current->fbops = &clip->clipped;
+}
+
+static void clip_generic_end(void)
+{
+    fb_current->fbops = fb_current->clip->fbops;
+}
+
+
+    /*
+     *  Cohen-Sutherland outcodes
+     */
+
+#define OUT_LEFT	1
+#define OUT_RIGHT	2
+#define OUT_TOP		4
+#define OUT_BOTTOM	8
+
+static inline int clip_outcode(int x, int y)
+{
+    int code = 0;
+
+    if (x < clip_x0)
+	code |= OUT_LEFT;
+    else if (x >= clip_x1)
+	code |= OUT_RIGHT;
+    if (y < clip_y0)
+	code |= OUT_TOP;
+    else if (y >= clip_y1)
+	code |= OUT_BOTTOM;
+    return code;
+}
+
+
+    /*
+     *  Drawing operations layer
+     */
+
+static void clip_set_pixel(u32 x, u32 y, pixel_t pixel)
+{
+    if (clip_point(x, y))
+	(clip_below.set_pixel)(x, y, pixel);
+}
+
+static pixel_t clip_get_pixel(u32 x, u32 y)
+{
+    if (clip_point(x, y))
+	return (clip_below.get_pixel)(x, y);
+    return 0;
+}
+
+static void clip_draw_hline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    int x0 = x, y0 = y, len = length, height = 1, dx, dy;
+
+    if (clip_rect(&x0, &y0, &len, &height, &dx, &dy))
+	(clip_below.draw_hline)(x0, y0, len, pixel);
+}
+
+static void clip_draw_vline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    int x0 = x, y0 = y, len = length, width = 1, dx, dy;
+
+    if (clip_rect(&x0, &y0, &width, &len, &dx, &dy))
+	(clip_below.draw_vline)(x0, y0, len, pixel);
+}
+
+static void clip_draw_rect(u32 x, u32 y, u32 width, u32 height,
+			   pixel_t pixel)
+{
+    /* The top line is drawn even if height is zero */
+    if (clip_inside(x, y, width, max(height, 1U))) {
+	(clip_below.draw_rect)(x, y, width, height, pixel);
+	return;
+    }
+
+    clip_draw_hline(x, y, width, pixel);
+    if (height >= 1) {
+	if (height >= 2) {
+	    clip_draw_vline(x, y+1, height-2, pixel);
+	    if (width >= 1)
+		clip_draw_vline(x+width-1, y+1, height-2, pixel);
+	}
+	clip_draw_hline(x, y+height-1, width, pixel);
+    }
+}
+
+static void clip_fill_rect(u32 x, u32 y, u32 width, u32 height,
+			   pixel_t pixel)
+{
+    int x0 = x, y0 = y, w = width, h = height, dx, dy;
+
+    if (clip_rect(&x0, &y0, &w, &h, &dx, &dy))
+	(clip_below.fill_rect)(x0, y0, w, h, pixel);
+}
+
+static void clip_fill_spans(const struct span *spans, u32 num, pixel_t pixel)
+{
+    struct span clipped[CLIP_SPANS];
+    int x0, y0, len, height, dx, dy;
+    u32 i, n;
+
+    for (i = 0; i < num; i++)
+	if (!clip_inside(spans[i].x, spans[i].y, spans[i].length, 1))
+	    break;
+    if (i == num) {
+	(clip_below.fill_spans)(spans, num, pixel);
+	return;
+    }
+
+    for (i = 0, n = 0; i < num; i++) {
+	x0 = spans[i].x;
+	y0 = spans[i].y;
+	len = spans[i].length;
+	height = 1;
+	if (!clip_rect(&x0, &y0, &len, &height, &dx, &dy))
+	    continue;
+	if (n == CLIP_SPANS) {
+	    (clip_below.fill_spans)(clipped, n, pixel);
+	    n = 0;
+	}
+	clipped[n].x = x0;
+	clipped[n].y = y0;
+	clipped[n].length = len;
+	n++;
+    }
+    if (n)
+	(clip_below.fill_spans)(clipped, n, pixel);
+}
+
+    /*
+     *  Floor and ceiling of num/den, for den > 0
+     */
+
+static inline long long clip_div_floor(long long num, long long den)
+{
+    return num >= 0 ? num/den : -((den-1-num)/den);
+}
+
+static inline long long clip_div_ceil(long long num, long long den)
+{
+    return -clip_div_floor(-num, den);
+}
+
+    /*
+     *  Draw the visible part of a sloped line, with the same pixels as
+     *  generic_draw_line() draws for the whole line
+     *
+     *  For major > 1, pixel i along the major axis is at offset
+     *  m(i) = floor((i*minor-major/2)/major)+1 along the minor axis. Both are
+     *  monotonic, so the visible pixels are a single range of i, which
+     *  follows directly from the clip rectangle. Its runs are drawn like in
+     *  generic_draw_line(), starting with the error term of the first visible
+     *  run.
+     */
+
+static void clip_draw_line_part(int x1, int y1, int x2, int y2,
+				pixel_t pixel)
+{
+    long long dx = (long long)x2-x1, dy = (long long)y2-y1;
+    long long major, minor, h, q, r, i, i0, i1, m, m0, m1, c, rem, next;
+    int xmajor = llabs(dx) > llabs(dy), a, b, sa, sb, a0, a1, b0, b1;
+
+    if (xmajor) {
+	a = x1;
+	b = y1;
+	sa = dx < 0 ? -1 : 1;
+	sb = dy < 0 ? -1 : 1;
+	major = llabs(dx);
+	minor = llabs(dy);
+	a0 = clip_x0;
+	a1 = clip_x1-1;
+	b0 = clip_y0;
+	b1 = clip_y1-1;
+    } else {
+	a = y1;
+	b = x1;
+	sa = dy < 0 ? -1 : 1;
+	sb = dx < 0 ? -1 : 1;
+	major = llabs(dy);
+	minor = llabs(dx);
+	a0 = clip_y0;
+	a1 = clip_y1-1;
+	b0 = clip_x0;
+	b1 = clip_x1-1;
+    }
+
+    /* A diagonal step: m(0) is 0, not 1 */
+    if (major == 1) {
+	clip_set_pixel(x1, y1, pixel);
+	clip_set_pixel(x2, y2, pixel);
+	return;
+    }
+
+    /* Visible pixels along the major axis, and offsets along the minor one */
+    i0 = sa > 0 ? (long long)a0-a : (long long)a-a1;
+    i1 = sa > 0 ? (long long)a1-a : (long long)a-a0;
+    m0 = sb > 0 ? (long long)b0-b : (long long)b-b1;
+    m1 = sb > 0 ? (long long)b1-b : (long long)b-b0;
+    h = major/2;
+    i0 = max(i0, max(0LL, clip_div_ceil((m0-1)*major+h, minor)));
+    i1 = min(i1, min(major, clip_div_floor(m1*major+h-1, minor)));
+    if (i0 > i1)
+	return;
+
+    /* c is the start of the next run, and rem = c*minor-(m*major+h) */
+    m = clip_div_floor(i0*minor-h, major)+1;
+    c = clip_div_ceil(m*major+h, minor);
+    rem = c*minor-(m*major+h);
+    q = major/minor;
+    r = major%minor;
+    for (i = i0; i <= i1; i = next, m++) {
+	next = min(c, i1+1);
+	if (xmajor)
+	    (clip_below.draw_hline)(sa > 0 ? a+i : a-next+1, b+sb*m, next-i,
+				    pixel);
+	else
+	    (clip_below.draw_vline)(b+sb*m, sa > 0 ? a+i : a-next+1, next-i,
+				    pixel);
+	c += q;
+	if (r > rem) {
+	    c++;
+	    rem += minor-r;
+	} else {
+	    rem -= r;
+	}
+    }
+}
+
+static void clip_draw_line(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel)
+{
+    int code1 = clip_outcode(x1, y1), code2 = clip_outcode(x2, y2);
+
+    if (code1 & code2)
+	return;
+
+    if (!(code1 | code2)) {
+	(clip_below.draw_line)(x1, y1, x2, y2, pixel);
+	return;
+    }
+
+    /*
+     *  A line between the clipped end points would have a slightly different
+     *  slope, and wouldn't join seamlessly with the other parts of the same
+     *  line drawn using another clip rectangle
+     */
+    if (y1 == y2)
+	clip_draw_hline(min((int)x1, (int)x2), y1, abs((int)x2-(int)x1)+1,
+			pixel);
+    else if (x1 == x2)
+	clip_draw_vline(x1, min((int)y1, (int)y2), abs((int)y2-(int)y1)+1,
+			pixel);
+    else
+	clip_draw_line_part(x1, y1, x2, y2, pixel);
+}
+
+static void clip_expand_bitmap(u32 x, u32 y, u32 width, u32 height,
+			       const u8 *data, u32 pitch, pixel_t pixel0,
+			       pixel_t pixel1)
+{
+    int x0 = x, y0 = y, w = width, h = height, dx, dy, i, j, n;
+    const u8 *line;
+
+    if (!clip_rect(&x0, &y0, &w, &h, &dx, &dy))
+	return;
+
+    data += dy*pitch+dx/8;
+    dx %= 8;
+    if (dx) {
+	/* Bitmap lines must start on a byte boundary */
+	n = min(8-dx, w);
+	for (i = 0, line = data; i < h; i++, line += pitch)
+	    for (j = 0; j < n; j++)
+		(clip_below.set_pixel)(x0+j, y0+i,
+				       *line & (0x80 >> (dx+j)) ? pixel1
+								: pixel0);
+	x0 += n;
+	w -= n;
+	data++;
+	if (!w)
+	    return;
+    }
+    (clip_below.expand_bitmap)(x0, y0, w, h, data, pitch, pixel0, pixel1);
+}
+
+static void clip_draw_pixmap(u32 x, u32 y, u32 width, u32 height,
+			     const pixel_t *pixmap)
+{
+    int x0 = x, y0 = y, w = width, h = height, dx, dy;
+
+    if (!clip_rect(&x0, &y0, &w, &h, &dx, &dy))
+	return;
+
+    pixmap += dy*width+dx;
+    if ((u32)w == width) {
+	(clip_below.draw_pixmap)(x0, y0, w, h, pixmap);
+	return;
+    }
+
+    /* Pixmap lines must be contiguous */
+    for (; h--; y0++, pixmap += width)
+	(clip_below.draw_pixmap)(x0, y0, w, 1, pixmap);
+}
+
+static void clip_draw_chunky(u32 x, u32 y, u32 width, u32 height,
+			     const u8 *data, u32 pitch)
+{
+    int x0 = x, y0 = y, w = width, h = height, dx, dy;
+
+    if (clip_rect(&x0, &y0, &w, &h, &dx, &dy))
+	(clip_below.draw_chunky)(x0, y0, w, h, data+dy*pitch+dx, pitch);
+}
+
+static void clip_draw_circle(u32 x, u32 y, u32 r, pixel_t pixel)
+{
+    if (clip_inside((int)x-(int)r, (int)y-(int)r, 2*r+1, 2*r+1)) {
+	(clip_below.draw_circle)(x, y, r, pixel);
+    } else {
+	clip_generic_begin();
+	generic_draw_circle(x, y, r, pixel);
+	clip_generic_end();
+    }
+}
+
+static void clip_fill_circle(u32 x, u32 y, u32 r, pixel_t pixel)
+{
+    if (clip_inside((int)x-(int)r, (int)y-(int)r, 2*r+1, 2*r+1)) {
+	(clip_below.fill_circle)(x, y, r, pixel);
+    } else {
+	clip_generic_begin();
+	generic_fill_circle(x, y, r, pixel);
+	clip_generic_end();
+    }
+}
+
+static void clip_draw_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
+{
+    if (clip_inside((int)x-(int)a, (int)y-(int)b, 2*a+1, 2*b+1)) {
+	(clip_below.draw_ellipse)(x, y, a, b, pixel);
+    } else {
+	clip_generic_begin();
+	generic_draw_ellipse(x, y, a, b, pixel);
+	clip_generic_end();
+    }
+}
+
+static void clip_fill_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
+{
+    if (clip_inside((int)x-(int)a, (int)y-(int)b, 2*a+1, 2*b+1)) {
+	(clip_below.fill_ellipse)(x, y, a, b, pixel);
+    } else {
+	clip_generic_begin();
+	generic_fill_ellipse(x, y, a, b, pixel);
+	clip_generic_end();
+    }
+}
+
+    /*
+     *  The destination is clipped to the clip rectangle, the source to the
+     *  screen
+     */
+
+static void clip_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx,
+			   u32 sy)
+{
+    struct clip_rect cur = fb_current->clip->cur;
+    int x0 = dx, y0 = dy, sx0 = sx, sy0 = sy, w = width, h = height;
+    int cx, cy;
+
+    if (!clip_rect(&x0, &y0, &w, &h, &cx, &cy))
+	return;
+    sx0 += cx;
+    sy0 += cy;
+
+    fb_current->clip->cur = clip_screen;
+    if (clip_rect(&sx0, &sy0, &w, &h, &cx, &cy))
+	(clip_below.copy_rect)(x0+cx, y0+cy, w, h, sx0, sy0);
+    fb_current->clip->cur = cur;
+}
+
+static void clip_fill_polygon(const struct point *points, u32 num,
+			      enum fill_rule rule, pixel_t pixel)
+{
+    int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+    u32 i;
+
+    for (i = 0; i < num; i++) {
+	x0 = min(x0, (int)points[i].x);
+	x1 = max(x1, (int)points[i].x);
+	y0 = min(y0, (int)points[i].y);
+	y1 = max(y1, (int)points[i].y);
+    }
+    if (clip_inside(x0, y0, x1-x0, y1-y0)) {
+	(clip_below.fill_polygon)(points, num, rule, pixel);
+    } else {
+	clip_generic_begin();
+	generic_fill_polygon(points, num, rule, pixel);
+	clip_generic_end();
+    }
+}
+
+static void clip_blend_rect(u32 x, u32 y, u32 width, u32 height, u32 argb)
+{
+    int x0 = x, y0 = y, w = width, h = height, dx, dy;
+
+    if (clip_rect(&x0, &y0, &w, &h, &dx, &dy))
+	(clip_below.blend_rect)(x0, y0, w, h, argb);
+}
+
+static void clip_blend_pixmap(u32 x, u32 y, u32 width, u32 height,
+			      const u32 *argb)
+{
+    int x0 = x, y0 = y, w = width, h = height, dx, dy;
+
+    if (!clip_rect(&x0, &y0, &w, &h, &dx, &dy))
+	return;
+
+    argb += dy*width+dx;
+    if ((u32)w == width) {
+	(clip_below.blend_pixmap)(x0, y0, w, h, argb);
+	return;
+    }
+
+    /* Pixmap lines must be contiguous */
+    for (; h--; y0++, argb += width)
+	(clip_below.blend_pixmap)(x0, y0, w, 1, argb);
+}
+
+static const struct drawops clip_drawops = {
+    .name =		"clip",
+    .set_pixel =	clip_set_pixel,
+    .get_pixel =	clip_get_pixel,
+    .draw_hline =	clip_draw_hline,
+    .draw_vline =	clip_draw_vline,
+    .draw_rect =	clip_draw_rect,
+    .fill_rect =	clip_fill_rect,
+    .fill_spans =	clip_fill_spans,
+    .draw_line =	clip_draw_line,
+    .expand_bitmap =	clip_expand_bitmap,
+    .draw_pixmap =	clip_draw_pixmap,
+    .draw_chunky =	clip_draw_chunky,
+    .draw_circle =	clip_draw_circle,
+    .fill_circle =	clip_fill_circle,
+    .draw_ellipse =	clip_draw_ellipse,
+    .fill_ellipse =	clip_fill_ellipse,
+    .copy_rect =	clip_copy_rect,
+    .fill_polygon =	clip_fill_polygon,
+    .blend_rect =	clip_blend_rect,
+    .blend_pixmap =	clip_blend_pixmap,
+};
+
+
+    /*
+     *  Initialization
+     */
+
+void clip_init(void)
+{
+    struct clip *clip;
+
+    Debug("clip_init()\n");
+    if (fb_current->clip)
+	return;
+
+    if (!(clip = calloc(1, sizeof(*clip))))
+	Fatal("calloc %zu: %s\n", sizeof(*clip), strerror(errno));
+    clip->screen.x1 = fb_var.xres_virtual;
+    clip->screen.y1 = fb_var.yres_virtual;
+    clip->cur = clip->screen;
+    fb_current->clip = clip;
+    drawops_push_layer(&clip_drawops, &clip_below);
+}
+
+
+    /*
+     *  Clean up
+     */
+
+void clip_cleanup(void)
+{
+    struct clip *clip = fb_current->clip;
+
+    if (!clip)
+	return;
+
+    Debug("clip_cleanup()\n");
+    drawops_pop_layer(&clip->below);
+    fb_current->clip = NULL;
+    free(clip);
+}
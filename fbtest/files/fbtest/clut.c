@@ -12,6 +12,7 @@
 #include <string.h>
 
 #include "types.h"
+#include "fb.h"
 #include "visual.h"
 #include "util.h"
 
@@ -90,7 +91,7 @@ const rgba_t clut_windows[4] = {
      *  Create a color cube
      */
 
-void clut_create_rgbcube(rgba_t *clut, u32 rlen, u32 glen, u32 blen)
+void clut_create_rgbcube(rgba_t *table, u32 rlen, u32 glen, u32 blen)
 {
     u32 r, g, b;
     u16 red, green, blue;
@@ -102,11 +103,11 @@ void clut_create_rgbcube(rgba_t *clut, u32 rlen, u32 glen, u32 blen)
 	    green = EXPAND_TO_16BIT(g, glen-1);
 	    for (b = 0; b < blen; b++) {
 		blue = EXPAND_TO_16BIT(b, blen-1);
-		clut->r = red;
-		clut->g = green;
-		clut->b = blue;
-		clut->a = 0xffff;
-		clut++;
+		table->r = red;
+		table->g = green;
+		table->b = blue;
+		table->a = 0xffff;
+		table++;
 	    }
 	}
     }
@@ -117,7 +118,7 @@ void clut_create_rgbcube(rgba_t *clut, u32 rlen, u32 glen, u32 blen)
      *  Create a linear ramp
      */
 
-void clut_create_linear(rgba_t *clut, u32 len)
+void clut_create_linear(rgba_t *table, u32 len)
 {
     u32 i;
     u16 gray;
@@ -125,11 +126,11 @@ void clut_create_linear(rgba_t *clut, u32 len)
     Debug("clut_create_linear(): GRAY %d\n", len);
     for (i = 0; i < len; i++) {
 	gray = EXPAND_TO_16BIT(i, len-1);
-	clut->r = gray;
-	clut->g = gray;
-	clut->b = gray;
-	clut->a = 0xffff;
-	clut++;
+	table->r = gray;
+	table->g = gray;
+	table->b = gray;
+	table->a = 0xffff;
+	table++;
     }
 }
 
@@ -140,33 +141,35 @@ void clut_create_linear(rgba_t *clut, u32 len)
 
 void clut_init_nice(void)
 {
-    if (idx_len >= 512) {
-	clut_create_rgbcube(clut, 8, 8, 8);
-    } else if (idx_len >= 256) {
-	memcpy(clut, clut_console, sizeof(clut_console));
+    struct fb_context *ctx = fb_current;
+
+    if (ctx->idx_len >= 512) {
+	clut_create_rgbcube(ctx->clut, 8, 8, 8);
+    } else if (ctx->idx_len >= 256) {
+	memcpy(ctx->clut, clut_console, sizeof(clut_console));
 	/* FIXME: skip colors that are already present */
-	clut_create_rgbcube(clut+16, 6, 6, 6);
+	clut_create_rgbcube(ctx->clut+16, 6, 6, 6);
 	/* FIXME: skip colors that are already present */
-	clut_create_linear(clut+232, 24);
-    } else if (idx_len >= 128) {
-	memcpy(clut, clut_console, sizeof(clut_console));
+	clut_create_linear(ctx->clut+232, 24);
+    } else if (ctx->idx_len >= 128) {
+	memcpy(ctx->clut, clut_console, sizeof(clut_console));
 	/* FIXME: skip colors that are already present */
-	clut_create_rgbcube(clut+16, 4, 4, 4);
+	clut_create_rgbcube(ctx->clut+16, 4, 4, 4);
 	/* FIXME: skip colors that are already present */
-	clut_create_linear(clut+80, 48);
-    } else if (idx_len >= 64) {
-	clut_create_rgbcube(clut, 4, 4, 4);
-    } else if (idx_len >= 32) {
-	clut_create_rgbcube(clut, 3, 3, 3);
+	clut_create_linear(ctx->clut+80, 48);
+    } else if (ctx->idx_len >= 64) {
+	clut_create_rgbcube(ctx->clut, 4, 4, 4);
+    } else if (ctx->idx_len >= 32) {
+	clut_create_rgbcube(ctx->clut, 3, 3, 3);
 	/* FIXME: still 3 entries left */
-    } else if (idx_len >= 16) {
-	memcpy(clut, clut_console, sizeof(clut_console));
-    } else if (idx_len >= 8) {
-	memcpy(clut, clut_console, 8*sizeof(rgba_t));
-    } else if (idx_len >= 4) {
-	clut_create_linear(clut, 4);
-    } else if (idx_len >= 2) {
-	memcpy(clut, clut_mono, sizeof(clut_mono));
+    } else if (ctx->idx_len >= 16) {
+	memcpy(ctx->clut, clut_console, sizeof(clut_console));
+    } else if (ctx->idx_len >= 8) {
+	memcpy(ctx->clut, clut_console, 8*sizeof(rgba_t));
+    } else if (ctx->idx_len >= 4) {
+	clut_create_linear(ctx->clut, 4);
+    } else if (ctx->idx_len >= 2) {
+	memcpy(ctx->clut, clut_mono, sizeof(clut_mono));
     }
 
     clut_update();
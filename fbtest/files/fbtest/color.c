@@ -821,14 +821,14 @@ void color_sub(rgba_t *a, const rgba_t *b, const rgba_t *c)
      *  Find the index of the closest color in a CLUT
      */
 
-u32 color_find(const rgba_t *color, const rgba_t *clut, u32 clut_size)
+u32 color_find(const rgba_t *color, const rgba_t *table, u32 size)
 {
     u32 idx, best_idx, error, best_error;
 
     best_idx = 0;
-    best_error = color_error(&clut[0], color);
-    for (idx = 1; idx < clut_size; idx++) {
-	error = color_error(&clut[idx], color);
+    best_error = color_error(&table[0], color);
+    for (idx = 1; idx < size; idx++) {
+	error = color_error(&table[idx], color);
 	if (error < best_error) {
 	    best_idx = idx;
 	    best_error = error;
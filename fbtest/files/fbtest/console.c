@@ -25,17 +25,22 @@
 #define PRINTF_BUFFER_SIZE	1024
 #define BITMAP_SIZE		1024
 
-static char printf_buffer[PRINTF_BUFFER_SIZE];
 
-static const struct font *con_font;
-static unsigned int con_pitch, con_charsize;
-static unsigned int con_cols, con_rows;
-static unsigned int con_x, con_y;
-static pixel_t con_fgcolor, con_bgcolor;
+    /*
+     *  Console state is per thread, each thread draws to its own context
+     */
 
-static unsigned char bitmap[BITMAP_SIZE];
-static unsigned int bitmap_width, bitmap_pitch, bitmap_max_width;
-static unsigned int bitmap_x;
+static __thread char printf_buffer[PRINTF_BUFFER_SIZE];
+
+static __thread const struct font *con_font;
+static __thread unsigned int con_pitch, con_charsize;
+static __thread unsigned int con_cols, con_rows;
+static __thread unsigned int con_x, con_y;
+static __thread pixel_t con_fgcolor, con_bgcolor;
+
+static __thread unsigned char bitmap[BITMAP_SIZE];
+static __thread unsigned int bitmap_width, bitmap_pitch, bitmap_max_width;
+static __thread unsigned int bitmap_x;
 
 static void con_flush(void)
 {
@@ -60,8 +65,8 @@ static void con_reset(void)
 
     con_x = 0;
     con_y = 0;
-    con_fgcolor = idx_pixel[7];
-    con_bgcolor = idx_pixel[0];
+    con_fgcolor = fb_current->idx_pixel[7];
+    con_bgcolor = fb_current->idx_pixel[0];
 
     con_clear();
 }
@@ -91,7 +96,7 @@ void con_init(const struct font *font)
     con_rows = fb_var.yres/font->height;
 
     for (i = 0; i < 16; i++)
-	clut[i] = clut_console[i];
+	fb_current->clut[i] = clut_console[i];
     clut_update();
 
     bitmap_pitch = (sizeof(bitmap)/(font->height*sizeof(unsigned long)))*
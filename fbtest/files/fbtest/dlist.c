@@ -0,0 +1,635 @@
+/*
+ *  Display lists
+ *
+ *  Between dlist_begin() and dlist_end(), a layer on top of the drawing
+ *  operations records all primitives in a display list, instead of drawing
+ *  them immediately. On submit, the commands are sorted into bands of
+ *  DLIST_BAND_HEIGHT lines, keeping their order within each band, and the
+ *  bands are drawn one after the other. Hence each part of the frame buffer
+ *  is drawn while it's hot in the cache, instead of all over the screen for
+ *  every primitive.
+ *
+ *  Commands covering more than one band are drawn in each of them, clipped
+ *  to the band, so this needs the clipping layer.
+ *
+ *  Operations that read from the frame buffer (get_pixel and copy_rect)
+ *  submit the pending commands, and are executed immediately. So does
+ *  changing the clip rectangle. Bitmaps and pixmaps are copied, so the
+ *  caller may reuse them.
+ *
+ *  On a rotated display, commands are recorded in logical coordinates, so
+ *  the bands are logical lines too.
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "clip.h"
+#include "dlist.h"
+#include "rotate.h"
+#include "util.h"
+
+
+#define DLIST_BAND_HEIGHT	64	/* lines */
+
+enum dlist_op {
+    DL_SET_PIXEL,
+    DL_DRAW_HLINE,
+    DL_DRAW_VLINE,
+    DL_DRAW_RECT,
+    DL_FILL_RECT,
+    DL_FILL_SPANS,
+    DL_DRAW_LINE,
+    DL_EXPAND_BITMAP,
+    DL_DRAW_PIXMAP,
+    DL_DRAW_CHUNKY,
+    DL_DRAW_CIRCLE,
+    DL_FILL_CIRCLE,
+    DL_DRAW_ELLIPSE,
+    DL_FILL_ELLIPSE,
+    DL_FILL_POLYGON,
+    DL_BLEND_RECT,
+    DL_BLEND_PIXMAP,
+};
+
+struct dlist_cmd {
+    u32 op;
+    u32 x, y, a, b;		/* position and size, or end point */
+    pixel_t pixel0, pixel1;
+    u32 data, pitch;		/* offset of bitmap or pixmap data */
+    int y0, y1;			/* lines covered */
+};
+
+    /*
+     *  Display list state, per frame buffer context
+     */
+
+struct dlist {
+    struct dlist_cmd *cmds;
+    u32 num_cmds, max_cmds;
+    u8 *data;
+    u32 data_len, data_max;
+    u32 *bins, *first;		/* command indices, sorted per band */
+    u32 max_bins, max_bands;
+    int recording, executing;
+    struct drawops below;
+};
+
+#define dlist_below	(fb_current->dlist->below)
+
+
+    /*
+     *  Size of the screen the commands are recorded for
+     */
+
+static u32 dlist_xres(void)
+{
+    return fb_current->rotate ? rotate_xres() : fb_var.xres_virtual;
+}
+
+static u32 dlist_yres(void)
+{
+    return fb_current->rotate ? rotate_yres() : fb_var.yres_virtual;
+}
+
+
+static void *dlist_grow(void *p, u32 *max, u32 min, size_t size)
+{
+    u32 n = *max ? *max : 64;
+
+    while (n < min)
+	n *= 2;
+    if (n == *max)
+	return p;
+    if (!(p = realloc(p, n*size)))
+	Fatal("realloc %zu: %s\n", n*size, strerror(errno));
+    *max = n;
+    return p;
+}
+
+static struct dlist_cmd *dlist_add(u32 op, int y0, int y1)
+{
+    struct dlist *dlist = fb_current->dlist;
+    struct dlist_cmd *cmd;
+
+    if (dlist->num_cmds == dlist->max_cmds)
+	dlist->cmds = dlist_grow(dlist->cmds, &dlist->max_cmds,
+				 dlist->num_cmds+1, sizeof(*dlist->cmds));
+    cmd = &dlist->cmds[dlist->num_cmds++];
+    cmd->op = op;
+    cmd->y0 = y0;
+    cmd->y1 = y1;
+    return cmd;
+}
+
+static u32 dlist_add_data(const void *src, u32 len)
+{
+    struct dlist *dlist = fb_current->dlist;
+    u32 offset = dlist->data_len;
+
+    if (offset+len > dlist->data_max)
+	dlist->data = dlist_grow(dlist->data, &dlist->data_max, offset+len, 1);
+    memcpy(dlist->data+offset, src, len);
+    /* Keep pixmaps aligned */
+    dlist->data_len += (len+sizeof(pixel_t)-1) & ~(sizeof(pixel_t)-1);
+    return offset;
+}
+
+
+    /*
+     *  Execute a command
+     */
+
+static void dlist_exec(const struct dlist_cmd *cmd, const u8 *data)
+{
+    switch (cmd->op) {
+	case DL_SET_PIXEL:
+	    (dlist_below.set_pixel)(cmd->x, cmd->y, cmd->pixel0);
+	    break;
+
+	case DL_DRAW_HLINE:
+	    (dlist_below.draw_hline)(cmd->x, cmd->y, cmd->a, cmd->pixel0);
+	    break;
+
+	case DL_DRAW_VLINE:
+	    (dlist_below.draw_vline)(cmd->x, cmd->y, cmd->b, cmd->pixel0);
+	    break;
+
+	case DL_DRAW_RECT:
+	    (dlist_below.draw_rect)(cmd->x, cmd->y, cmd->a, cmd->b,
+				    cmd->pixel0);
+	    break;
+
+	case DL_FILL_RECT:
+	    (dlist_below.fill_rect)(cmd->x, cmd->y, cmd->a, cmd->b,
+				    cmd->pixel0);
+	    break;
+
+	case DL_FILL_SPANS:
+	    (dlist_below.fill_spans)((const struct span *)(data+cmd->data),
+				     cmd->a, cmd->pixel0);
+	    break;
+
+	case DL_DRAW_LINE:
+	    (dlist_below.draw_line)(cmd->x, cmd->y, cmd->a, cmd->b,
+				    cmd->pixel0);
+	    break;
+
+	case DL_EXPAND_BITMAP:
+	    (dlist_below.expand_bitmap)(cmd->x, cmd->y, cmd->a, cmd->b,
+					data+cmd->data, cmd->pitch,
+					cmd->pixel0, cmd->pixel1);
+	    break;
+
+	case DL_DRAW_PIXMAP:
+	    (dlist_below.draw_pixmap)(cmd->x, cmd->y, cmd->a, cmd->b,
+				      (const pixel_t *)(data+cmd->data));
+	    break;
+
+	case DL_DRAW_CHUNKY:
+	    (dlist_below.draw_chunky)(cmd->x, cmd->y, cmd->a, cmd->b,
+				      data+cmd->data, cmd->pitch);
+	    break;
+
+	case DL_DRAW_CIRCLE:
+	    (dlist_below.draw_circle)(cmd->x, cmd->y, cmd->a, cmd->pixel0);
+	    break;
+
+	case DL_FILL_CIRCLE:
+	    (dlist_below.fill_circle)(cmd->x, cmd->y, cmd->a, cmd->pixel0);
+	    break;
+
+	case DL_DRAW_ELLIPSE:
+	    (dlist_below.draw_ellipse)(cmd->x, cmd->y, cmd->a, cmd->b,
+				       cmd->pixel0);
+	    break;
+
+	case DL_FILL_ELLIPSE:
+	    (dlist_below.fill_ellipse)(cmd->x, cmd->y, cmd->a, cmd->b,
+				       cmd->pixel0);
+	    break;
+
+	case DL_FILL_POLYGON:
+	    (dlist_below.fill_polygon)((const struct point *)(data+cmd->data),
+				       cmd->a, cmd->b, cmd->pixel0);
+	    break;
+
+	case DL_BLEND_RECT:
+	    (dlist_below.blend_rect)(cmd->x, cmd->y, cmd->a, cmd->b,
+				     cmd->pixel0);
+	    break;
+
+	case DL_BLEND_PIXMAP:
+	    (dlist_below.blend_pixmap)(cmd->x, cmd->y, cmd->a, cmd->b,
+				       (const u32 *)(data+cmd->data));
+	    break;
+    }
+}
+
+
+    /*
+     *  Draw all recorded commands, band by band
+     */
+
+void dlist_submit(void)
+{
+    struct dlist *dlist = fb_current->dlist;
+    u32 bands, band, b0, b1, i, j, n;
+    const struct dlist_cmd *cmd;
+    int y0, y1, xres, yres;
+
+    if (!dlist || !dlist->recording || dlist->executing || !dlist->num_cmds)
+	return;
+
+    dlist->executing = 1;
+    xres = dlist_xres();
+    yres = dlist_yres();
+    bands = (yres+DLIST_BAND_HEIGHT-1)/DLIST_BAND_HEIGHT;
+    dlist->first = dlist_grow(dlist->first, &dlist->max_bands, bands+1,
+			      sizeof(*dlist->first));
+    memset(dlist->first, 0, (bands+1)*sizeof(*dlist->first));
+
+    /* Count the commands per band, ignoring invisible lines */
+    for (i = 0, n = 0; i < dlist->num_cmds; i++) {
+	cmd = &dlist->cmds[i];
+	y0 = max(cmd->y0, 0);
+	y1 = min(cmd->y1, yres);
+	if (y0 >= y1)
+	    continue;
+	b1 = (y1-1)/DLIST_BAND_HEIGHT;
+	for (band = y0/DLIST_BAND_HEIGHT; band <= b1; band++, n++)
+	    dlist->first[band+1]++;
+    }
+    for (band = 0; band < bands; band++)
+	dlist->first[band+1] += dlist->first[band];
+
+    /* Sort the command indices by band, keeping their order */
+    dlist->bins = dlist_grow(dlist->bins, &dlist->max_bins, n,
+			     sizeof(*dlist->bins));
+    for (i = 0; i < dlist->num_cmds; i++) {
+	cmd = &dlist->cmds[i];
+	y0 = max(cmd->y0, 0);
+	y1 = min(cmd->y1, yres);
+	if (y0 >= y1)
+	    continue;
+	b1 = (y1-1)/DLIST_BAND_HEIGHT;
+	for (band = y0/DLIST_BAND_HEIGHT; band <= b1; band++)
+	    dlist->bins[dlist->first[band]++] = i;
+    }
+
+    /* first[band] now points to the start of the next band */
+    for (band = 0, b0 = 0; band < bands; band++) {
+	b1 = dlist->first[band];
+	if (b0 == b1)
+	    continue;
+	clip_push(0, band*DLIST_BAND_HEIGHT, xres, DLIST_BAND_HEIGHT);
+	for (j = b0; j < b1; j++)
+	    dlist_exec(&dlist->cmds[dlist->bins[j]], dlist->data);
+	clip_pop();
+	b0 = b1;
+    }
+
+    dlist->num_cmds = 0;
+    dlist->data_len = 0;
+    dlist->executing = 0;
+}
+
+
+    /*
+     *  Drawing operations layer
+     */
+
+static void dlist_set_pixel(u32 x, u32 y, pixel_t pixel)
+{
+    struct dlist_cmd *cmd = dlist_add(DL_SET_PIXEL, y, (int)y+1);
+
+    cmd->x = x;
+    cmd->y = y;
+    cmd->pixel0 = pixel;
+}
+
+static pixel_t dlist_get_pixel(u32 x, u32 y)
+{
+    dlist_submit();
+    return (dlist_below.get_pixel)(x, y);
+}
+
+static void dlist_draw_hline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    struct dlist_cmd *cmd = dlist_add(DL_DRAW_HLINE, y, (int)y+1);
+
+    cmd->x = x;
+    cmd->y = y;
+    cmd->a = length;
+    cmd->pixel0 = pixel;
+}
+
+static void dlist_draw_vline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    struct dlist_cmd *cmd = dlist_add(DL_DRAW_VLINE, y, (int)(y+length));
+
+    cmd->x = x;
+    cmd->y = y;
+    cmd->b = length;
+    cmd->pixel0 = pixel;
+}
+
+static void dlist_draw_rect(u32 x, u32 y, u32 width, u32 height,
+			    pixel_t pixel)
+{
+    struct dlist_cmd *cmd = dlist_add(DL_DRAW_RECT, y,
+				      (int)(y+max(height, 1U)));
+
+    cmd->x = x;
+    cmd->y = y;
+    cmd->a = width;
+    cmd->b = height;
+    cmd->pixel0 = pixel;
+}
+
+static void dlist_fill_rect(u32 x, u32 y, u32 width, u32 height,
+			    pixel_t pixel)
+{
+    struct dlist_cmd *cmd = dlist_add(DL_FILL_RECT, y, (int)(y+height));
+
+    cmd->x = x;
+    cmd->y = y;
+    cmd->a = width;
+    cmd->b = height;
+    cmd->pixel0 = pixel;
+}
+
+static void dlist_fill_spans(const struct span *spans, u32 num,
+			     pixel_t pixel)
+{
+    u32 offset = dlist_add_data(spans, num*sizeof(*spans));
+    struct dlist_cmd *cmd;
+    int y0 = INT_MAX, y1 = INT_MIN;
+    u32 i;
+
+    for (i = 0; i < num; i++) {
+	y0 = min(y0, (int)spans[i].y);
+	y1 = max(y1, (int)spans[i].y+1);
+    }
+    cmd = dlist_add(DL_FILL_SPANS, y0, y1);
+    cmd->a = num;
+    cmd->pixel0 = pixel;
+    cmd->data = offset;
+}
+
+static void dlist_draw_line(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel)
+{
+    struct dlist_cmd *cmd = dlist_add(DL_DRAW_LINE, min((int)y1, (int)y2),
+				      max((int)y1, (int)y2)+1);
+
+    cmd->x = x1;
+    cmd->y = y1;
+    cmd->a = x2;
+    cmd->b = y2;
+    cmd->pixel0 = pixel;
+}
+
+static void dlist_expand_bitmap(u32 x, u32 y, u32 width, u32 height,
+				const u8 *data, u32 pitch, pixel_t pixel0,
+				pixel_t pixel1)
+{
+    u32 offset = dlist_add_data(data, height*pitch);
+    struct dlist_cmd *cmd = dlist_add(DL_EXPAND_BITMAP, y, (int)(y+height));
+
+    cmd->x = x;
+    cmd->y = y;
+    cmd->a = width;
+    cmd->b = height;
+    cmd->pixel0 = pixel0;
+    cmd->pixel1 = pixel1;
+    cmd->data = offset;
+    cmd->pitch = pitch;
+}
+
+static void dlist_draw_pixmap(u32 x, u32 y, u32 width, u32 height,
+			      const pixel_t *pixmap)
+{
+    u32 offset = dlist_add_data(pixmap, width*height*sizeof(*pixmap));
+    struct dlist_cmd *cmd = dlist_add(DL_DRAW_PIXMAP, y, (int)(y+height));
+
+    cmd->x = x;
+    cmd->y = y;
+    cmd->a = width;
+    cmd->b = height;
+    cmd->data = offset;
+}
+
+    /* Lines are copied one by one, each one is padded like all data */
+static void dlist_draw_chunky(u32 x, u32 y, u32 width, u32 height,
+			      const u8 *data, u32 pitch)
+{
+    u32 offset = dlist_add_data(data, width);
+    struct dlist_cmd *cmd;
+    u32 i;
+
+    for (i = 1; i < height; i++)
+	dlist_add_data(data+i*pitch, width);
+    cmd = dlist_add(DL_DRAW_CHUNKY, y, (int)(y+height));
+    cmd->x = x;
+    cmd->y = y;
+    cmd->a = width;
+    cmd->b = height;
+    cmd->data = offset;
+    cmd->pitch = (width+sizeof(pixel_t)-1) & ~(sizeof(pixel_t)-1);
+}
+
+static void dlist_draw_circle(u32 x, u32 y, u32 r, pixel_t pixel)
+{
+    struct dlist_cmd *cmd = dlist_add(DL_DRAW_CIRCLE, (int)y-(int)r,
+				      (int)(y+r)+1);
+
+    cmd->x = x;
+    cmd->y = y;
+    cmd->a = r;
+    cmd->pixel0 = pixel;
+}
+
+static void dlist_fill_circle(u32 x, u32 y, u32 r, pixel_t pixel)
+{
+    struct dlist_cmd *cmd = dlist_add(DL_FILL_CIRCLE, (int)y-(int)r,
+				      (int)(y+r)+1);
+
+    cmd->x = x;
+    cmd->y = y;
+    cmd->a = r;
+    cmd->pixel0 = pixel;
+}
+
+static void dlist_draw_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
+{
+    struct dlist_cmd *cmd = dlist_add(DL_DRAW_ELLIPSE, (int)y-(int)b,
+				      (int)(y+b)+1);
+
+    cmd->x = x;
+    cmd->y = y;
+    cmd->a = a;
+    cmd->b = b;
+    cmd->pixel0 = pixel;
+}
+
+static void dlist_fill_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
+{
+    struct dlist_cmd *cmd = dlist_add(DL_FILL_ELLIPSE, (int)y-(int)b,
+				      (int)(y+b)+1);
+
+    cmd->x = x;
+    cmd->y = y;
+    cmd->a = a;
+    cmd->b = b;
+    cmd->pixel0 = pixel;
+}
+
+static void dlist_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx,
+			    u32 sy)
+{
+    dlist_submit();
+    (dlist_below.copy_rect)(dx, dy, width, height, sx, sy);
+}
+
+static void dlist_fill_polygon(const struct point *points, u32 num,
+			       enum fill_rule rule, pixel_t pixel)
+{
+    u32 offset = dlist_add_data(points, num*sizeof(*points));
+    struct dlist_cmd *cmd;
+    int y0 = INT_MAX, y1 = INT_MIN;
+    u32 i;
+
+    for (i = 0; i < num; i++) {
+	y0 = min(y0, (int)points[i].y);
+	y1 = max(y1, (int)points[i].y);
+    }
+    cmd = dlist_add(DL_FILL_POLYGON, y0, y1);
+    cmd->a = num;
+    cmd->b = rule;
+    cmd->pixel0 = pixel;
+    cmd->data = offset;
+}
+
+static void dlist_blend_rect(u32 x, u32 y, u32 width, u32 height, u32 argb)
+{
+    struct dlist_cmd *cmd = dlist_add(DL_BLEND_RECT, y, (int)(y+height));
+
+    cmd->x = x;
+    cmd->y = y;
+    cmd->a = width;
+    cmd->b = height;
+    cmd->pixel0 = argb;
+}
+
+static void dlist_blend_pixmap(u32 x, u32 y, u32 width, u32 height,
+			       const u32 *argb)
+{
+    u32 offset = dlist_add_data(argb, width*height*sizeof(*argb));
+    struct dlist_cmd *cmd = dlist_add(DL_BLEND_PIXMAP, y, (int)(y+height));
+
+    cmd->x = x;
+    cmd->y = y;
+    cmd->a = width;
+    cmd->b = height;
+    cmd->data = offset;
+}
+
+static const struct drawops dlist_drawops = {
+    .name =		"dlist",
+    .set_pixel =	dlist_set_pixel,
+    .get_pixel =	dlist_get_pixel,
+    .draw_hline =	dlist_draw_hline,
+    .draw_vline =	dlist_draw_vline,
+    .draw_rect =	dlist_draw_rect,
+    .fill_rect =	dlist_fill_rect,
+    .fill_spans =	dlist_fill_spans,
+    .draw_line =	dlist_draw_line,
+    .expand_bitmap =	dlist_expand_bitmap,
+    .draw_pixmap =	dlist_draw_pixmap,
+    .draw_chunky =	dlist_draw_chunky,
+    .draw_circle =	dlist_draw_circle,
+    .fill_circle =	dlist_fill_circle,
+    .draw_ellipse =	dlist_draw_ellipse,
+    .fill_ellipse =	dlist_fill_ellipse,
+    .copy_rect =	dlist_copy_rect,
+    .fill_polygon =	dlist_fill_polygon,
+    .blend_rect =	dlist_blend_rect,
+    .blend_pixmap =	dlist_blend_pixmap,
+};
+
+
+    /*
+     *  Start recording
+     *
+     *  Without the clipping layer, drawing stays immediate
+     */
+
+void dlist_begin(void)
+{
+    struct dlist *dlist = fb_current->dlist;
+
+    if (!fb_current->clip || (dlist && dlist->recording))
+	return;
+
+    if (!dlist) {
+	if (!(dlist = calloc(1, sizeof(*dlist))))
+	    Fatal("calloc %zu: %s\n", sizeof(*dlist), strerror(errno));
+	fb_current->dlist = dlist;
+    }
+    drawops_push_layer(&dlist_drawops, &dlist_below);
+    dlist->recording = 1;
+}
+
+
+    /*
+     *  Draw all recorded commands, and stop recording
+     */
+
+void dlist_end(void)
+{
+    struct dlist *dlist = fb_current->dlist;
+
+    if (!dlist || !dlist->recording)
+	return;
+
+    if (!drawops_layer_on_top(&dlist_drawops)) {
+	/* Fatal() cleans up, don't get here again */
+	dlist->recording = 0;
+	Fatal("Display list layer is not on top\n");
+    }
+
+    dlist_submit();
+    drawops_pop_layer(&dlist->below);
+    dlist->recording = 0;
+}
+
+
+    /*
+     *  Clean up
+     */
+
+void dlist_cleanup(void)
+{
+    struct dlist *dlist = fb_current->dlist;
+
+    if (!dlist)
+	return;
+
+    Debug("dlist_cleanup()\n");
+    dlist_end();
+    fb_current->dlist = NULL;
+    free(dlist->cmds);
+    free(dlist->data);
+    free(dlist->bins);
+    free(dlist->first);
+    free(dlist);
+}
@@ -0,0 +1,309 @@
+
+/*
+ *  Word parallel bitstream shifts
+ *
+ *  The main chunk of a bit copy between different alignments combines each
+ *  source word with its predecessor, using a funnel shift on the big endian
+ *  values. This does the same for a whole vector of words at once: the
+ *  predecessors are taken from the previous vector in registers instead of
+ *  being loaded again, so every source word is read exactly once, before
+ *  the destination words that may overlap it are written, like the scalar
+ *  loops in bitstream.c. Those remain the reference, and handle the words
+ *  left over here.
+ *
+ *  The vector unit is selected at runtime (AVX2 or SSSE3 on x86, NEON on
+ *  64-bit ARM). Both need a byte shuffle to convert to big endian values, and
+ *  64-bit words on a little endian host.
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <endian.h>
+
+#include "types.h"
+#include "bitstream.h"
+
+#if BITS_PER_LONG == 64 && __BYTE_ORDER == __LITTLE_ENDIAN
+#if defined(__x86_64__)
+#include <immintrin.h>
+#if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define HAVE_SSSE3
+#define HAVE_AVX2
+#endif
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HAVE_NEON
+#endif
+#endif
+
+
+    /*
+     *  Distance of the software prefetch ahead of the source stream
+     */
+
+#define PREFETCH	32	/* words */
+
+
+    /*
+     *  A shift kernel processes the largest multiple of its vector width of
+     *  the n words at dst and src, and returns the number of words done.
+     *
+     *  d0 is the big endian value of the source word preceding src (following
+     *  it for reverse copies), and is updated to the last word read. inv is
+     *  xored into the results.
+     */
+
+struct bitshift_kernel {
+    const char *name;
+    u32 (*fwd)(unsigned long *dst, const unsigned long *src, u32 n, int left,
+	       unsigned long *d0, unsigned long inv);
+    u32 (*rev)(unsigned long *dst, const unsigned long *src, u32 n, int left,
+	       unsigned long *d0, unsigned long inv);
+};
+
+
+#ifdef HAVE_SSSE3
+    /*
+     *  SSSE3, 2 words per vector
+     */
+
+#define SWAP64_128	_mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0,		\
+				      15, 14, 13, 12, 11, 10, 9, 8)
+
+__attribute__((target("ssse3")))
+static u32 shift_ssse3(unsigned long *dst, const unsigned long *src, u32 n,
+		       int left, unsigned long *d0, unsigned long inv)
+{
+    const __m128i swap = SWAP64_128, x = _mm_set1_epi64x(inv);
+    const __m128i l = _mm_cvtsi32_si128(left);
+    const __m128i r = _mm_cvtsi32_si128(BITS_PER_LONG-left);
+    __m128i prev = _mm_set1_epi64x(*d0), cur, a, out;
+    u32 i;
+
+    for (i = 0; i+2 <= n; i += 2) {
+	__builtin_prefetch(src+i+PREFETCH);
+	cur = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src+i)),
+			       swap);
+	/* (prev[1], cur[0]) */
+	a = _mm_alignr_epi8(cur, prev, 8);
+	out = _mm_or_si128(_mm_sll_epi64(a, l), _mm_srl_epi64(cur, r));
+	_mm_storeu_si128((__m128i *)(dst+i),
+			 _mm_shuffle_epi8(_mm_xor_si128(out, x), swap));
+	prev = cur;
+    }
+    *d0 = _mm_cvtsi128_si64(_mm_unpackhi_epi64(prev, prev));
+    return i;
+}
+
+__attribute__((target("ssse3")))
+static u32 shift_rev_ssse3(unsigned long *dst, const unsigned long *src,
+			   u32 n, int left, unsigned long *d0,
+			   unsigned long inv)
+{
+    const __m128i swap = SWAP64_128, x = _mm_set1_epi64x(inv);
+    const __m128i l = _mm_cvtsi32_si128(left);
+    const __m128i r = _mm_cvtsi32_si128(BITS_PER_LONG-left);
+    __m128i prev = _mm_set1_epi64x(*d0), cur, b, out;
+    u32 i;
+
+    for (i = 0; i+2 <= n; i += 2) {
+	__builtin_prefetch(src-i-PREFETCH);
+	cur = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src-i-1)),
+			       swap);
+	/* (cur[1], prev[0]) */
+	b = _mm_alignr_epi8(prev, cur, 8);
+	out = _mm_or_si128(_mm_sll_epi64(cur, l), _mm_srl_epi64(b, r));
+	_mm_storeu_si128((__m128i *)(dst-i-1),
+			 _mm_shuffle_epi8(_mm_xor_si128(out, x), swap));
+	prev = cur;
+    }
+    *d0 = _mm_cvtsi128_si64(prev);
+    return i;
+}
+#endif /* HAVE_SSSE3 */
+
+
+#ifdef HAVE_AVX2
+    /*
+     *  AVX2, 4 words per vector
+     *
+     *  The byte shifts of AVX2 work within 128-bit lanes, so the word crossing
+     *  the lanes is moved in by a lane permute first.
+     */
+
+#define SWAP64_256	_mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0,	\
+					 15, 14, 13, 12, 11, 10, 9, 8,	\
+					 7, 6, 5, 4, 3, 2, 1, 0,	\
+					 15, 14, 13, 12, 11, 10, 9, 8)
+
+__attribute__((target("avx2")))
+static u32 shift_avx2(unsigned long *dst, const unsigned long *src, u32 n,
+		      int left, unsigned long *d0, unsigned long inv)
+{
+    const __m256i swap = SWAP64_256, x = _mm256_set1_epi64x(inv);
+    const __m128i l = _mm_cvtsi32_si128(left);
+    const __m128i r = _mm_cvtsi32_si128(BITS_PER_LONG-left);
+    __m256i prev = _mm256_set1_epi64x(*d0), cur, a, out;
+    u32 i;
+
+    for (i = 0; i+4 <= n; i += 4) {
+	__builtin_prefetch(src+i+PREFETCH);
+	cur = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(src+i)),
+				  swap);
+	/* (prev[3], cur[0], cur[1], cur[2]) */
+	a = _mm256_alignr_epi8(cur, _mm256_permute2x128_si256(prev, cur, 0x21),
+			       8);
+	out = _mm256_or_si256(_mm256_sll_epi64(a, l), _mm256_srl_epi64(cur, r));
+	_mm256_storeu_si256((__m256i *)(dst+i),
+			    _mm256_shuffle_epi8(_mm256_xor_si256(out, x), swap));
+	prev = cur;
+    }
+    *d0 = _mm256_extract_epi64(prev, 3);
+    return i;
+}
+
+__attribute__((target("avx2")))
+static u32 shift_rev_avx2(unsigned long *dst, const unsigned long *src, u32 n,
+			  int left, unsigned long *d0, unsigned long inv)
+{
+    const __m256i swap = SWAP64_256, x = _mm256_set1_epi64x(inv);
+    const __m128i l = _mm_cvtsi32_si128(left);
+    const __m128i r = _mm_cvtsi32_si128(BITS_PER_LONG-left);
+    __m256i prev = _mm256_set1_epi64x(*d0), cur, b, out;
+    u32 i;
+
+    for (i = 0; i+4 <= n; i += 4) {
+	__builtin_prefetch(src-i-PREFETCH);
+	cur = _mm256_shuffle_epi8(
+		_mm256_loadu_si256((const __m256i *)(src-i-3)), swap);
+	/* (cur[1], cur[2], cur[3], prev[0]) */
+	b = _mm256_alignr_epi8(_mm256_permute2x128_si256(cur, prev, 0x21), cur,
+			       8);
+	out = _mm256_or_si256(_mm256_sll_epi64(cur, l), _mm256_srl_epi64(b, r));
+	_mm256_storeu_si256((__m256i *)(dst-i-3),
+			    _mm256_shuffle_epi8(_mm256_xor_si256(out, x), swap));
+	prev = cur;
+    }
+    *d0 = _mm256_extract_epi64(prev, 0);
+    return i;
+}
+#endif /* HAVE_AVX2 */
+
+
+#ifdef HAVE_NEON
+    /*
+     *  NEON, 2 words per vector
+     */
+
+static u32 shift_neon(unsigned long *dst, const unsigned long *src, u32 n,
+		      int left, unsigned long *d0, unsigned long inv)
+{
+    const uint64x2_t x = vdupq_n_u64(inv);
+    const int64x2_t l = vdupq_n_s64(left), r = vdupq_n_s64(left-BITS_PER_LONG);
+    uint64x2_t prev = vdupq_n_u64(*d0), cur, a, out;
+    u32 i;
+
+    for (i = 0; i+2 <= n; i += 2) {
+	__builtin_prefetch(src+i+PREFETCH);
+	cur = vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8((const u8 *)(src+i))));
+	/* (prev[1], cur[0]) */
+	a = vextq_u64(prev, cur, 1);
+	out = vorrq_u64(vshlq_u64(a, l), vshlq_u64(cur, r));
+	vst1q_u8((u8 *)(dst+i),
+		 vrev64q_u8(vreinterpretq_u8_u64(veorq_u64(out, x))));
+	prev = cur;
+    }
+    *d0 = vgetq_lane_u64(prev, 1);
+    return i;
+}
+
+static u32 shift_rev_neon(unsigned long *dst, const unsigned long *src, u32 n,
+			  int left, unsigned long *d0, unsigned long inv)
+{
+    const uint64x2_t x = vdupq_n_u64(inv);
+    const int64x2_t l = vdupq_n_s64(left), r = vdupq_n_s64(left-BITS_PER_LONG);
+    uint64x2_t prev = vdupq_n_u64(*d0), cur, b, out;
+    u32 i;
+
+    for (i = 0; i+2 <= n; i += 2) {
+	__builtin_prefetch(src-i-PREFETCH);
+	cur = vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8((const u8 *)(src-i-1))));
+	/* (cur[1], prev[0]) */
+	b = vextq_u64(cur, prev, 1);
+	out = vorrq_u64(vshlq_u64(cur, l), vshlq_u64(b, r));
+	vst1q_u8((u8 *)(dst-i-1),
+		 vrev64q_u8(vreinterpretq_u8_u64(veorq_u64(out, x))));
+	prev = cur;
+    }
+    *d0 = vgetq_lane_u64(prev, 0);
+    return i;
+}
+#endif /* HAVE_NEON */
+
+
+#ifdef HAVE_SSSE3
+static const struct bitshift_kernel bitshift_ssse3 = {
+    "ssse3", shift_ssse3, shift_rev_ssse3
+};
+#endif
+#ifdef HAVE_AVX2
+static const struct bitshift_kernel bitshift_avx2 = {
+    "avx2", shift_avx2, shift_rev_avx2
+};
+#endif
+#ifdef HAVE_NEON
+static const struct bitshift_kernel bitshift_neon = {
+    "neon", shift_neon, shift_rev_neon
+};
+#endif
+
+static inline const struct bitshift_kernel *bitshift_select(void)
+{
+#ifdef HAVE_AVX2
+    if (__builtin_cpu_supports("avx2"))
+	return &bitshift_avx2;
+#endif
+#ifdef HAVE_SSSE3
+    if (__builtin_cpu_supports("ssse3"))
+	return &bitshift_ssse3;
+#endif
+#ifdef HAVE_NEON
+    return &bitshift_neon;
+#endif
+    return NULL;
+}
+
+const char *bitshift_name(void)
+{
+    const struct bitshift_kernel *kernel = bitshift_select();
+
+    return kernel ? kernel->name : "long";
+}
+
+
+    /*
+     *  Forward and reverse funnel shifts of the words at src into dst
+     *
+     *  For reverse shifts, dst and src point to the last word. Without a
+     *  vector unit, no words are done.
+     */
+
+u32 bitshift(unsigned long *dst, const unsigned long *src, u32 n, int left,
+	     unsigned long *d0, unsigned long inv)
+{
+    const struct bitshift_kernel *kernel = bitshift_select();
+
+    return kernel ? kernel->fwd(dst, src, n, left, d0, inv) : 0;
+}
+
+u32 bitshift_rev(unsigned long *dst, const unsigned long *src, u32 n,
+		 int left, unsigned long *d0, unsigned long inv)
+{
+    const struct bitshift_kernel *kernel = bitshift_select();
+
+    return kernel ? kernel->rev(dst, src, n, left, d0, inv) : 0;
+}
@@ -9,17 +9,42 @@
  *  more details.
  */
 
+#include <byteswap.h>
+#include <string.h>
+
 #include "types.h"
 #include "bitstream.h"
 #include "fb.h"
 
+
+    /*
+     *  Bit 0 of a bitstream is the most significant bit of the first byte,
+     *  like in the frame buffer, on all hosts. Hence shifts are done on the
+     *  big endian value of a word, and be_long() converts between that and
+     *  the word in memory. Masks and patterns are applied to the word in
+     *  memory directly.
+     */
+
 #if __BYTE_ORDER == __LITTLE_ENDIAN
-#define FIRST_MASK(idx)		(~0UL << (idx))
-#define LAST_MASK(idx, n)	(~(~0UL << (((idx)+(n)) % BITS_PER_LONG)))
+#if BITS_PER_LONG == 64
+#define be_long(x)		bswap_64(x)
 #else
-#define FIRST_MASK(idx)		(~0UL >> (idx))
-#define LAST_MASK(idx, n)	(~(~0UL >> (((idx)+(n)) % BITS_PER_LONG)))
+#define be_long(x)		bswap_32(x)
 #endif
+#else
+#define be_long(x)		(x)
+#endif
+
+#define FIRST_MASK(idx)		be_long(~0UL >> (idx))
+#define LAST_MASK(idx, n)	be_long(~(~0UL >> (((idx)+(n)) % BITS_PER_LONG)))
+
+    /*
+     *  The same for reverse copies, ending at bit idx of the first word
+     */
+
+#define FIRST_MASK_REV(idx)	be_long(~0UL << (BITS_PER_LONG-1-(idx)))
+#define LAST_MASK_REV(idx, n)	be_long(((idx)+1-(n)) % BITS_PER_LONG ?	\
+				~0UL >> (((idx)+1-(n)) % BITS_PER_LONG) : 0)
 
 
     /*
@@ -34,6 +59,18 @@ static inline unsigned long comp(unsigned long a, unsigned long b,
 }
 
 
+    /*
+     *  Main chunks of at least VECTOR_WORDS words are copied and filled using
+     *  vector operations, unless the scalar code is requested as a reference.
+     *  Between the same alignments, they are plain memory copies, for which
+     *  the C library's memmove() is hard to beat.
+     */
+
+#define VECTOR_WORDS		8
+
+#define use_vector(n)		((n) >= VECTOR_WORDS && !fb_current->no_simd)
+
+
     /*
      *  Unaligned forward bit copy using 32-bit or 64-bit memory accesses
      */
@@ -45,6 +82,7 @@ void bitcpy(unsigned long *dst, int dst_idx, const unsigned long *src,
     int shift = dst_idx-src_idx, left, right;
     unsigned long d0, d1;
     int m;
+    u32 i;
 
     if (!n)
 	return;
@@ -73,6 +111,12 @@ void bitcpy(unsigned long *dst, int dst_idx, const unsigned long *src,
 
 	    // Main chunk
 	    n /= BITS_PER_LONG;
+	    if (use_vector(n)) {
+		memmove(dst, src, n*BYTES_PER_LONG);
+		dst += n;
+		src += n;
+		n = 0;
+	    }
 	    while (n >= 8) {
 		*dst++ = *src++;
 		*dst++ = *src++;
@@ -103,29 +147,29 @@ void bitcpy(unsigned long *dst, int dst_idx, const unsigned long *src,
 		first &= last;
 	    if (shift > 0) {
 		// Single source word
-		*dst = comp(*src >> right, *dst, first);
+		*dst = comp(be_long(be_long(*src) >> right), *dst, first);
 	    } else if (src_idx+n <= BITS_PER_LONG) {
 		// Single source word
-		*dst = comp(*src << left, *dst, first);
+		*dst = comp(be_long(be_long(*src) << left), *dst, first);
 	    } else {
 		// 2 source words
-		d0 = *src++;
-		d1 = *src;
-		*dst = comp(d0 << left | d1 >> right, *dst, first);
+		d0 = be_long(*src++);
+		d1 = be_long(*src);
+		*dst = comp(be_long(d0 << left | d1 >> right), *dst, first);
 	    }
 	} else {
 	    // Multiple destination words
-	    d0 = *src++;
+	    d0 = be_long(*src++);
 	    // Leading bits
 	    if (shift > 0) {
 		// Single source word
-		*dst = comp(d0 >> right, *dst, first);
+		*dst = comp(be_long(d0 >> right), *dst, first);
 		dst++;
 		n -= BITS_PER_LONG-dst_idx;
 	    } else {
 		// 2 source words
-		d1 = *src++;
-		*dst = comp(d0 << left | d1 >> right, *dst, first);
+		d1 = be_long(*src++);
+		*dst = comp(be_long(d0 << left | d1 >> right), *dst, first);
 		d0 = d1;
 		dst++;
 		n -= BITS_PER_LONG-dst_idx;
@@ -134,24 +178,30 @@ void bitcpy(unsigned long *dst, int dst_idx, const unsigned long *src,
 	    // Main chunk
 	    m = n % BITS_PER_LONG;
 	    n /= BITS_PER_LONG;
+	    if (use_vector(n)) {
+		i = bitshift(dst, src, n, left, &d0, 0);
+		dst += i;
+		src += i;
+		n -= i;
+	    }
 	    while (n >= 4) {
-		d1 = *src++;
-		*dst++ = d0 << left | d1 >> right;
+		d1 = be_long(*src++);
+		*dst++ = be_long(d0 << left | d1 >> right);
 		d0 = d1;
-		d1 = *src++;
-		*dst++ = d0 << left | d1 >> right;
+		d1 = be_long(*src++);
+		*dst++ = be_long(d0 << left | d1 >> right);
 		d0 = d1;
-		d1 = *src++;
-		*dst++ = d0 << left | d1 >> right;
+		d1 = be_long(*src++);
+		*dst++ = be_long(d0 << left | d1 >> right);
 		d0 = d1;
-		d1 = *src++;
-		*dst++ = d0 << left | d1 >> right;
+		d1 = be_long(*src++);
+		*dst++ = be_long(d0 << left | d1 >> right);
 		d0 = d1;
 		n -= 4;
 	    }
 	    while (n--) {
-		d1 = *src++;
-		*dst++ = d0 << left | d1 >> right;
+		d1 = be_long(*src++);
+		*dst++ = be_long(d0 << left | d1 >> right);
 		d0 = d1;
 	    }
 
@@ -159,11 +209,11 @@ void bitcpy(unsigned long *dst, int dst_idx, const unsigned long *src,
 	    if (last) {
 		if (m <= right) {
 		    // Single source word
-		    *dst = comp(d0 << left, *dst, last);
+		    *dst = comp(be_long(d0 << left), *dst, last);
 		} else {
 		    // 2 source words
-		    d1 = *src;
-		    *dst = comp(d0 << left | d1 >> right, *dst, last);
+		    d1 = be_long(*src);
+		    *dst = comp(be_long(d0 << left | d1 >> right), *dst, last);
 		}
 	    }
 	}
@@ -182,6 +232,7 @@ void bitcpy_rev(unsigned long *dst, int dst_idx, const unsigned long *src,
     int shift = dst_idx-src_idx, left, right;
     unsigned long d0, d1;
     int m;
+    u32 i;
 
     if (!n)
 	return;
@@ -198,8 +249,8 @@ void bitcpy_rev(unsigned long *dst, int dst_idx, const unsigned long *src,
     }
 
     shift = dst_idx-src_idx;
-    first = FIRST_MASK(BITS_PER_LONG-1-dst_idx);
-    last = LAST_MASK(BITS_PER_LONG-1-dst_idx, n);
+    first = FIRST_MASK_REV(dst_idx);
+    last = LAST_MASK_REV(dst_idx, n);
 
     if (!shift) {
 	// Same alignment for source and dest
@@ -221,6 +272,12 @@ void bitcpy_rev(unsigned long *dst, int dst_idx, const unsigned long *src,
 
 	    // Main chunk
 	    n /= BITS_PER_LONG;
+	    if (use_vector(n)) {
+		memmove(dst-n+1, src-n+1, n*BYTES_PER_LONG);
+		dst -= n;
+		src -= n;
+		n = 0;
+	    }
 	    while (n >= 8) {
 		*dst-- = *src--;
 		*dst-- = *src--;
@@ -251,29 +308,29 @@ void bitcpy_rev(unsigned long *dst, int dst_idx, const unsigned long *src,
 		first &= last;
 	    if (shift < 0) {
 		// Single source word
-		*dst = comp(*src << left, *dst, first);
+		*dst = comp(be_long(be_long(*src) << left), *dst, first);
 	    } else if (1+(unsigned long)src_idx >= n) {
 		// Single source word
-		*dst = comp(*src >> right, *dst, first);
+		*dst = comp(be_long(be_long(*src) >> right), *dst, first);
 	    } else {
 		// 2 source words
-		d0 = *src--;
-		d1 = *src;
-		*dst = comp(d0 >> right | d1 << left, *dst, first);
+		d0 = be_long(*src--);
+		d1 = be_long(*src);
+		*dst = comp(be_long(d0 >> right | d1 << left), *dst, first);
 	    }
 	} else {
 	    // Multiple destination words
-	    d0 = *src--;
+	    d0 = be_long(*src--);
 	    // Leading bits
 	    if (shift < 0) {
 		// Single source word
-		*dst = comp(d0 << left, *dst, first);
+		*dst = comp(be_long(d0 << left), *dst, first);
 		dst--;
 		n -= dst_idx+1;
 	    } else {
 		// 2 source words
-		d1 = *src--;
-		*dst = comp(d0 >> right | d1 << left, *dst, first);
+		d1 = be_long(*src--);
+		*dst = comp(be_long(d0 >> right | d1 << left), *dst, first);
 		d0 = d1;
 		dst--;
 		n -= dst_idx+1;
@@ -282,24 +339,30 @@ void bitcpy_rev(unsigned long *dst, int dst_idx, const unsigned long *src,
 	    // Main chunk
 	    m = n % BITS_PER_LONG;
 	    n /= BITS_PER_LONG;
+	    if (use_vector(n)) {
+		i = bitshift_rev(dst, src, n, left, &d0, 0);
+		dst -= i;
+		src -= i;
+		n -= i;
+	    }
 	    while (n >= 4) {
-		d1 = *src--;
-		*dst-- = d0 >> right | d1 << left;
+		d1 = be_long(*src--);
+		*dst-- = be_long(d0 >> right | d1 << left);
 		d0 = d1;
-		d1 = *src--;
-		*dst-- = d0 >> right | d1 << left;
+		d1 = be_long(*src--);
+		*dst-- = be_long(d0 >> right | d1 << left);
 		d0 = d1;
-		d1 = *src--;
-		*dst-- = d0 >> right | d1 << left;
+		d1 = be_long(*src--);
+		*dst-- = be_long(d0 >> right | d1 << left);
 		d0 = d1;
-		d1 = *src--;
-		*dst-- = d0 >> right | d1 << left;
+		d1 = be_long(*src--);
+		*dst-- = be_long(d0 >> right | d1 << left);
 		d0 = d1;
 		n -= 4;
 	    }
 	    while (n--) {
-		d1 = *src--;
-		*dst-- = d0 >> right | d1 << left;
+		d1 = be_long(*src--);
+		*dst-- = be_long(d0 >> right | d1 << left);
 		d0 = d1;
 	    }
 
@@ -307,11 +370,11 @@ void bitcpy_rev(unsigned long *dst, int dst_idx, const unsigned long *src,
 	    if (last) {
 		if (m <= left) {
 		    // Single source word
-		    *dst = comp(d0 >> right, *dst, last);
+		    *dst = comp(be_long(d0 >> right), *dst, last);
 		} else {
 		    // 2 source words
-		    d1 = *src;
-		    *dst = comp(d0 >> right | d1 << left, *dst, last);
+		    d1 = be_long(*src);
+		    *dst = comp(be_long(d0 >> right | d1 << left), *dst, last);
 		}
 	    }
 	}
@@ -331,6 +394,7 @@ void bitcpy_not(unsigned long *dst, int dst_idx, const unsigned long *src,
     int shift = dst_idx-src_idx, left, right;
     unsigned long d0, d1;
     int m;
+    u32 i;
 
     if (!n)
 	return;
@@ -389,29 +453,29 @@ void bitcpy_not(unsigned long *dst, int dst_idx, const unsigned long *src,
 		first &= last;
 	    if (shift > 0) {
 		// Single source word
-		*dst = comp(~*src >> right, *dst, first);
+		*dst = comp(be_long(~be_long(*src) >> right), *dst, first);
 	    } else if (src_idx+n <= BITS_PER_LONG) {
 		// Single source word
-		*dst = comp(~*src << left, *dst, first);
+		*dst = comp(be_long(~be_long(*src) << left), *dst, first);
 	    } else {
 		// 2 source words
-		d0 = ~*src++;
-		d1 = ~*src;
-		*dst = comp(d0 << left | d1 >> right, *dst, first);
+		d0 = ~be_long(*src++);
+		d1 = ~be_long(*src);
+		*dst = comp(be_long(d0 << left | d1 >> right), *dst, first);
 	    }
 	} else {
 	    // Multiple destination words
-	    d0 = ~*src++;
+	    d0 = ~be_long(*src++);
 	    // Leading bits
 	    if (shift > 0) {
 		// Single source word
-		*dst = comp(d0 >> right, *dst, first);
+		*dst = comp(be_long(d0 >> right), *dst, first);
 		dst++;
 		n -= BITS_PER_LONG-dst_idx;
 	    } else {
 		// 2 source words
-		d1 = ~*src++;
-		*dst = comp(d0 << left | d1 >> right, *dst, first);
+		d1 = ~be_long(*src++);
+		*dst = comp(be_long(d0 << left | d1 >> right), *dst, first);
 		d0 = d1;
 		dst++;
 		n -= BITS_PER_LONG-dst_idx;
@@ -420,24 +484,32 @@ void bitcpy_not(unsigned long *dst, int dst_idx, const unsigned long *src,
 	    // Main chunk
 	    m = n % BITS_PER_LONG;
 	    n /= BITS_PER_LONG;
+	    if (use_vector(n)) {
+		d0 = ~d0;
+		i = bitshift(dst, src, n, left, &d0, ~0UL);
+		d0 = ~d0;
+		dst += i;
+		src += i;
+		n -= i;
+	    }
 	    while (n >= 4) {
-		d1 = ~*src++;
-		*dst++ = d0 << left | d1 >> right;
+		d1 = ~be_long(*src++);
+		*dst++ = be_long(d0 << left | d1 >> right);
 		d0 = d1;
-		d1 = ~*src++;
-		*dst++ = d0 << left | d1 >> right;
+		d1 = ~be_long(*src++);
+		*dst++ = be_long(d0 << left | d1 >> right);
 		d0 = d1;
-		d1 = ~*src++;
-		*dst++ = d0 << left | d1 >> right;
+		d1 = ~be_long(*src++);
+		*dst++ = be_long(d0 << left | d1 >> right);
 		d0 = d1;
-		d1 = ~*src++;
-		*dst++ = d0 << left | d1 >> right;
+		d1 = ~be_long(*src++);
+		*dst++ = be_long(d0 << left | d1 >> right);
 		d0 = d1;
 		n -= 4;
 	    }
 	    while (n--) {
-		d1 = ~*src++;
-		*dst++ = d0 << left | d1 >> right;
+		d1 = ~be_long(*src++);
+		*dst++ = be_long(d0 << left | d1 >> right);
 		d0 = d1;
 	    }
 
@@ -445,11 +517,11 @@ void bitcpy_not(unsigned long *dst, int dst_idx, const unsigned long *src,
 	    if (last) {
 		if (m <= right) {
 		    // Single source word
-		    *dst = comp(d0 << left, *dst, last);
+		    *dst = comp(be_long(d0 << left), *dst, last);
 		} else {
 		    // 2 source words
-		    d1 = ~*src;
-		    *dst = comp(d0 << left | d1 >> right, *dst, last);
+		    d1 = ~be_long(*src);
+		    *dst = comp(be_long(d0 << left | d1 >> right), *dst, last);
 		}
 	    }
 	}
@@ -472,6 +544,7 @@ void bitfill32(unsigned long *dst, int dst_idx, u32 pat, u32 n)
 #if BITS_PER_LONG == 64
     val |= val << 32;
 #endif
+    val = be_long(val);
 
     first = FIRST_MASK(dst_idx);
     last = LAST_MASK(dst_idx, n);
@@ -492,6 +565,12 @@ void bitfill32(unsigned long *dst, int dst_idx, u32 pat, u32 n)
 
 	// Main chunk
 	n /= BITS_PER_LONG;
+	if (use_vector(n)) {
+	    // The first 32 bits of val in memory are the pattern
+	    memfill32(dst, val, n*BYTES_PER_LONG, 0);
+	    dst += n;
+	    n = 0;
+	}
 	while (n >= 8) {
 	    *dst++ = val;
 	    *dst++ = val;
@@ -535,12 +614,12 @@ void bitfill(unsigned long *dst, int dst_idx, unsigned long pat, int left,
 	// Single word
 	if (last)
 	    first &= last;
-	*dst = comp(pat, *dst, first);
+	*dst = comp(be_long(pat), *dst, first);
     } else {
 	// Multiple destination words
 	// Leading bits
 	if (first) {
-	    *dst = comp(pat, *dst, first);
+	    *dst = comp(be_long(pat), *dst, first);
 	    dst++;
 	    pat = pat << left | pat >> right;
 	    n -= BITS_PER_LONG-dst_idx;
@@ -549,24 +628,24 @@ void bitfill(unsigned long *dst, int dst_idx, unsigned long pat, int left,
 	// Main chunk
 	n /= BITS_PER_LONG;
 	while (n >= 4) {
-	    *dst++ = pat;
+	    *dst++ = be_long(pat);
 	    pat = pat << left | pat >> right;
-	    *dst++ = pat;
+	    *dst++ = be_long(pat);
 	    pat = pat << left | pat >> right;
-	    *dst++ = pat;
+	    *dst++ = be_long(pat);
 	    pat = pat << left | pat >> right;
-	    *dst++ = pat;
+	    *dst++ = be_long(pat);
 	    pat = pat << left | pat >> right;
 	    n -= 4;
 	}
 	while (n--) {
-	    *dst++ = pat;
+	    *dst++ = be_long(pat);
 	    pat = pat << left | pat >> right;
 	}
 
 	// Trailing bits
 	if (last)
-	    *dst = comp(pat, *dst, last);
+	    *dst = comp(be_long(pat), *dst, last);
     }
 }
 
@@ -0,0 +1,283 @@
+
+/*
+ *  Porter-Duff source over compositing
+ *
+ *  Blends premultiplied ARGB8888 source pixels into rows of ARGB8888 or
+ *  RGB565 pixels, i.e. for each component
+ *
+ *	dst = src + dst*(255-alpha)/255
+ *
+ *  using integer math only. This uses vector operations (SSE2 on x86, NEON
+ *  on ARM) where available, with a per-pixel version for other architectures
+ *  and the remaining pixels. All versions give the same results.
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include "types.h"
+#include "bitstream.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#ifdef __SSE2__
+#define HAVE_SSE2
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAVE_NEON
+#endif
+
+
+    /*
+     *  x/255, rounded, for 0 <= x <= 255*255
+     */
+
+static inline u32 div255(u32 x)
+{
+    x += 128;
+    return (x+(x >> 8)) >> 8;
+}
+
+static inline u32 over(u32 s, u32 d, u32 ia)
+{
+    d = s+div255(d*ia);
+    return d > 255 ? 255 : d;
+}
+
+
+    /*
+     *  One pixel at a time
+     */
+
+static void blend32_long(u32 *dst, const u32 *src, u32 n, u32 keep)
+{
+    u32 s, d, ia, res;
+
+    for (; n--; dst++, src++) {
+	s = *src;
+	if (!s)
+	    continue;
+	d = *dst;
+	ia = 255-(s >> 24);
+	res = over(s >> 24, d >> 24, ia) << 24 |
+	      over((s >> 16) & 0xff, (d >> 16) & 0xff, ia) << 16 |
+	      over((s >> 8) & 0xff, (d >> 8) & 0xff, ia) << 8 |
+	      over(s & 0xff, d & 0xff, ia);
+	*dst = (res & ~keep) | (d & keep);
+    }
+}
+
+static void blend16_long(u16 *dst, const u32 *src, u32 n)
+{
+    u32 s, d, ia, r, g, b;
+
+    for (; n--; dst++, src++) {
+	s = *src;
+	if (!s)
+	    continue;
+	d = *dst;
+	ia = 255-(s >> 24);
+	r = d >> 11;
+	g = (d >> 5) & 0x3f;
+	b = d & 0x1f;
+	r = over((s >> 16) & 0xff, r << 3 | r >> 2, ia);
+	g = over((s >> 8) & 0xff, g << 2 | g >> 4, ia);
+	b = over(s & 0xff, b << 3 | b >> 2, ia);
+	*dst = (r >> 3) << 11 | (g >> 2) << 5 | b >> 3;
+    }
+}
+
+
+#ifdef HAVE_SSE2
+    /*
+     *  SSE2, 4 ARGB8888 or 8 RGB565 pixels at a time, with the components in
+     *  16-bit lanes
+     */
+
+static inline __m128i div255_sse2(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+static inline __m128i over_sse2(__m128i s, __m128i d, __m128i ia)
+{
+    return _mm_add_epi16(s, div255_sse2(_mm_mullo_epi16(d, ia)));
+}
+
+    /* 2 pixels, with the alpha of each pixel copied to all its lanes */
+static inline __m128i over2_sse2(__m128i s, __m128i d)
+{
+    __m128i ia = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+
+    return over_sse2(s, d, _mm_xor_si128(ia, _mm_set1_epi16(0xff)));
+}
+
+static void blend32_sse2(u32 *dst, const u32 *src, u32 n, u32 keep)
+{
+    __m128i zero = _mm_setzero_si128(), k = _mm_set1_epi32(keep);
+    __m128i opaque = _mm_set1_epi32(0xff000000);
+    __m128i s, d, lo, hi, res;
+
+    for (; n >= 4; n -= 4, dst += 4, src += 4) {
+	s = _mm_loadu_si128((const __m128i *)src);
+	if (_mm_movemask_epi8(_mm_cmpeq_epi32(s, zero)) == 0xffff)
+	    continue;
+	d = _mm_loadu_si128((const __m128i *)dst);
+	if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(s, opaque),
+					      opaque)) == 0xffff) {
+	    res = s;
+	} else {
+	    lo = over2_sse2(_mm_unpacklo_epi8(s, zero),
+			    _mm_unpacklo_epi8(d, zero));
+	    hi = over2_sse2(_mm_unpackhi_epi8(s, zero),
+			    _mm_unpackhi_epi8(d, zero));
+	    res = _mm_packus_epi16(lo, hi);
+	}
+	res = _mm_or_si128(_mm_andnot_si128(k, res), _mm_and_si128(k, d));
+	_mm_storeu_si128((__m128i *)dst, res);
+    }
+    blend32_long(dst, src, n, keep);
+}
+
+static inline __m128i component_sse2(__m128i s0, __m128i s1, int shift)
+{
+    __m128i mask = _mm_set1_epi32(0xff);
+
+    return _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(s0, shift), mask),
+			   _mm_and_si128(_mm_srli_epi32(s1, shift), mask));
+}
+
+static void blend16_sse2(u16 *dst, const u32 *src, u32 n)
+{
+    __m128i max = _mm_set1_epi16(255);
+    __m128i s0, s1, d, ia, r, g, b;
+
+    for (; n >= 8; n -= 8, dst += 8, src += 8) {
+	s0 = _mm_loadu_si128((const __m128i *)src);
+	s1 = _mm_loadu_si128((const __m128i *)(src+4));
+	d = _mm_loadu_si128((const __m128i *)dst);
+	ia = _mm_xor_si128(component_sse2(s0, s1, 24), max);
+	r = _mm_srli_epi16(d, 11);
+	g = _mm_and_si128(_mm_srli_epi16(d, 5), _mm_set1_epi16(0x3f));
+	b = _mm_and_si128(d, _mm_set1_epi16(0x1f));
+	r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+	g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+	b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+	r = _mm_min_epi16(over_sse2(component_sse2(s0, s1, 16), r, ia), max);
+	g = _mm_min_epi16(over_sse2(component_sse2(s0, s1, 8), g, ia), max);
+	b = _mm_min_epi16(over_sse2(component_sse2(s0, s1, 0), b, ia), max);
+	d = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(r, 3), 11),
+				      _mm_slli_epi16(_mm_srli_epi16(g, 2), 5)),
+			 _mm_srli_epi16(b, 3));
+	_mm_storeu_si128((__m128i *)dst, d);
+    }
+    blend16_long(dst, src, n);
+}
+#endif /* HAVE_SSE2 */
+
+
+#ifdef HAVE_NEON
+    /*
+     *  NEON, 8 pixels at a time, with the components in separate registers
+     */
+
+static inline uint8x8_t over_neon(uint8x8_t s, uint8x8_t d, uint8x8_t ia)
+{
+    uint16x8_t x = vaddq_u16(vmull_u8(d, ia), vdupq_n_u16(128));
+
+    return vqadd_u8(s, vshrn_n_u16(vaddq_u16(x, vshrq_n_u16(x, 8)), 8));
+}
+
+static void blend32_neon(u32 *dst, const u32 *src, u32 n, u32 keep)
+{
+    uint8x8x4_t s, d;
+    uint8x8_t ia, k;
+    int i;
+
+    for (; n >= 8; n -= 8, dst += 8, src += 8) {
+	s = vld4_u8((const u8 *)src);
+	d = vld4_u8((const u8 *)dst);
+	ia = vmvn_u8(s.val[3]);
+	for (i = 0; i < 4; i++) {
+	    k = vdup_n_u8(keep >> (8*i));
+	    d.val[i] = vbsl_u8(k, d.val[i], over_neon(s.val[i], d.val[i], ia));
+	}
+	vst4_u8((u8 *)dst, d);
+    }
+    blend32_long(dst, src, n, keep);
+}
+
+static void blend16_neon(u16 *dst, const u32 *src, u32 n)
+{
+    uint8x8x4_t s;
+    uint8x8_t ia, r, g, b;
+    uint16x8_t d;
+
+    for (; n >= 8; n -= 8, dst += 8, src += 8) {
+	s = vld4_u8((const u8 *)src);
+	d = vld1q_u16(dst);
+	ia = vmvn_u8(s.val[3]);
+	r = vshrn_n_u16(d, 11);
+	g = vand_u8(vshrn_n_u16(d, 5), vdup_n_u8(0x3f));
+	b = vand_u8(vmovn_u16(d), vdup_n_u8(0x1f));
+	r = over_neon(s.val[2], vorr_u8(vshl_n_u8(r, 3), vshr_n_u8(r, 2)), ia);
+	g = over_neon(s.val[1], vorr_u8(vshl_n_u8(g, 2), vshr_n_u8(g, 4)), ia);
+	b = over_neon(s.val[0], vorr_u8(vshl_n_u8(b, 3), vshr_n_u8(b, 2)), ia);
+	d = vorrq_u16(vorrq_u16(vshlq_n_u16(vmovl_u8(vshr_n_u8(r, 3)), 11),
+				vshlq_n_u16(vmovl_u8(vshr_n_u8(g, 2)), 5)),
+		      vmovl_u8(vshr_n_u8(b, 3)));
+	vst1q_u16(dst, d);
+    }
+    blend16_long(dst, src, n);
+}
+#endif /* HAVE_NEON */
+
+
+const char *blend_name(void)
+{
+#if defined(HAVE_SSE2)
+    return "sse2";
+#elif defined(HAVE_NEON)
+    return "neon";
+#else
+    return "long";
+#endif
+}
+
+
+    /*
+     *  Blend n source pixels into n ARGB8888 pixels, keeping the destination
+     *  bits set in keep (e.g. padding bits, if there's no alpha channel)
+     */
+
+void blend32(u32 *dst, const u32 *src, u32 n, u32 keep)
+{
+#if defined(HAVE_SSE2)
+    blend32_sse2(dst, src, n, keep);
+#elif defined(HAVE_NEON)
+    blend32_neon(dst, src, n, keep);
+#else
+    blend32_long(dst, src, n, keep);
+#endif
+}
+
+
+    /*
+     *  Blend n source pixels into n RGB565 pixels
+     */
+
+void blend16(u16 *dst, const u32 *src, u32 n)
+{
+#if defined(HAVE_SSE2)
+    blend16_sse2(dst, src, n);
+#elif defined(HAVE_NEON)
+    blend16_neon(dst, src, n);
+#else
+    blend16_long(dst, src, n);
+#endif
+}
@@ -0,0 +1,121 @@
+
+/*
+ *  Chunky to planar conversion
+ *
+ *  Converts groups of 16 chunky 8-bit pixels to 8 plane words, by
+ *  transposing the 8x8 bit matrices of 8 pixels in a few merge steps. With
+ *  SSE2, the bits of each plane are extracted from 16 pixels at once
+ *  instead.
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include "types.h"
+#include "bitstream.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#ifdef __SSE2__
+#define HAVE_SSE2
+#endif
+#endif
+
+
+#ifdef HAVE_SSE2
+    /*
+     *  After reversing the byte order, the first pixel is in the most
+     *  significant bit of the mask of the byte sign bits, which gives the
+     *  highest plane. Adding the pixels to themselves moves the next plane
+     *  into the sign bits.
+     */
+
+static inline void c2p16(const u8 *src, u16 *planes)
+{
+    __m128i v = _mm_loadu_si128((const __m128i *)src);
+    int i;
+
+    v = _mm_shuffle_epi32(v, 0x1b);
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+    v = _mm_or_si128(_mm_srli_epi16(v, 8), _mm_slli_epi16(v, 8));
+    for (i = 7; i >= 0; i--) {
+	planes[i] = _mm_movemask_epi8(v);
+	v = _mm_add_epi8(v, v);
+    }
+}
+#else
+    /*
+     *  Transpose an 8x8 bit matrix, with the first row in the most
+     *  significant byte, and the first column in the most significant bit of
+     *  each byte
+     */
+
+static inline u64 transpose8(u64 x)
+{
+    u64 t;
+
+    t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaULL;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000cccc0000ccccULL;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ULL;
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+static inline u64 load8(const u8 *src)
+{
+    return (u64)src[0] << 56 | (u64)src[1] << 48 | (u64)src[2] << 40 |
+	   (u64)src[3] << 32 | (u64)src[4] << 24 | (u64)src[5] << 16 |
+	   (u64)src[6] << 8 | src[7];
+}
+
+    /*
+     *  Afterwards, each byte holds one plane of 8 pixels, with the highest
+     *  plane in the most significant byte
+     */
+
+static inline void c2p16(const u8 *src, u16 *planes)
+{
+    u64 hi = transpose8(load8(src)), lo = transpose8(load8(src+8));
+    int i;
+
+    for (i = 0; i < 8; i++)
+	planes[i] = ((hi >> (8*i)) & 0xff) << 8 | ((lo >> (8*i)) & 0xff);
+}
+#endif
+
+
+const char *c2p_name(void)
+{
+#ifdef HAVE_SSE2
+    return "sse2";
+#else
+    return "transpose";
+#endif
+}
+
+
+    /*
+     *  Convert groups of 16 pixels to depth plane words each, with the first
+     *  pixel in the most significant bit. Planes beyond the eighth are zero.
+     */
+
+void c2p(u16 *dst, const u8 *src, u32 groups, u32 depth)
+{
+    u16 planes[8];
+    u32 i;
+
+    if (depth == 8) {
+	for (; groups--; src += 16, dst += 8)
+	    c2p16(src, dst);
+	return;
+    }
+
+    for (; groups--; src += 16, dst += depth) {
+	c2p16(src, planes);
+	for (i = 0; i < depth; i++)
+	    dst[i] = i < 8 ? planes[i] : 0;
+    }
+}
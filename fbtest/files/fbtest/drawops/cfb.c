@@ -8,10 +8,15 @@
  *  more details.
  */
 
+#include <byteswap.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "types.h"
 #include "drawops.h"
 #include "bitstream.h"
 #include "fb.h"
+#include "util.h"
 
 
 #define EXP1(x)		0xffffffffU*x
@@ -32,7 +37,14 @@ static const u32 bpp4tab[16] = {
 };
 
 
-static u32 next_line;
+#define next_line	(fb_current->draw_next_line)
+
+    /*
+     *  Fills covering more bytes than this use non-temporal stores, as they
+     *  would only evict useful data from the cache
+     */
+
+#define NONTEMPORAL_THRESHOLD	(1024*1024)
 
 int cfb_init(void)
 {
@@ -81,22 +93,55 @@ static inline u32 pixel_to_pat32(pixel_t pixel)
 
 
     /*
-     *  Expand a pixel value to a generic 32/64-bit pattern and rotate it to
-     *  the correct start position
+     *  bitfill32() and bitfill() take patterns in big endian order, so pixels
+     *  that are stored in host order must be byte swapped on little endian
+     *  hosts
+     */
+
+static inline u32 pixel_to_bitpat32(pixel_t pixel)
+{
+    u32 pat = pixel_to_pat32(pixel);
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    if (fb_var.bits_per_pixel >= 16)
+	pat = bswap_32(pat);
+#endif
+    return pat;
+}
+
+
+    /*
+     *  Can a fill use the byte aligned memfill32()?
      */
 
-static inline unsigned long pixel_to_pat(pixel_t pixel, int left)
+static inline int cfb_use_memfill(u32 bpp)
+{
+    return (bpp == 8 || bpp == 16 || bpp == 32) && !fb_current->no_simd;
+}
+
+
+    /*
+     *  Expand a pixel value to a generic 32/64-bit pattern and rotate it, so
+     *  a pixel starts at bit dst_idx of the word
+     *
+     *  The pixel is stored most significant byte first, like cfb24_setpixel()
+     *  does
+     */
+
+static inline unsigned long pixel_to_pat(pixel_t pixel, int dst_idx)
 {
     unsigned long pat = pixel;
-    u32 bpp = fb_var.bits_per_pixel;
-    int i;
+    int bpp = fb_var.bits_per_pixel;
+    int i, left;
 
     /* expand pixel value */
     for (i = bpp; i < BITS_PER_LONG; i *= 2)
 	pat |= pat << i;
 
     /* rotate pattern to correct start position */
-    pat = pat << left | pat >> (bpp-left);
+    left = (BITS_PER_LONG % bpp + bpp - dst_idx % bpp) % bpp;
+    if (left)
+	pat = pat << left | pat >> (bpp-left);
     return pat;
 }
 
@@ -107,25 +152,30 @@ void cfb_draw_hline(u32 x, u32 y, u32 length, pixel_t pixel)
     int dst_idx, left, right;
     u32 bpp = fb_var.bits_per_pixel;
 
-    dst = (unsigned long *)((unsigned long)fb & ~(BYTES_PER_LONG-1));
-    dst_idx = ((unsigned long)fb & (BYTES_PER_LONG-1))*8;
+    if (cfb_use_memfill(bpp)) {
+	memfill32(fb_current->fb+y*next_line+x*bpp/8, pixel_to_pat32(pixel),
+		  length*bpp/8, 0);
+	return;
+    }
+    if (bpp == 24 && !fb_current->no_simd) {
+	memfill24(fb_current->fb+y*next_line+x*3, pixel, length*3, 0);
+	return;
+    }
+
+    dst = (unsigned long *)((unsigned long)fb_current->fb &
+			    ~(BYTES_PER_LONG-1));
+    dst_idx = ((unsigned long)fb_current->fb & (BYTES_PER_LONG-1))*8;
     dst_idx += y*next_line*8+x*bpp;
     dst += dst_idx >> SHIFT_PER_LONG;
     dst_idx &= (BITS_PER_LONG-1);
     /* FIXME For now we support 1-32 bpp only */
     left = BITS_PER_LONG % bpp;
     if (!left) {
-	u32 pat = pixel_to_pat32(pixel);
+	u32 pat = pixel_to_bitpat32(pixel);
 	bitfill32(dst, dst_idx, pat, length*bpp);
     } else {
-	unsigned long pat;
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-	right = left;
-	left = bpp-left;
-#else
+	unsigned long pat = pixel_to_pat(pixel, dst_idx);
 	right = bpp-left;
-#endif
-	pat = pixel_to_pat(pixel, (left-dst_idx) % bpp);
 	bitfill(dst, dst_idx, pat, left, right, length*bpp);
     }
 }
@@ -136,13 +186,34 @@ void cfb_fill_rect(u32 x, u32 y, u32 width, u32 height, pixel_t pixel)
     int dst_idx, left, right;
     u32 bpp = fb_var.bits_per_pixel;
 
-    dst = (unsigned long *)((unsigned long)fb & ~(BYTES_PER_LONG-1));
-    dst_idx = ((unsigned long)fb & (BYTES_PER_LONG-1))*8;
+    if (cfb_use_memfill(bpp)) {
+	u8 *p = fb_current->fb+y*next_line+x*bpp/8;
+	u32 pat = pixel_to_pat32(pixel);
+	u32 n = width*bpp/8;
+	int nontemporal = n*height > NONTEMPORAL_THRESHOLD;
+
+	for (; height--; p += next_line)
+	    memfill32(p, pat, n, nontemporal);
+	return;
+    }
+    if (bpp == 24 && !fb_current->no_simd) {
+	u8 *p = fb_current->fb+y*next_line+x*3;
+	u32 n = width*3;
+	int nontemporal = n*height > NONTEMPORAL_THRESHOLD;
+
+	for (; height--; p += next_line)
+	    memfill24(p, pixel, n, nontemporal);
+	return;
+    }
+
+    dst = (unsigned long *)((unsigned long)fb_current->fb &
+			    ~(BYTES_PER_LONG-1));
+    dst_idx = ((unsigned long)fb_current->fb & (BYTES_PER_LONG-1))*8;
     dst_idx += y*next_line*8+x*bpp;
     /* FIXME For now we support 1-32 bpp only */
     left = BITS_PER_LONG % bpp;
     if (!left) {
-	u32 pat = pixel_to_pat32(pixel);
+	u32 pat = pixel_to_bitpat32(pixel);
 	while (height--) {
 	    dst += dst_idx >> SHIFT_PER_LONG;
 	    dst_idx &= (BITS_PER_LONG-1);
@@ -150,26 +221,395 @@ void cfb_fill_rect(u32 x, u32 y, u32 width, u32 height, pixel_t pixel)
 	    dst_idx += next_line*8;
 	}
     } else {
-	unsigned long pat;
-	int r;
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-	right = left;
-	left = bpp-left;
-#else
 	right = bpp-left;
-#endif
-	pat = pixel_to_pat(pixel, (left-dst_idx) % bpp);
 	while (height--) {
 	    dst += dst_idx >> SHIFT_PER_LONG;
 	    dst_idx &= (BITS_PER_LONG-1);
-	    bitfill(dst, dst_idx, pat, left, right, width*bpp);
-	    r = (next_line*8) % bpp;
-	    pat = pat << (bpp-r) | pat >> r;
+	    bitfill(dst, dst_idx, pixel_to_pat(pixel, dst_idx), left, right,
+		    width*bpp);
 	    dst_idx += next_line*8;
 	}
     }
 }
 
+    /*
+     *  Set up a line for pointer stepping, no multiplications are needed
+     *  per pixel
+     */
+
+int cfb_line_init(struct cfb_line *line, u32 x1, u32 y1, u32 x2, u32 y2,
+		  pixel_t pixel)
+{
+    long bytes = fb_var.bits_per_pixel/8;
+    int dx = x2-x1, dy = y2-y1;
+    long sx = bytes, sy = next_line;
+
+    if (!dy) {
+	(fb_drawops.draw_hline)(min(x1, x2), y1, abs(dx)+1, pixel);
+	return 0;
+    }
+
+    if (dx < 0) {
+	dx = -dx;
+	sx = -sx;
+    }
+    if (dy < 0) {
+	dy = -dy;
+	sy = -sy;
+    }
+    line->dst = fb_current->fb+y1*next_line+x1*bytes;
+    if (dx > dy) {
+	line->major = sx;
+	line->minor = sy;
+	line->dmajor = dx;
+	line->dminor = dy;
+    } else {
+	line->major = sy;
+	line->minor = dx ? sx : 0;
+	line->dmajor = dy;
+	line->dminor = dx;
+    }
+    line->length = line->dmajor;
+    return 1;
+}
+
+
+    /*
+     *  Lines at 1, 2 and 4 bpp
+     *
+     *  The pixels of the line are collected in a mask as long as they stay
+     *  in the same byte, so each byte is read and written once.
+     */
+
+static inline u8 cfb_pixel_mask(u32 x, u32 bpp)
+{
+    return ((1 << bpp)-1) << (8-bpp-(x*bpp & 7));
+}
+
+void cfb_draw_line(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel)
+{
+    u32 bpp = fb_var.bits_per_pixel;
+    int dx = x2-x1, dy = y2-y1, sx = dx > 0 ? 1 : dx < 0 ? -1 : 0;
+    int xmajor, dmajor, dminor, e;
+    long sy = next_line;
+    u32 x = x1, length;
+    u8 pat = pixel_to_pat32(pixel), mask, *row, *p, *q;
+
+    if (!dy) {
+	(fb_drawops.draw_hline)(min(x1, x2), y1, abs(dx)+1, pixel);
+	return;
+    }
+
+    dx = abs(dx);
+    if (dy < 0) {
+	dy = -dy;
+	sy = -sy;
+    }
+    xmajor = dx > dy;
+    dmajor = xmajor ? dx : dy;
+    dminor = xmajor ? dy : dx;
+    row = fb_current->fb+y1*next_line;
+    p = row+x*bpp/8;
+    mask = cfb_pixel_mask(x, bpp);
+    e = -dmajor/2;
+    for (length = dmajor; length--;) {
+	e += dminor;
+	if (e >= 0) {
+	    if (xmajor)
+		row += sy;
+	    else
+		x += sx;
+	    e -= dmajor;
+	}
+	if (xmajor)
+	    x += sx;
+	else
+	    row += sy;
+	q = row+x*bpp/8;
+	if (q != p) {
+	    *p = (pat & mask) | (*p & ~mask);
+	    p = q;
+	    mask = 0;
+	}
+	mask |= cfb_pixel_mask(x, bpp);
+    }
+    *p = (pat & mask) | (*p & ~mask);
+}
+
+
+    /*
+     *  Spans of packed pixels at 1, 2 and 4 bpp are collected in a register,
+     *  and written 32 bits at a time. Only the first and last bytes of a span
+     *  are merged with the frame buffer contents.
+     */
+
+struct cfb_bits {
+    u8 *dst;
+    u64 acc;		/* pending bits are the n least significant bits */
+    u32 n;
+};
+
+static inline void cfb_bits_begin(struct cfb_bits *bits, u8 *dst, u32 bit)
+{
+    bits->dst = dst;
+    bits->acc = bit ? *dst >> (8-bit) : 0;
+    bits->n = bit;
+}
+
+    /*
+     *  Append the n least significant bits of val, n <= 32
+     */
+
+static inline void cfb_bits_put(struct cfb_bits *bits, u32 val, u32 n)
+{
+    u32 word;
+
+    bits->acc = bits->acc << n | val;
+    bits->n += n;
+    if (bits->n >= 32) {
+	bits->n -= 32;
+	word = bits->acc >> bits->n;
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	word = bswap_32(word);
+#endif
+	memcpy(bits->dst, &word, 4);
+	bits->dst += 4;
+    }
+}
+
+static inline void cfb_bits_end(struct cfb_bits *bits)
+{
+    u8 *dst = bits->dst;
+    u32 n = bits->n;
+
+    for (; n >= 8; n -= 8)
+	*dst++ = bits->acc >> (n-8);
+    if (n)
+	*dst = bits->acc << (8-n) | (*dst & (0xff >> n));
+}
+
+static inline void cfb_pixmap_line(u8 *dst, u32 bit, const pixel_t *pixmap,
+				   u32 width, u32 bpp)
+{
+    struct cfb_bits bits;
+    u32 mask = (1 << bpp)-1, val, i, j;
+
+    cfb_bits_begin(&bits, dst, bit);
+    for (i = 0; i+32/bpp <= width; i += 32/bpp) {
+	for (val = 0, j = 0; j < 32/bpp; j++)
+	    val = val << bpp | (pixmap[i+j] & mask);
+	cfb_bits_put(&bits, val, 32);
+    }
+    for (; i < width; i++)
+	cfb_bits_put(&bits, pixmap[i] & mask, bpp);
+    cfb_bits_end(&bits);
+}
+
+void cfb_draw_pixmap(u32 x, u32 y, u32 width, u32 height,
+		     const pixel_t *pixmap)
+{
+    u32 bpp = fb_var.bits_per_pixel;
+    u8 *dst = fb_current->fb+y*next_line+x*bpp/8;
+    u32 bit = x*bpp & 7;
+
+    /* Constant depths, so the inner loops are unrolled */
+    for (; height--; dst += next_line, pixmap += width)
+	switch (bpp) {
+	    case 1:
+		cfb_pixmap_line(dst, bit, pixmap, width, 1);
+		break;
+
+	    case 2:
+		cfb_pixmap_line(dst, bit, pixmap, width, 2);
+		break;
+
+	    case 4:
+		cfb_pixmap_line(dst, bit, pixmap, width, 4);
+		break;
+	}
+}
+
+
+    /*
+     *  Monochrome bitmap expansion
+     *
+     *  Each nibble of the bitmap selects one of 16 precomputed patterns of 4
+     *  pixels in frame buffer layout, which is copied as a whole. At 1, 2 and
+     *  4 bpp, the packed patterns are appended to a span instead. The
+     *  patterns are kept in the context, and are only rebuilt when the
+     *  colors change.
+     */
+
+#define expand_tab	(fb_current->expand_tab)
+
+static void cfb_expand_tab_init(pixel_t pixel0, pixel_t pixel1, u32 bpp)
+{
+    u32 bytes = bpp/8;
+    pixel_t pixel;
+    u8 *dst;
+    int i, j;
+
+    for (i = 0; i < 16; i++) {
+	dst = (u8 *)expand_tab[i];
+	expand_tab[i][0] = 0;
+	for (j = 0; j < 4; j++, dst += bytes) {
+	    pixel = i & (8 >> j) ? pixel1 : pixel0;
+	    switch (bpp) {
+		case 1:
+		case 2:
+		case 4:
+		    /* Packed, the first pixel in the most significant bits */
+		    expand_tab[i][0] = expand_tab[i][0] << bpp |
+				       (pixel & ((1 << bpp)-1));
+		    break;
+
+		case 8:
+		    dst[0] = pixel;
+		    break;
+
+		case 16:
+		    *(u16 *)dst = pixel;
+		    break;
+
+		case 24:
+		    dst[0] = (pixel >> 16) & 0xff;
+		    dst[1] = (pixel >> 8) & 0xff;
+		    dst[2] = pixel & 0xff;
+		    break;
+
+		case 32:
+		    *(u32 *)dst = pixel;
+		    break;
+	    }
+	}
+    }
+    fb_current->expand_pixel0 = pixel0;
+    fb_current->expand_pixel1 = pixel1;
+    fb_current->expand_bpp = bpp;
+}
+
+static inline void cfb_expand_line(u8 *dst, const u8 *data, u32 width,
+				   const u32 (*tab)[4], u32 bytes)
+{
+    u32 n = 4*bytes;
+    u8 bits;
+
+    for (; width >= 8; width -= 8, dst += 2*n) {
+	bits = *data++;
+	memcpy(dst, tab[bits >> 4], n);
+	memcpy(dst+n, tab[bits & 15], n);
+    }
+    if (width) {
+	bits = *data;
+	if (width >= 4) {
+	    memcpy(dst, tab[bits >> 4], n);
+	    dst += n;
+	    width -= 4;
+	    bits <<= 4;
+	}
+	memcpy(dst, tab[bits >> 4], width*bytes);
+    }
+}
+
+static inline void cfb_expand_line_packed(u8 *dst, u32 bit, const u8 *data,
+					  u32 width, const u32 (*tab)[4],
+					  u32 bpp)
+{
+    struct cfb_bits bits;
+    u32 val;
+
+    cfb_bits_begin(&bits, dst, bit);
+    for (; width >= 8; width -= 8) {
+	val = *data++;
+	cfb_bits_put(&bits, tab[val >> 4][0] << 4*bpp | tab[val & 15][0],
+		     8*bpp);
+    }
+    if (width) {
+	val = *data;
+	val = tab[val >> 4][0] << 4*bpp | tab[val & 15][0];
+	cfb_bits_put(&bits, val >> (8-width)*bpp, width*bpp);
+    }
+    cfb_bits_end(&bits);
+}
+
+void cfb_expand_bitmap(u32 x, u32 y, u32 width, u32 height, const u8 *data,
+		       u32 pitch, pixel_t pixel0, pixel_t pixel1)
+{
+    u32 bpp = fb_var.bits_per_pixel;
+    u8 *dst = fb_current->fb+y*next_line+x*bpp/8;
+    const u32 (*tab)[4] = expand_tab;
+
+    if (bpp % 8 && 8 % bpp) {
+	generic_expand_bitmap(x, y, width, height, data, pitch, pixel0,
+			      pixel1);
+	return;
+    }
+
+    if (fb_current->expand_bpp != bpp ||
+	fb_current->expand_pixel0 != pixel0 ||
+	fb_current->expand_pixel1 != pixel1)
+	cfb_expand_tab_init(pixel0, pixel1, bpp);
+
+    /* Constant sizes, so the copies become single loads and stores */
+    for (; height--; dst += next_line, data += pitch)
+	switch (bpp) {
+	    case 1:
+		cfb_expand_line_packed(dst, x & 7, data, width, tab, 1);
+		break;
+
+	    case 2:
+		cfb_expand_line_packed(dst, 2*x & 7, data, width, tab, 2);
+		break;
+
+	    case 4:
+		cfb_expand_line_packed(dst, 4*x & 7, data, width, tab, 4);
+		break;
+
+	    case 8:
+		cfb_expand_line(dst, data, width, tab, 1);
+		break;
+
+	    case 16:
+		cfb_expand_line(dst, data, width, tab, 2);
+		break;
+
+	    case 24:
+		cfb_expand_line(dst, data, width, tab, 3);
+		break;
+
+	    case 32:
+		cfb_expand_line(dst, data, width, tab, 4);
+		break;
+	}
+}
+
+    /*
+     *  Copy a rectangle at 8, 16, 24 or 32 bpp, using memcopy() per line
+     */
+
+static void cfb_copy_rect_bytes(u32 dx, u32 dy, u32 width, u32 height,
+				u32 sx, u32 sy)
+{
+    u32 bytes = fb_var.bits_per_pixel/8;
+    u32 n = width*bytes;
+    u8 *dst = fb_current->fb+dy*next_line+dx*bytes;
+    const u8 *src = fb_current->fb+sy*next_line+sx*bytes;
+
+    if (n == next_line) {
+	/* Full lines, the rectangle is contiguous */
+	memcopy(dst, src, height*n);
+    } else if (dy > sy) {
+	/* Overlapping downwards, start at the bottom */
+	dst += (height-1)*next_line;
+	src += (height-1)*next_line;
+	for (; height--; dst -= next_line, src -= next_line)
+	    memcopy(dst, src, n);
+    } else {
+	for (; height--; dst += next_line, src += next_line)
+	    memcopy(dst, src, n);
+    }
+}
+
 void cfb_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx, u32 sy)
 {
     unsigned long *dst, *src;
@@ -177,13 +617,19 @@ void cfb_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx, u32 sy)
     u32 bpp = fb_var.bits_per_pixel;
     int rev_copy = 0;
 
+    if (!(bpp % 8) && !fb_current->no_simd) {
+	cfb_copy_rect_bytes(dx, dy, width, height, sx, sy);
+	return;
+    }
+
     if (dy > sy || (dy == sy && dx > sx)) {
 	dy += height;
 	sy += height;
 	rev_copy = 1;
     }
-    dst = src = (unsigned long *)((unsigned long)fb & ~(BYTES_PER_LONG-1));
-    dst_idx = src_idx = ((unsigned long)fb & (BYTES_PER_LONG-1))*8;
+    dst = src = (unsigned long *)((unsigned long)fb_current->fb &
+				  ~(BYTES_PER_LONG-1));
+    dst_idx = src_idx = ((unsigned long)fb_current->fb & (BYTES_PER_LONG-1))*8;
     dst_idx += dy*next_line*8+dx*bpp;
     src_idx += sy*next_line*8+sx*bpp;
     if (rev_copy) {
@@ -209,3 +655,108 @@ void cfb_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx, u32 sy)
     }
 }
 
+
+
+    /*
+     *  Porter-Duff source over compositing
+     *
+     *  Only RGB565, RGB888 and (A)RGB8888 are handled here, everything else
+     *  is left to the generic routines. RGB888 is converted to and from
+     *  ARGB8888 in chunks.
+     */
+
+#define BLEND_CHUNK	256	/* pixels */
+
+static int cfb_blend_layout(u32 bpp)
+{
+    if (fb_current->no_simd || fb_var.bits_per_pixel != bpp ||
+	(fb_fix.visual != FB_VISUAL_TRUECOLOR &&
+	 fb_fix.visual != FB_VISUAL_DIRECTCOLOR))
+	return 0;
+
+    if (bpp == 16)
+	return fb_var.red.offset == 11 && fb_var.red.length == 5 &&
+	       fb_var.green.offset == 5 && fb_var.green.length == 6 &&
+	       fb_var.blue.offset == 0 && fb_var.blue.length == 5 &&
+	       !fb_var.transp.length;
+
+    return fb_var.red.offset == 16 && fb_var.red.length == 8 &&
+	   fb_var.green.offset == 8 && fb_var.green.length == 8 &&
+	   fb_var.blue.offset == 0 && fb_var.blue.length == 8 &&
+	   (!fb_var.transp.length ||
+	    (bpp == 32 && fb_var.transp.offset == 24 &&
+	     fb_var.transp.length == 8));
+}
+
+static void cfb_blend_line(u8 *dst, const u32 *src, u32 n)
+{
+    u32 buf[BLEND_CHUNK];
+    u32 i, chunk;
+    u8 *p;
+
+    switch (fb_var.bits_per_pixel) {
+	case 16:
+	    blend16((u16 *)dst, src, n);
+	    break;
+
+	case 24:
+	    for (; n; n -= chunk, src += chunk) {
+		chunk = min(n, (u32)BLEND_CHUNK);
+		for (i = 0, p = dst; i < chunk; i++, p += 3)
+		    buf[i] = p[0] << 16 | p[1] << 8 | p[2];
+		blend32(buf, src, chunk, 0xff000000);
+		for (i = 0; i < chunk; i++) {
+		    *dst++ = buf[i] >> 16;
+		    *dst++ = buf[i] >> 8;
+		    *dst++ = buf[i];
+		}
+	    }
+	    break;
+
+	case 32:
+	    blend32((u32 *)dst, src, n,
+		    fb_var.transp.length ? 0 : 0xff000000);
+	    break;
+    }
+}
+
+void cfb_blend_rect(u32 x, u32 y, u32 width, u32 height, u32 argb)
+{
+    u32 bpp = fb_var.bits_per_pixel;
+    u32 buf[BLEND_CHUNK];
+    u32 i, n, chunk;
+    u8 *dst;
+
+    if (!cfb_blend_layout(bpp)) {
+	generic_blend_rect(x, y, width, height, argb);
+	return;
+    }
+    if (!argb)
+	return;
+
+    for (i = 0; i < BLEND_CHUNK; i++)
+	buf[i] = argb;
+    for (dst = fb_current->fb+y*next_line+x*bpp/8; height--; dst += next_line)
+	for (n = 0; n < width; n += chunk) {
+	    chunk = min(width-n, (u32)BLEND_CHUNK);
+	    cfb_blend_line(dst+n*bpp/8, buf, chunk);
+	}
+}
+
+void cfb_blend_pixmap(u32 x, u32 y, u32 width, u32 height, const u32 *argb)
+{
+    u32 bpp = fb_var.bits_per_pixel;
+    u8 *dst;
+
+    if (!cfb_blend_layout(bpp)) {
+	generic_blend_pixmap(x, y, width, height, argb);
+	return;
+    }
+
+    dst = fb_current->fb+y*next_line+x*bpp/8;
+    while (height--) {
+	cfb_blend_line(dst, argb, width);
+	dst += next_line;
+	argb += width;
+    }
+}
@@ -14,15 +14,15 @@
 #include "fb.h"
 
 
-static u16 *screen;
-static u32 screen_width;
+#define screen		((u16 *)fb_current->draw_screen)
+#define screen_width	(fb_current->draw_width)
 
 static int cfb16_init(void)
 {
     if (fb_fix.type != FB_TYPE_PACKED_PIXELS || fb_var.bits_per_pixel != 16)
 	return 0;
 
-    screen = (u16 *)fb;
+    fb_current->draw_screen = fb_current->fb;
     screen_width = fb_fix.line_length ? fb_fix.line_length/2
 				      : fb_var.xres_virtual;
     return cfb_init();
@@ -38,13 +38,88 @@ static pixel_t cfb16_getpixel(u32 x, u32 y)
     return screen[y*screen_width+x];
 }
 
+static void cfb16_draw_pixmap(u32 x, u32 y, u32 width, u32 height,
+			      const pixel_t *pixmap)
+{
+    u16 *dst = &screen[y*screen_width+x];
+    u32 i;
+
+    while (height--) {
+	for (i = 0; i < width; i++)
+	    dst[i] = pixmap[i];
+	dst += screen_width;
+	pixmap += width;
+    }
+}
+
+static void cfb16_draw_line(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel)
+{
+    struct cfb_line line;
+    u8 *dst;
+    int e;
+
+    if (!cfb_line_init(&line, x1, y1, x2, y2, pixel))
+	return;
+
+    dst = line.dst;
+    e = -line.dmajor/2;
+    *(u16 *)dst = pixel;
+    while (line.length--) {
+	e += line.dminor;
+	if (e >= 0) {
+	    dst += line.minor;
+	    e -= line.dmajor;
+	}
+	dst += line.major;
+	*(u16 *)dst = pixel;
+    }
+}
+
+static void cfb16_draw_vline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    u16 *dst = &screen[y*screen_width+x];
+
+    while (length--) {
+	*dst = pixel;
+	dst += screen_width;
+    }
+}
+
+    /*
+     *  The top and bottom lines are filled, both sides are drawn in a single
+     *  pass
+     */
+
+static void cfb16_draw_rect(u32 x, u32 y, u32 width, u32 height,
+			    pixel_t pixel)
+{
+    u16 *dst;
+
+    if (width < 2 || height < 3) {
+	generic_draw_rect(x, y, width, height, pixel);
+	return;
+    }
+    cfb_draw_hline(x, y, width, pixel);
+    cfb_draw_hline(x, y+height-1, width, pixel);
+    dst = &screen[(y+1)*screen_width+x];
+    for (height -= 2; height--; dst += screen_width)
+	dst[0] = dst[width-1] = pixel;
+}
+
 const struct drawops cfb16_drawops = {
     .name =		"cfb16 (16 bpp packed pixels)",
     .init =		cfb16_init,
     .set_pixel =	cfb16_setpixel,
     .get_pixel =	cfb16_getpixel,
     .draw_hline =	cfb_draw_hline,
+    .draw_vline =	cfb16_draw_vline,
+    .draw_rect =	cfb16_draw_rect,
     .fill_rect =	cfb_fill_rect,
+    .draw_line =	cfb16_draw_line,
+    .expand_bitmap =	cfb_expand_bitmap,
+    .draw_pixmap =	cfb16_draw_pixmap,
     .copy_rect =	cfb_copy_rect,
+    .blend_rect =	cfb_blend_rect,
+    .blend_pixmap =	cfb_blend_pixmap,
 };
 
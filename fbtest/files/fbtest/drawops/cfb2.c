@@ -15,15 +15,15 @@
 #include "util.h"
 
 
-static u8 *screen;
-static u32 screen_width;
+#define screen		(fb_current->draw_screen)
+#define screen_width	(fb_current->draw_width)
 
 static int cfb2_init(void)
 {
     if (fb_fix.type != FB_TYPE_PACKED_PIXELS || fb_var.bits_per_pixel != 2)
 	return 0;
 
-    screen = fb;
+    fb_current->draw_screen = fb_current->fb;
     screen_width = fb_fix.line_length ? fb_fix.line_length
 				      : fb_var.xres_virtual/4;
     return cfb_init();
@@ -42,13 +42,30 @@ static pixel_t cfb2_getpixel(u32 x, u32 y)
     return (screen[y*screen_width+x/4] >> (2*(3- (x & 3)))) & 3;
 }
 
+static void cfb2_draw_vline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    int shift = 2*(3- (x & 3));
+    u8 *p = &screen[y*screen_width+x/4];
+    u8 mask = 3 << shift, bits = pixel << shift;
+    u32 stride = screen_width;
+
+    while (length--) {
+	*p = bits | (*p & ~mask);
+	p += stride;
+    }
+}
+
 const struct drawops cfb2_drawops = {
     .name =		"cfb2 (2 bpp packed pixels)",
     .init =		cfb2_init,
     .set_pixel =	cfb2_setpixel,
     .get_pixel =	cfb2_getpixel,
     .draw_hline =	cfb_draw_hline,
+    .draw_vline =	cfb2_draw_vline,
     .fill_rect =	cfb_fill_rect,
+    .draw_line =	cfb_draw_line,
+    .expand_bitmap =	cfb_expand_bitmap,
+    .draw_pixmap =	cfb_draw_pixmap,
     .copy_rect =	cfb_copy_rect,
 };
 
@@ -9,20 +9,23 @@
  *  more details.
  */
 
+#include <byteswap.h>
+#include <string.h>
+
 #include "types.h"
 #include "drawops.h"
 #include "fb.h"
 
 
-static u8 *screen;
-static u32 screen_width;
+#define screen		(fb_current->draw_screen)
+#define screen_width	(fb_current->draw_width)
 
 static int cfb24_init(void)
 {
     if (fb_fix.type != FB_TYPE_PACKED_PIXELS || fb_var.bits_per_pixel != 24)
 	return 0;
 
-    screen = fb;
+    fb_current->draw_screen = fb_current->fb;
     screen_width = fb_fix.line_length ? fb_fix.line_length
 				      : fb_var.xres_virtual*3;
     return cfb_init();
@@ -46,13 +49,143 @@ static pixel_t cfb24_getpixel(u32 x, u32 y)
     return (src[0] << 16) | (src[1] << 8) | src[2];
 }
 
+static inline void put_u32(u8 *p, u32 val)
+{
+    memcpy(p, &val, 4);
+}
+
+    /*
+     *  Pack 4 pixels into 3 words in memory order, most significant byte
+     *  first
+     */
+
+static inline void pack4(u8 *dst, const pixel_t *src)
+{
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    u32 a = bswap_32(src[0]) >> 8, b = bswap_32(src[1]) >> 8;
+    u32 c = bswap_32(src[2]) >> 8, d = bswap_32(src[3]) >> 8;
+
+    put_u32(dst, a | b << 24);
+    put_u32(dst+4, b >> 8 | c << 16);
+    put_u32(dst+8, c >> 16 | d << 8);
+#else
+    u32 a = src[0] << 8, b = src[1] << 8, c = src[2] << 8, d = src[3] << 8;
+
+    put_u32(dst, a | b >> 24);
+    put_u32(dst+4, b << 8 | c >> 16);
+    put_u32(dst+8, c << 16 | d >> 8);
+#endif
+}
+
+static void cfb24_draw_pixmap(u32 x, u32 y, u32 width, u32 height,
+			      const pixel_t *pixmap)
+{
+    u8 *dst = &screen[y*screen_width+x*3];
+    pixel_t pixel;
+    u32 i;
+    u32 stride = screen_width;
+
+    while (height--) {
+	for (i = 0; i+4 <= width; i += 4)
+	    pack4(dst+3*i, pixmap+i);
+	for (; i < width; i++) {
+	    pixel = pixmap[i];
+	    dst[3*i] = (pixel >> 16) & 0xff;
+	    dst[3*i+1] = (pixel >> 8) & 0xff;
+	    dst[3*i+2] = pixel & 0xff;
+	}
+	dst += stride;
+	pixmap += width;
+    }
+}
+
+static void cfb24_draw_vline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    u8 *dst, b0, b1, b2;
+    u32 stride = screen_width;
+
+    dst = &screen[y*screen_width+x*3];
+    b0 = (pixel >> 16) & 0xff;
+    b1 = (pixel >> 8) & 0xff;
+    b2 = pixel & 0xff;
+    while (length--) {
+	dst[0] = b0;
+	dst[1] = b1;
+	dst[2] = b2;
+	dst += stride;
+    }
+}
+
+    /*
+     *  The top and bottom lines are filled, both sides are drawn in a single
+     *  pass
+     */
+
+static void cfb24_draw_rect(u32 x, u32 y, u32 width, u32 height,
+			    pixel_t pixel)
+{
+    u8 *dst, b0, b1, b2;
+    u32 right = (width-1)*3;
+    u32 stride = screen_width;
+
+    if (width < 2 || height < 3) {
+	generic_draw_rect(x, y, width, height, pixel);
+	return;
+    }
+    cfb_draw_hline(x, y, width, pixel);
+    cfb_draw_hline(x, y+height-1, width, pixel);
+    dst = &screen[(y+1)*screen_width+x*3];
+    b0 = (pixel >> 16) & 0xff;
+    b1 = (pixel >> 8) & 0xff;
+    b2 = pixel & 0xff;
+    for (height -= 2; height--; dst += stride) {
+	dst[0] = dst[right] = b0;
+	dst[1] = dst[right+1] = b1;
+	dst[2] = dst[right+2] = b2;
+    }
+}
+
+static void cfb24_draw_line(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel)
+{
+    struct cfb_line line;
+    u8 *dst;
+    int e;
+
+    if (!cfb_line_init(&line, x1, y1, x2, y2, pixel))
+	return;
+
+    dst = line.dst;
+    e = -line.dmajor/2;
+    dst[0] = (pixel >> 16) & 0xff;
+    dst[1] = (pixel >> 8) & 0xff;
+    dst[2] = pixel & 0xff;
+    while (line.length--) {
+	e += line.dminor;
+	if (e >= 0) {
+	    dst += line.minor;
+	    e -= line.dmajor;
+	}
+	dst += line.major;
+	dst[0] = (pixel >> 16) & 0xff;
+	dst[1] = (pixel >> 8) & 0xff;
+	dst[2] = pixel & 0xff;
+    }
+}
+
 const struct drawops cfb24_drawops = {
     .name =		"cfb24 (24 bpp packed pixels)",
     .init =		cfb24_init,
     .set_pixel =	cfb24_setpixel,
     .get_pixel =	cfb24_getpixel,
     .draw_hline =	cfb_draw_hline,
+    .draw_vline =	cfb24_draw_vline,
+    .draw_rect =	cfb24_draw_rect,
     .fill_rect =	cfb_fill_rect,
+    .draw_line =	cfb24_draw_line,
+    .expand_bitmap =	cfb_expand_bitmap,
+    .draw_pixmap =	cfb24_draw_pixmap,
     .copy_rect =	cfb_copy_rect,
+    .blend_rect =	cfb_blend_rect,
+    .blend_pixmap =	cfb_blend_pixmap,
 };
 
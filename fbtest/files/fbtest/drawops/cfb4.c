@@ -15,15 +15,15 @@
 #include "util.h"
 
 
-static u8 *screen;
-static u32 screen_width;
+#define screen		(fb_current->draw_screen)
+#define screen_width	(fb_current->draw_width)
 
 static int cfb4_init(void)
 {
     if (fb_fix.type != FB_TYPE_PACKED_PIXELS || fb_var.bits_per_pixel != 4)
 	return 0;
 
-    screen = fb;
+    fb_current->draw_screen = fb_current->fb;
     screen_width = fb_fix.line_length ? fb_fix.line_length
 				      : fb_var.xres_virtual/2;
     return cfb_init();
@@ -44,13 +44,29 @@ static pixel_t cfb4_getpixel(u32 x, u32 y)
     return (x & 1) ? (d & 0x0f) : (d >> 4);
 }
 
+static void cfb4_draw_vline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    u8 *p = &screen[y*screen_width+x/2];
+    u8 mask = x & 1 ? 0x0f : 0xf0, bits = x & 1 ? pixel : pixel << 4;
+    u32 stride = screen_width;
+
+    while (length--) {
+	*p = bits | (*p & ~mask);
+	p += stride;
+    }
+}
+
 const struct drawops cfb4_drawops = {
     .name =		"cfb4 (4 bpp packed pixels)",
     .init =		cfb4_init,
     .set_pixel =	cfb4_setpixel,
     .get_pixel =	cfb4_getpixel,
     .draw_hline =	cfb_draw_hline,
+    .draw_vline =	cfb4_draw_vline,
     .fill_rect =	cfb_fill_rect,
+    .draw_line =	cfb_draw_line,
+    .expand_bitmap =	cfb_expand_bitmap,
+    .draw_pixmap =	cfb_draw_pixmap,
     .copy_rect =	cfb_copy_rect,
 };
 
@@ -11,18 +11,19 @@
 
 #include "types.h"
 #include "drawops.h"
+#include "bitstream.h"
 #include "fb.h"
 
 
-static u8 *screen;
-static u32 screen_width;
+#define screen		(fb_current->draw_screen)
+#define screen_width	(fb_current->draw_width)
 
 static int cfb8_init(void)
 {
     if (fb_fix.type != FB_TYPE_PACKED_PIXELS || fb_var.bits_per_pixel != 8)
 	return 0;
 
-    screen = fb;
+    fb_current->draw_screen = fb_current->fb;
     screen_width = fb_fix.line_length ? fb_fix.line_length
 				      : fb_var.xres_virtual;
     return cfb_init();
@@ -38,13 +39,100 @@ static pixel_t cfb8_getpixel(u32 x, u32 y)
     return screen[y*screen_width+x];
 }
 
+static void cfb8_draw_pixmap(u32 x, u32 y, u32 width, u32 height,
+			     const pixel_t *pixmap)
+{
+    u8 *dst = &screen[y*screen_width+x];
+    u32 i;
+    u32 stride = screen_width;
+
+    while (height--) {
+	for (i = 0; i < width; i++)
+	    dst[i] = pixmap[i];
+	dst += stride;
+	pixmap += width;
+    }
+}
+
+static void cfb8_draw_chunky(u32 x, u32 y, u32 width, u32 height,
+			     const u8 *data, u32 pitch)
+{
+    u8 *dst = &screen[y*screen_width+x];
+    u32 stride = screen_width;
+
+    for (; height--; dst += stride, data += pitch)
+	memcopy(dst, data, width);
+}
+
+static void cfb8_draw_line(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel)
+{
+    struct cfb_line line;
+    u8 *dst;
+    int e;
+
+    if (!cfb_line_init(&line, x1, y1, x2, y2, pixel))
+	return;
+
+    dst = line.dst;
+    e = -line.dmajor/2;
+    *dst = pixel;
+    while (line.length--) {
+	e += line.dminor;
+	if (e >= 0) {
+	    dst += line.minor;
+	    e -= line.dmajor;
+	}
+	dst += line.major;
+	*dst = pixel;
+    }
+}
+
+static void cfb8_draw_vline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    u8 *dst = &screen[y*screen_width+x];
+    u32 stride = screen_width;
+
+    while (length--) {
+	*dst = pixel;
+	dst += stride;
+    }
+}
+
+    /*
+     *  The top and bottom lines are filled, both sides are drawn in a single
+     *  pass
+     */
+
+static void cfb8_draw_rect(u32 x, u32 y, u32 width, u32 height,
+			   pixel_t pixel)
+{
+    u8 *dst;
+    u32 stride = screen_width;
+
+    if (width < 2 || height < 3) {
+	generic_draw_rect(x, y, width, height, pixel);
+	return;
+    }
+    cfb_draw_hline(x, y, width, pixel);
+    cfb_draw_hline(x, y+height-1, width, pixel);
+    dst = &screen[(y+1)*screen_width+x];
+    for (height -= 2; height--; dst += stride)
+	dst[0] = dst[width-1] = pixel;
+}
+
 const struct drawops cfb8_drawops = {
     .name =		"cfb8 (8 bpp packed pixels)",
     .init =		cfb8_init,
     .set_pixel =	cfb8_setpixel,
     .get_pixel =	cfb8_getpixel,
     .draw_hline =	cfb_draw_hline,
+    .draw_vline =	cfb8_draw_vline,
+    .draw_rect =	cfb8_draw_rect,
     .fill_rect =	cfb_fill_rect,
+    .draw_line =	cfb8_draw_line,
+    .expand_bitmap =	cfb_expand_bitmap,
+    .draw_pixmap =	cfb8_draw_pixmap,
+    .draw_chunky =	cfb8_draw_chunky,
     .copy_rect =	cfb_copy_rect,
 };
 
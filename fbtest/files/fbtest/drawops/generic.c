@@ -8,6 +8,13 @@
  *  more details.
  */
 
+#define DRAWOPS		fb_drawops
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "types.h"
 #include "drawops.h"
 #include "fb.h"
@@ -66,12 +73,19 @@ void generic_fill_rect(u32 x, u32 y, u32 width, u32 height, pixel_t pixel)
 
 
     /*
-     *  Draw a line using the Bresenham algorithm for lines
+     *  Draw a line using a run-slice version of the Bresenham algorithm
+     *
+     *  Instead of deciding for every pixel whether to step along the minor
+     *  axis, the length of each run of pixels along the major axis is derived
+     *  incrementally from the quotient and remainder of major/minor, and runs
+     *  are drawn using draw_hline() or draw_vline(). The pixels are the same
+     *  as with a plain Bresenham algorithm, with an error term starting at
+     *  -major/2.
      */
 
 void generic_draw_line(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel)
 {
-    int dx, dy, sx, sy, e;
+    int dx, dy, sx, sy, major, minor, q, r, c, rem, start, next, j;
 
     dx = x2-x1;
     dy = y2-y1;
@@ -81,49 +95,60 @@ void generic_draw_line(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel)
 	    x1 = x2;
 	}
 	draw_hline(x1, y1, dx+1, pixel);
+	return;
     } else if (dx == 0) {
 	if (dy < 0) {
 	    dy = -dy;
 	    y1 = y2;
 	}
 	draw_vline(x1, y1, dy+1, pixel);
+	return;
+    }
+
+    if (dy < 0) {
+	dy = -dy;
+	sy = -1;
     } else {
-	if (dy < 0) {
-	    dy = -dy;
-	    sy = -1;
-	} else {
-	    sy = 1;
-	}
-	if (dx < 0) {
-	    dx = -dx;
-	    sx = -1;
+	sy = 1;
+    }
+    if (dx < 0) {
+	dx = -dx;
+	sx = -1;
+    } else {
+	sx = 1;
+    }
+    major = max(dx, dy);
+    minor = min(dx, dy);
+    q = major/minor;
+    r = major%minor;
+
+    /*
+     *  Run j > 0 starts at pixel ceil(((j-1)*major+major/2)/minor), c is the
+     *  start of the next run, and rem = c*minor-((j-1)*major+major/2)
+     */
+    c = (major/2+minor-1)/minor;
+    rem = c*minor-major/2;
+    next = max(c, 1);
+    for (j = 0, start = 0; j <= minor; j++) {
+	if (dx > dy) {
+	    draw_hline(sx > 0 ? x1+start : x1-next+1, y1, next-start, pixel);
+	    y1 += sy;
 	} else {
-	    sx = 1;
+	    draw_vline(x1, sy > 0 ? y1+start : y1-next+1, next-start, pixel);
+	    x1 += sx;
 	}
-	if (dx > dy) {
-	    e = -dx/2;
-	    set_pixel(x1, y1, pixel);
-	    while (x1 != x2) {
-		e += dy;
-		if (e >= 0) {
-		    y1 += sy;
-		    e -= dx;
-		}
-		x1 += sx;
-		set_pixel(x1, y1, pixel);
+	start = next;
+	if (j+1 < minor) {
+	    c += q;
+	    if (r > rem) {
+		c++;
+		rem += minor-r;
+	    } else {
+		rem -= r;
 	    }
+	    next = c;
 	} else {
-	    e = -dy/2;
-	    set_pixel(x1, y1, pixel);
-	    while (y1 != y2) {
-		e += dx;
-		if (e >= 0) {
-		    x1 += sx;
-		    e -= dy;
-		}
-		y1 += sy;
-		set_pixel(x1, y1, pixel);
-	    }
+	    next = major+1;
 	}
     }
 }
@@ -182,93 +207,106 @@ void generic_draw_pixmap(u32 x, u32 y, u32 width, u32 height,
 
 
     /*
-     *  Draw a circle using the differential version of the midpoint algorithm
-     *
-     *  Cfr. Computer Graphics: Principles and Practices, Second Edition in C,
-     *  Foley et al., 1997, p. 87
+     *  Draw a chunky 8-bit pixmap
      */
 
-static void draw_circle_points(u32 cx, u32 cy, u32 x, u32 y, pixel_t pixel)
+void generic_draw_chunky(u32 x, u32 y, u32 width, u32 height, const u8 *data,
+			 u32 pitch)
 {
-    if (x == 0) {
-	set_pixel(cx, cy-y, pixel);
-	set_pixel(cx-y, cy, pixel);
-	set_pixel(cx+y, cy, pixel);
-	set_pixel(cx, cy+y, pixel);
-    } else {
-	set_pixel(cx-x, cy-y, pixel);
-	set_pixel(cx+x, cy-y, pixel);
-	set_pixel(cx-x, cy+y, pixel);
-	set_pixel(cx+x, cy+y, pixel);
-	if (x < y) {
-	    set_pixel(cx-y, cy-x, pixel);
-	    set_pixel(cx+y, cy-x, pixel);
-	    set_pixel(cx-y, cy+x, pixel);
-	    set_pixel(cx+y, cy+x, pixel);
-	}
-    }
+    u32 i;
+
+    for (; height--; y++, data += pitch)
+	for (i = 0; i < width; i++)
+	    set_pixel(x+i, y, data[i]);
 }
 
-void generic_draw_circle(u32 x, u32 y, u32 r, pixel_t pixel)
-{
-    u32 x1 = 0;
-    u32 y1 = r;
-    int d = 1-r;
-    int de = 3;
-    int dse = -2*r+5;
 
-    do {
-	draw_circle_points(x, y, x1, y1, pixel);
-	if (d < 0) {	// Select E
-	    d += de;
-	    de += 2;
-	    dse += 2;
-	} else {	// Select SE
-	    d += dse;
-	    de += 2;
-	    dse += 4;
-	    y1--;
-	}
-	x1++;
-    } while (x1 <= y1);
+    /*
+     *  Fill a list of spans
+     */
+
+void generic_fill_spans(const struct span *spans, u32 num, pixel_t pixel)
+{
+    for (; num--; spans++)
+	draw_hline(spans->x, spans->y, spans->length, pixel);
 }
 
 
     /*
-     *  Draw a filled circle
+     *  Span lists
+     *
+     *  Filled shapes collect their spans, and hand them to fill_spans() in
+     *  batches
      */
 
-static void fill_circle_points_x(u32 cx, u32 cy, u32 x, u32 y, pixel_t pixel)
+#define SPAN_BATCH	128
+
+struct span_list {
+    struct span spans[SPAN_BATCH];
+    u32 num;
+    pixel_t pixel;
+};
+
+static void span_flush(struct span_list *list)
 {
-    if (x == 0) {
-	set_pixel(cx, cy-y, pixel);
-	set_pixel(cx, cy+y, pixel);
-    } else {
-	draw_hline(cx-x, cy-y, 2*x+1, pixel);
-	draw_hline(cx-x, cy+y, 2*x+1, pixel);
-    }
+    if (list->num)
+	fill_spans(list->spans, list->num, list->pixel);
+    list->num = 0;
 }
 
-static void fill_circle_points_y(u32 cx, u32 cy, u32 x, u32 y, pixel_t pixel)
+static inline void span_add(struct span_list *list, u32 x, u32 y, u32 length)
 {
-    if (x == 0)
-	draw_hline(cx-y, cy, 2*y+1, pixel);
-    else {
-	draw_hline(cx-y, cy-x, 2*y+1, pixel);
-	draw_hline(cx-y, cy+x, 2*y+1, pixel);
-    }
+    struct span *span;
+
+    if (list->num == SPAN_BATCH)
+	span_flush(list);
+    span = &list->spans[list->num++];
+    span->x = x;
+    span->y = y;
+    span->length = length;
+}
+
+    /*
+     *  Add the spans of half width dx, dy lines above and below the center
+     */
+
+static inline void span_add_pair(struct span_list *list, u32 cx, u32 cy,
+				 u32 dx, u32 dy)
+{
+    span_add(list, cx-dx, cy-dy, 2*dx+1);
+    if (dy)
+	span_add(list, cx-dx, cy+dy, 2*dx+1);
 }
 
+
+    /*
+     *  Circle and ellipse outlines, drawn using the frame buffer level line
+     *  operations
+     */
+
+#define NAME(op)			generic_ ## op
+#define HLINE(x, y, length, pixel)	draw_hline((x), (y), (length), (pixel))
+#define VLINE(x, y, length, pixel)	draw_vline((x), (y), (length), (pixel))
+#include "outline.h"
+
+
+    /*
+     *  Draw a filled circle
+     */
+
 void generic_fill_circle(u32 x, u32 y, u32 r, pixel_t pixel)
 {
-    u32 x1 = 0;
-    u32 y1 = r;
+    struct span_list list;
+    int x1 = 0;
+    int y1 = r;
     int d = 1-r;
     int de = 3;
     int dse = -2*r+5;
 
+    list.num = 0;
+    list.pixel = pixel;
     do {
-	fill_circle_points_y(x, y, x1, y1, pixel);
+	span_add_pair(&list, x, y, y1, x1);
 	if (d < 0) {	// Select E
 	    d += de;
 	    de += 2;
@@ -278,42 +316,31 @@ void generic_fill_circle(u32 x, u32 y, u32 r, pixel_t pixel)
 	    de += 2;
 	    dse += 4;
 	    if (x1 != y1)
-		fill_circle_points_x(x, y, x1, y1, pixel);
+		span_add_pair(&list, x, y, x1, y1);
 	    y1--;
 	}
 	x1++;
     } while (x1 <= y1);
+    span_flush(&list);
 }
 
 
     /*
-     *  Draw an ellipse using a differential version of the Bresenham algorithm
-     *  for ellipses
+     *  Draw a filled ellipse
      */
 
-static void draw_ellipse_points(u32 cx, u32 cy, u32 x, u32 y, pixel_t pixel)
+void generic_fill_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
 {
-    if (x == 0) {
-	set_pixel(cx, cy-y, pixel);
-	set_pixel(cx, cy+y, pixel);
-    } else if (0 == y) {
-	set_pixel(cx-x, cy, pixel);
-	set_pixel(cx+x, cy, pixel);
-    } else {
-	set_pixel(cx-x, cy-y, pixel);
-	set_pixel(cx+x, cy-y, pixel);
-	set_pixel(cx-x, cy+y, pixel);
-	set_pixel(cx+x, cy+y, pixel);
-    }
-}
+    struct span_list list;
 
-void generic_draw_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
-{
     if (a == b)
-	draw_circle(x, y, a, pixel);
+	fill_circle(x, y, a, pixel);
     else {
 	u32 a2 = a*a;
 	u32 b2 = b*b;
+
+	list.num = 0;
+	list.pixel = pixel;
 	if (a <= b) {
 	    u32 x1 = 0;
 	    u32 y1 = b;
@@ -324,8 +351,7 @@ void generic_draw_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
 	    int dS2 = -4*a2*(b-1);
 	    int dT2 = dS2+2*a2;
 
-	    draw_ellipse_points(x, y, x1, y1, pixel);
-	    do {
+	    while (1) {
 		if (S < 0) {
 		    S += dS1;
 		    T += dT1;
@@ -333,6 +359,9 @@ void generic_draw_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
 		    dT1 += 4*b2;
 		    x1++;
 		} else if (T < 0) {
+		    span_add_pair(&list, x, y, x1, y1);
+		    if (y1 == 0)
+			break;
 		    S += dS1+dS2;
 		    T += dT1+dT2;
 		    dS1 += 4*b2;
@@ -342,14 +371,16 @@ void generic_draw_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
 		    x1++;
 		    y1--;
 		} else {
+		    span_add_pair(&list, x, y, x1, y1);
+		    if (y1 == 0)
+			break;
 		    S += dS2;
 		    T += dT2;
 		    dS2 += 4*a2;
 		    dT2 += 4*a2;
 		    y1--;
 		}
-		draw_ellipse_points(x, y, x1, y1, pixel);
-	    } while (y1 > 0);
+	    }
 	} else {
 	    u32 x1 = a;
 	    u32 y1 = 0;
@@ -360,7 +391,7 @@ void generic_draw_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
             int dS2 = -4*b2*(a-1);
             int dT2 = dS2+2*b2;
 
-	    draw_ellipse_points(x, y, x1, y1, pixel);
+	    span_add_pair(&list, x, y, x1, y1);
 	    do {
 		if (S < 0) {
 		    S += dS1;
@@ -368,6 +399,7 @@ void generic_draw_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
 		    dS1 += 4*a2;
 		    dT1 += 4*a2;
 		    y1++;
+		    span_add_pair(&list, x, y, x1, y1);
 		} else if (T < 0) {
 		    S += dS1+dS2;
 		    T += dT1+dT2;
@@ -376,7 +408,10 @@ void generic_draw_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
 		    dS2 += 4*b2;
 		    dT2 += 4*b2;
 		    x1--;
+		    if (x1 < 0)
+			break;
 		    y1++;
+		    span_add_pair(&list, x, y, x1, y1);
 		} else {
 		    S += dS2;
 		    T += dT2;
@@ -384,118 +419,263 @@ void generic_draw_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
 		    dT2 += 4*b2;
 		    x1--;
 		}
-		draw_ellipse_points(x, y, x1, y1, pixel);
 	    } while (x1 > 0);
 	}
+	span_flush(&list);
     }
 }
 
 
     /*
-     *  Draw a filled ellipse
+     *  Polygons
+     *
+     *  Vertices are at the top left corners of pixels, and a pixel is filled
+     *  if its top left corner is inside the polygon, or on a left or top edge.
+     *  Hence the polygon (x, y), (x+w, y), (x+w, y+h), (x, y+h) covers the
+     *  same pixels as fill_rect(x, y, w, h).
+     *
+     *  Edges are stepped one line at a time, using exact integer arithmetic:
+     *  an edge crosses the current line at x+frac/dy, and moves step+rem/dy
+     *  pixels per line.
      */
 
-static void fill_ellipse_points(u32 cx, u32 cy, u32 x, u32 y, pixel_t pixel)
+#define POLYGON_EDGES	64	/* edges without allocating memory */
+
+struct edge {
+    int y0, y1;		/* lines covered, y0 <= y < y1 */
+    int x, frac;
+    int step, rem, dy;
+    int dir;		/* 1 if the edge goes down, -1 if it goes up */
+};
+
+static void edge_init(struct edge *e, const struct point *a,
+		      const struct point *b)
 {
-    if (x == 0) {
-	set_pixel(cx, cy-y, pixel);
-	set_pixel(cx, cy+y, pixel);
-    } else if (y == 0) {
-	draw_hline(cx-x, cy, 2*x+1, pixel);
-    } else {
-	draw_hline(cx-x, cy-y, 2*x+1, pixel);
-	draw_hline(cx-x, cy+y, 2*x+1, pixel);
+    const struct point *p;
+    int dx;
+
+    e->dir = 1;
+    if ((int)a->y > (int)b->y) {
+	p = a;
+	a = b;
+	b = p;
+	e->dir = -1;
+    }
+    e->y0 = a->y;
+    e->y1 = b->y;
+    e->x = a->x;
+    e->frac = 0;
+    e->dy = e->y1-e->y0;
+    dx = (int)b->x-(int)a->x;
+    e->step = dx/e->dy;
+    e->rem = dx%e->dy;
+    if (e->rem < 0) {
+	e->step--;
+	e->rem += e->dy;
     }
 }
 
-void generic_fill_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
+static inline void edge_step(struct edge *e)
 {
-    if (a == b)
-	fill_circle(x, y, a, pixel);
-    else {
-	u32 a2 = a*a;
-	u32 b2 = b*b;
-	if (a <= b) {
-	    u32 x1 = 0;
-	    u32 y1 = b;
-	    int S = a2*(1-2*b)+2*b2;
-	    int T = b2-2*a2*(2*b-1);
-	    int dT1 = 4*b2;
-	    int dS1 = dT1+2*b2;
-	    int dS2 = -4*a2*(b-1);
-	    int dT2 = dS2+2*a2;
+    e->x += e->step;
+    e->frac += e->rem;
+    if (e->frac >= e->dy) {
+	e->frac -= e->dy;
+	e->x++;
+    }
+}
 
-	    while (1) {
-		if (S < 0) {
-		    S += dS1;
-		    T += dT1;
-		    dS1 += 4*b2;
-		    dT1 += 4*b2;
-		    x1++;
-		} else if (T < 0) {
-		    fill_ellipse_points(x, y, x1, y1, pixel);
-		    if (y1 == 0)
-			break;
-		    S += dS1+dS2;
-		    T += dT1+dT2;
-		    dS1 += 4*b2;
-		    dT1 += 4*b2;
-		    dS2 += 4*a2;
-		    dT2 += 4*a2;
-		    x1++;
-		    y1--;
-		} else {
-		    fill_ellipse_points(x, y, x1, y1, pixel);
-		    if (y1 == 0)
-			break;
-		    S += dS2;
-		    T += dT2;
-		    dS2 += 4*a2;
-		    dT2 += 4*a2;
-		    y1--;
-		}
-	    }
-	} else {
-	    u32 x1 = a;
-	    u32 y1 = 0;
-            int S = b2*(1-2*a)+2*a2;
-            int T = a2-2*b2*(2*a-1);
-            int dT1 = 4*a2;
-            int dS1 = dT1+2*a2;
-            int dS2 = -4*b2*(a-1);
-            int dT2 = dS2+2*b2;
+    /* The first pixel at or right of the crossing */
+static inline int edge_x(const struct edge *e)
+{
+    return e->x+(e->frac > 0);
+}
 
-	    fill_ellipse_points(x, y, x1, y1, pixel);
-	    do {
-		if (S < 0) {
-		    S += dS1;
-		    T += dT1;
-		    dS1 += 4*a2;
-		    dT1 += 4*a2;
-		    y1++;
-		    fill_ellipse_points(x, y, x1, y1, pixel);
-		} else if (T < 0) {
-		    S += dS1+dS2;
-		    T += dT1+dT2;
-		    dS1 += 4*a2;
-		    dT1 += 4*a2;
-		    dS2 += 4*b2;
-		    dT2 += 4*b2;
-		    x1--;
-		    if (x1 < 0)
-			break;
-		    y1++;
-		    fill_ellipse_points(x, y, x1, y1, pixel);
-		} else {
-		    S += dS2;
-		    T += dT2;
-		    dS2 += 4*b2;
-		    dT2 += 4*b2;
-		    x1--;
+static int edge_cmp(const void *a, const void *b)
+{
+    return ((const struct edge *)a)->y0-((const struct edge *)b)->y0;
+}
+
+    /*
+     *  Check whether each line crosses the polygon at most twice, i.e. the
+     *  vertices go down once and up once, like for all convex polygons. Find
+     *  the top vertex, too.
+     */
+
+static int polygon_monotone(const struct point *points, u32 num, u32 *top)
+{
+    int dy, first = 0, prev = 0, changes = 0;
+    u32 i;
+
+    for (i = 0, *top = 0; i < num; i++) {
+	if ((int)points[i].y < (int)points[*top].y)
+	    *top = i;
+	dy = (int)points[(i+1) % num].y-(int)points[i].y;
+	if (!dy)
+	    continue;
+	dy = dy > 0 ? 1 : -1;
+	if (!first)
+	    first = dy;
+	else if (dy != prev)
+	    changes++;
+	prev = dy;
+    }
+    return changes+(prev != first) <= 2;
+}
+
+    /*
+     *  Monotone polygons consist of two chains of edges going down from the
+     *  top vertex, one following the vertices forward, the other backwards
+     */
+
+struct chain {
+    struct edge edge;
+    u32 i;		/* vertex at the bottom of the edge */
+    int dir;		/* 1 or -1 */
+};
+
+    /* Find the edge of the chain starting at line y, 0 at the bottom */
+static int chain_next(struct chain *c, const struct point *points, u32 num,
+		      int y)
+{
+    u32 i, n;
+
+    for (n = 0; n < num; n++) {
+	i = (c->i+num+c->dir) % num;
+	if ((int)points[i].y < (int)points[c->i].y)
+	    return 0;
+	if ((int)points[i].y > y) {
+	    edge_init(&c->edge, &points[c->i], &points[i]);
+	    c->i = i;
+	    return 1;
+	}
+	c->i = i;
+    }
+    return 0;
+}
+
+static void fill_monotone(struct span_list *list, const struct point *points,
+			  u32 num, u32 top)
+{
+    struct chain a, b;
+    int y = points[top].y, xa, xb;
+
+    a.i = b.i = top;
+    a.dir = 1;
+    b.dir = -1;
+    if (!chain_next(&a, points, num, y) || !chain_next(&b, points, num, y))
+	return;
+
+    while (1) {
+	xa = edge_x(&a.edge);
+	xb = edge_x(&b.edge);
+	if (xa < xb)
+	    span_add(list, xa, y, xb-xa);
+	else if (xb < xa)
+	    span_add(list, xb, y, xa-xb);
+	y++;
+	if (y < a.edge.y1)
+	    edge_step(&a.edge);
+	else if (!chain_next(&a, points, num, y))
+	    break;
+	if (y < b.edge.y1)
+	    edge_step(&b.edge);
+	else if (!chain_next(&b, points, num, y))
+	    break;
+    }
+}
+
+    /*
+     *  Other polygons use an edge table, sorted by top line, and a list of
+     *  the edges crossing the current line, sorted by crossing
+     */
+
+static void fill_general(struct span_list *list, const struct point *points,
+			 u32 num, enum fill_rule rule)
+{
+    struct edge edge_buf[POLYGON_EDGES], *edges = edge_buf, *e;
+    struct edge *active_buf[POLYGON_EDGES], **active = active_buf;
+    u32 i, j, k, n, nactive;
+    int y, x, start, end, wind, in, mask;
+
+    if (num > POLYGON_EDGES) {
+	edges = malloc(num*(sizeof(*edges)+sizeof(*active)));
+	if (!edges)
+	    Fatal("malloc %zu: %s\n", num*(sizeof(*edges)+sizeof(*active)),
+		  strerror(errno));
+	active = (struct edge **)(edges+num);
+    }
+
+    for (i = 0, n = 0; i < num; i++)
+	if (points[i].y != points[(i+1) % num].y)
+	    edge_init(&edges[n++], &points[i], &points[(i+1) % num]);
+    qsort(edges, n, sizeof(*edges), edge_cmp);
+
+    /* Even-odd looks at the lowest bit of the winding number only */
+    mask = rule == FILL_EVEN_ODD ? 1 : ~0;
+    for (y = 0, i = 0, nactive = 0; i < n || nactive; y++) {
+	if (!nactive)
+	    y = edges[i].y0;
+	while (i < n && edges[i].y0 == y)
+	    active[nactive++] = &edges[i++];
+
+	/* Crossings hardly ever change order, so insertion sort is fast */
+	for (j = 1; j < nactive; j++) {
+	    e = active[j];
+	    x = edge_x(e);
+	    for (k = j; k > 0 && edge_x(active[k-1]) > x; k--)
+		active[k] = active[k-1];
+	    active[k] = e;
+	}
+
+	/* Touching spans are merged */
+	start = end = INT_MIN;
+	for (j = 0, wind = 0; j < nactive; j++) {
+	    x = edge_x(active[j]);
+	    in = wind & mask;
+	    wind += active[j]->dir;
+	    if (!in && (wind & mask)) {
+		if (x > end) {
+		    if (end > start)
+			span_add(list, start, y, end-start);
+		    start = x;
 		}
-	    } while (x1 > 0);
+	    } else if (in && !(wind & mask)) {
+		end = x;
+	    }
 	}
+	if (end > start)
+	    span_add(list, start, y, end-start);
+
+	for (j = 0, k = 0; j < nactive; j++) {
+	    if (active[j]->y1 == y+1)
+		continue;
+	    edge_step(active[j]);
+	    active[k++] = active[j];
+	}
+	nactive = k;
     }
+
+    if (edges != edge_buf)
+	free(edges);
+}
+
+void generic_fill_polygon(const struct point *points, u32 num,
+			  enum fill_rule rule, pixel_t pixel)
+{
+    struct span_list list;
+    u32 top;
+
+    if (num < 3)
+	return;
+
+    list.num = 0;
+    list.pixel = pixel;
+    if (polygon_monotone(points, num, &top))
+	fill_monotone(&list, points, num, top);
+    else
+	fill_general(&list, points, num, rule);
+    span_flush(&list);
 }
 
 
@@ -534,3 +714,68 @@ void generic_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx, u32 sy)
     }
 }
 
+
+
+    /*
+     *  Porter-Duff source over compositing
+     *
+     *  Each pixel is split in its components, according to the bitfields in
+     *  fb_var, which are scaled to 8 bits for blending, and back.
+     */
+
+static inline pixel_t blend_component(pixel_t d, u32 s, u32 ia,
+				      const struct fb_bitfield *field)
+{
+    u32 len = field->length, mask, v, v8, x;
+    int shift;
+
+    if (!len)
+	return d;
+    mask = len >= 32 ? ~0U : (1U << len)-1;
+    v = (d >> field->offset) & mask;
+    for (v8 = 0, shift = 8; shift > 0; shift -= len)
+	v8 |= shift >= (int)len ? v << (shift-len) : v >> (len-shift);
+    x = v8*ia+128;
+    v8 = s+((x+(x >> 8)) >> 8);
+    if (v8 > 255)
+	v8 = 255;
+    if (len <= 8)
+	v = v8 >> (8-len);
+    else
+	for (v = 0, shift = len-8; shift > -8; shift -= 8)
+	    v |= shift >= 0 ? v8 << shift : v8 >> -shift;
+    return (d & ~((pixel_t)mask << field->offset)) |
+	   (pixel_t)(v & mask) << field->offset;
+}
+
+static pixel_t blend_pixel(pixel_t d, u32 s)
+{
+    u32 ia = 255-(s >> 24);
+
+    d = blend_component(d, (s >> 16) & 0xff, ia, &fb_var.red);
+    d = blend_component(d, (s >> 8) & 0xff, ia, &fb_var.green);
+    d = blend_component(d, s & 0xff, ia, &fb_var.blue);
+    return blend_component(d, s >> 24, ia, &fb_var.transp);
+}
+
+void generic_blend_rect(u32 x, u32 y, u32 width, u32 height, u32 argb)
+{
+    u32 x0;
+
+    if (!argb)
+	return;
+    for (; height--; y++)
+	for (x0 = x; x0 < x+width; x0++)
+	    set_pixel(x0, y, blend_pixel(get_pixel(x0, y), argb));
+}
+
+void generic_blend_pixmap(u32 x, u32 y, u32 width, u32 height,
+			  const u32 *argb)
+{
+    u32 x0;
+
+    for (; height--; y++)
+	for (x0 = x; x0 < x+width; x0++, argb++)
+	    if (*argb)
+		set_pixel(x0, y, blend_pixel(get_pixel(x0, y), *argb));
+}
@@ -9,7 +9,12 @@
  *  more details.
  */
 
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "types.h"
+#include "fb.h"
 #include "drawops.h"
 #include "util.h"
 
@@ -32,40 +37,52 @@ static const struct drawops *all_drawops[] = {
 
 
     /*
-     *  Current drawing operations
+     *  Initialization
      */
 
-struct drawops drawops;
-
-
     /*
-     *  Initialization
+     *  Operations missing from the frame buffer format use the generic ones,
+     *  specialized for the depth if possible
      */
 
-#define PRESENT_OR_SET_GENERIC(op)		\
-    if (!drawops.op)			\
-	drawops.op = generic_ ## op;
+#define PRESENT_OR_SET_GENERIC(op)				\
+    if (!fb_drawops.op)						\
+	fb_drawops.op = spec && spec->op ? spec->op : generic_ ## op;
 
 void drawops_init(void)
 {
+    const struct drawops *spec;
     int i;
 
+    /* The application and frame buffer level operations */
+    if (!fb_current->drawops &&
+	!(fb_current->drawops = calloc(2, sizeof(struct drawops))))
+	Fatal("calloc %zu: %s\n", 2*sizeof(struct drawops), strerror(errno));
+    fb_current->fbops = fb_current->drawops+1;
+
     for (i = 0; all_drawops[i]; i++)
 	if (all_drawops[i]->init()) {
-	    drawops = *all_drawops[i];
+	    fb_drawops = *all_drawops[i];
+	    spec = packed_drawops();
 	    PRESENT_OR_SET_GENERIC(draw_hline);
 	    PRESENT_OR_SET_GENERIC(draw_vline);
 	    PRESENT_OR_SET_GENERIC(draw_rect);
 	    PRESENT_OR_SET_GENERIC(fill_rect);
+	    PRESENT_OR_SET_GENERIC(fill_spans);
 	    PRESENT_OR_SET_GENERIC(draw_line);
 	    PRESENT_OR_SET_GENERIC(expand_bitmap);
 	    PRESENT_OR_SET_GENERIC(draw_pixmap);
+	    PRESENT_OR_SET_GENERIC(draw_chunky);
 	    PRESENT_OR_SET_GENERIC(draw_circle);
 	    PRESENT_OR_SET_GENERIC(fill_circle);
 	    PRESENT_OR_SET_GENERIC(draw_ellipse);
 	    PRESENT_OR_SET_GENERIC(fill_ellipse);
 	    PRESENT_OR_SET_GENERIC(copy_rect);
-	    Message("Using drawops %s\n", drawops.name);
+	    PRESENT_OR_SET_GENERIC(fill_polygon);
+	    PRESENT_OR_SET_GENERIC(blend_rect);
+	    PRESENT_OR_SET_GENERIC(blend_pixmap);
+	    *fb_current->drawops = fb_drawops;
+	    Message("Using drawops %s\n", fb_drawops.name);
 	    return;
 	}
 
@@ -74,3 +91,73 @@ void drawops_init(void)
 
 #undef PRESENT_OR_SET_GENERIC
 
+
+    /*
+     *  The frame buffer pointer has moved (e.g. to a back buffer), make the
+     *  drawing operations pick up the new address
+     */
+
+void drawops_retarget(void)
+{
+    if (fb_drawops.init && !fb_drawops.init())
+	Fatal("Cannot retarget drawops %s\n", fb_drawops.name);
+}
+
+
+    /*
+     *  Layers
+     */
+
+#define OVERRIDE(op)			\
+    if (layer->op)			\
+	fb_current->drawops->op = layer->op;
+
+void drawops_push_layer(const struct drawops *layer, struct drawops *below)
+{
+    Debug("Pushing drawops layer %s\n", layer->name);
+    *below = *fb_current->drawops;
+    OVERRIDE(set_pixel);
+    OVERRIDE(get_pixel);
+    OVERRIDE(draw_hline);
+    OVERRIDE(draw_vline);
+    OVERRIDE(draw_rect);
+    OVERRIDE(fill_rect);
+    OVERRIDE(fill_spans);
+    OVERRIDE(draw_line);
+    OVERRIDE(expand_bitmap);
+    OVERRIDE(draw_pixmap);
+    OVERRIDE(draw_chunky);
+    OVERRIDE(draw_circle);
+    OVERRIDE(fill_circle);
+    OVERRIDE(draw_ellipse);
+    OVERRIDE(fill_ellipse);
+    OVERRIDE(copy_rect);
+    OVERRIDE(fill_polygon);
+    OVERRIDE(blend_rect);
+    OVERRIDE(blend_pixmap);
+}
+
+#undef OVERRIDE
+
+void drawops_pop_layer(const struct drawops *below)
+{
+    *fb_current->drawops = *below;
+}
+
+#define ON_TOP(op)			\
+    (!layer->op || fb_current->drawops->op == layer->op)
+
+int drawops_layer_on_top(const struct drawops *layer)
+{
+    return ON_TOP(set_pixel) && ON_TOP(get_pixel) && ON_TOP(draw_hline) &&
+	   ON_TOP(draw_vline) && ON_TOP(draw_rect) && ON_TOP(fill_rect) &&
+	   ON_TOP(fill_spans) && ON_TOP(draw_line) && ON_TOP(expand_bitmap) &&
+	   ON_TOP(draw_pixmap) && ON_TOP(draw_chunky) &&
+	   ON_TOP(draw_circle) && ON_TOP(fill_circle) &&
+	   ON_TOP(draw_ellipse) && ON_TOP(fill_ellipse) &&
+	   ON_TOP(copy_rect) && ON_TOP(fill_polygon) && ON_TOP(blend_rect) &&
+	   ON_TOP(blend_pixmap);
+}
+
+#undef ON_TOP
+
@@ -9,21 +9,26 @@
  *  more details.
  */
 
+#include <string.h>
+
 #include "types.h"
 #include "drawops.h"
+#include "bitstream.h"
 #include "fb.h"
 #include "util.h"
 
 
-static u8 *screen;
-static u32 next_line;
+#define screen		(fb_current->draw_screen)
+#define next_line	(fb_current->draw_next_line)
+
+#define PIXMAP_CHUNK	256	/* pixels */
 
 static int iplan2_init(void)
 {
     if (fb_fix.type != FB_TYPE_INTERLEAVED_PLANES || fb_fix.type_aux != 2)
 	return 0;
 
-    screen = fb;
+    fb_current->draw_screen = fb_current->fb;
     next_line = fb_fix.line_length
 	? fb_fix.line_length
 	: fb_var.bits_per_pixel*fb_var.xres_virtual/8;
@@ -61,10 +66,233 @@ static pixel_t iplan2_getpixel(u32 x, u32 y)
     }
 }
 
+    /*
+     *  Draw a vertical line, the bits of a pixel are in consecutive words
+     */
+
+static void iplan2_draw_vline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    u16 *p = (u16 *)(screen+y*next_line+fb_var.bits_per_pixel*(x/16*2));
+    u16 mask = 0x8000 >> (x & 15), set[32];
+    u32 bpp = fb_var.bits_per_pixel, i;
+
+    for (i = 0; i < bpp; i++)
+	set[i] = pixel >> i & 1 ? mask : 0;
+    mask = ~mask;
+    while (length--) {
+	for (i = 0; i < bpp; i++)
+	    p[i] = (p[i] & mask) | set[i];
+	p = (u16 *)((u8 *)p+next_line);
+    }
+}
+
+
+    /*
+     *  Groups of 16 pixels consist of one word per plane. Partial groups at
+     *  the start and end of a line are merged using a mask, all other groups
+     *  are written as whole words.
+     */
+
+static inline u16 *iplan2_group(u8 *base, u32 x, u32 y)
+{
+    return (u16 *)(base+y*next_line+fb_var.bits_per_pixel*(x/16*2));
+}
+
+static inline void fill_group(u16 *p, const u16 *set, u16 mask, u32 bpp)
+{
+    u32 i;
+
+    for (i = 0; i < bpp; i++)
+	p[i] = (p[i] & ~mask) | (set[i] & mask);
+}
+
+static void fill_one_line(u16 *p, u32 first, u32 length, const u16 *set)
+{
+    u32 bpp = fb_var.bits_per_pixel, end = first+length, n, i;
+    u16 mask = 0xffff >> first;
+
+    if (end <= 16) {
+	fill_group(p, set, mask & ~(0xffff >> end), bpp);
+	return;
+    }
+    if (first) {
+	fill_group(p, set, mask, bpp);
+	p += bpp;
+    }
+    for (n = end/16-!!first; n--; p += bpp)
+	for (i = 0; i < bpp; i++)
+	    p[i] = set[i];
+    if (end & 15)
+	fill_group(p, set, ~(0xffff >> (end & 15)), bpp);
+}
+
+    /* The fill words of all planes */
+static inline void pixel_to_set(pixel_t pixel, u16 *set)
+{
+    u32 i;
+
+    for (i = 0; i < fb_var.bits_per_pixel; i++)
+	set[i] = pixel >> i & 1 ? 0xffff : 0;
+}
+
+static void iplan2_draw_hline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    u16 set[32];
+
+    pixel_to_set(pixel, set);
+    fill_one_line(iplan2_group(screen, x, y), x & 15, length, set);
+}
+
+static void iplan2_fill_rect(u32 x, u32 y, u32 width, u32 height,
+			     pixel_t pixel)
+{
+    u8 *line = (u8 *)iplan2_group(screen, x, y);
+    u16 set[32];
+
+    pixel_to_set(pixel, set);
+    for (; height--; line += next_line)
+	fill_one_line((u16 *)line, x & 15, width, set);
+}
+
+    /*
+     *  Copies with the same alignment within a group move whole words,
+     *  everything else is left to the generic routine. Full groups are
+     *  contiguous, so they are moved using memcopy().
+     */
+
+static inline void copy_group(u16 *dst, const u16 *src, u16 mask, u32 bpp)
+{
+    u32 i;
+
+    for (i = 0; i < bpp; i++)
+	dst[i] = (dst[i] & ~mask) | (src[i] & mask);
+}
+
+static void copy_one_line(u16 *dst, const u16 *src, u32 first, u32 length,
+			  int rev)
+{
+    u32 bpp = fb_var.bits_per_pixel, end = first+length, n;
+    u16 lmask = 0xffff >> first, rmask = ~(0xffff >> (end & 15));
+    u16 *rdst;
+    const u16 *rsrc;
+
+    if (end <= 16) {
+	copy_group(dst, src, lmask & ~(0xffff >> end), bpp);
+	return;
+    }
+
+    n = end/16-!!first;
+    rdst = dst+(end/16)*bpp;
+    rsrc = src+(end/16)*bpp;
+    if (rev) {
+	/* Overlapping to the right, start at the right */
+	if (end & 15)
+	    copy_group(rdst, rsrc, rmask, bpp);
+	memcopy(dst+(first ? bpp : 0), src+(first ? bpp : 0), n*bpp*2);
+	if (first)
+	    copy_group(dst, src, lmask, bpp);
+    } else {
+	if (first)
+	    copy_group(dst, src, lmask, bpp);
+	memcopy(dst+(first ? bpp : 0), src+(first ? bpp : 0), n*bpp*2);
+	if (end & 15)
+	    copy_group(rdst, rsrc, rmask, bpp);
+    }
+}
+
+static void iplan2_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx,
+			     u32 sy)
+{
+    u8 *dst, *src;
+    long step = next_line;
+    int rev = dy == sy && dx > sx;
+
+    if ((dx ^ sx) & 15) {
+	generic_copy_rect(dx, dy, width, height, sx, sy);
+	return;
+    }
+
+    dst = (u8 *)iplan2_group(screen, dx, dy);
+    src = (u8 *)iplan2_group(screen, sx, sy);
+    if (dy > sy) {
+	/* Overlapping downwards, start at the bottom */
+	dst += (height-1)*next_line;
+	src += (height-1)*next_line;
+	step = -step;
+    }
+    for (; height--; dst += step, src += step)
+	copy_one_line((u16 *)dst, (const u16 *)src, dx & 15, width, rev);
+}
+
+    /*
+     *  Chunky pixels are converted to groups using c2p(), and written like a
+     *  copy. The line buffer starts at the group containing the first pixel.
+     *  Pixmaps with more than 8 planes are left to the generic routine.
+     */
+
+static void write_chunky(u32 x, u32 y, const u8 *line, u32 n)
+{
+    u16 words[(PIXMAP_CHUNK/16+1)*8];
+
+    c2p(words, line, ((x & 15)+n+15)/16, fb_var.bits_per_pixel);
+    copy_one_line(iplan2_group(screen, x, y), words, x & 15, n, 0);
+}
+
+static void iplan2_draw_pixmap(u32 x, u32 y, u32 width, u32 height,
+			       const pixel_t *pixmap)
+{
+    u8 line[PIXMAP_CHUNK+32];
+    u32 n, chunk, first, i;
+
+    if (fb_var.bits_per_pixel > 8) {
+	generic_draw_pixmap(x, y, width, height, pixmap);
+	return;
+    }
+
+    for (; height--; y++)
+	for (n = 0; n < width; n += chunk, pixmap += chunk) {
+	    chunk = min(width-n, (u32)PIXMAP_CHUNK);
+	    first = (x+n) & 15;
+	    for (i = 0; i < chunk; i++)
+		line[first+i] = pixmap[i];
+	    write_chunky(x+n, y, line, chunk);
+	}
+}
+
+static void iplan2_draw_chunky(u32 x, u32 y, u32 width, u32 height,
+			       const u8 *data, u32 pitch)
+{
+    u8 line[PIXMAP_CHUNK+32];
+    u32 n, chunk, first;
+
+    if (fb_var.bits_per_pixel > 8) {
+	generic_draw_chunky(x, y, width, height, data, pitch);
+	return;
+    }
+
+    for (; height--; y++, data += pitch)
+	for (n = 0; n < width; n += chunk) {
+	    chunk = min(width-n, (u32)PIXMAP_CHUNK);
+	    first = (x+n) & 15;
+	    if (first || chunk & 15) {
+		memcpy(line+first, data+n, chunk);
+		write_chunky(x+n, y, line, chunk);
+	    } else {
+		write_chunky(x+n, y, data+n, chunk);
+	    }
+	}
+}
+
 const struct drawops iplan2_drawops = {
     .name =		"iplan2 (Atari interleaved bitplanes)",
     .init =		iplan2_init,
     .set_pixel =	iplan2_setpixel,
     .get_pixel =	iplan2_getpixel,
+    .draw_hline =	iplan2_draw_hline,
+    .draw_vline =	iplan2_draw_vline,
+    .fill_rect =	iplan2_fill_rect,
+    .draw_pixmap =	iplan2_draw_pixmap,
+    .draw_chunky =	iplan2_draw_chunky,
+    .copy_rect =	iplan2_copy_rect,
 };
 
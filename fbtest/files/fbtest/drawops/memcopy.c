@@ -0,0 +1,294 @@
+
+/*
+ *  Byte aligned copy
+ *
+ *  For packed pixel formats with 8, 16, 24 or 32 bits per pixel, all spans
+ *  start on a byte boundary, and a copy is a plain memory copy. This uses
+ *  vector loads and stores (SSE2 or AVX2 on x86, NEON on ARM) instead of the
+ *  shifting and merging in bitcpy() and bitcpy_rev().
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <string.h>
+
+#include "types.h"
+#include "bitstream.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#ifdef __SSE2__
+#define HAVE_SSE2
+#endif
+#if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define HAVE_AVX2
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAVE_NEON
+#endif
+
+
+    /*
+     *  How far ahead of the current position the source is prefetched
+     */
+
+#define PREFETCH_DISTANCE	256
+
+
+    /*
+     *  A copy kernel copies n >= size bytes, with source and destination
+     *  at least size bytes apart. The first and last vectors are loaded up
+     *  front, and written using unaligned stores that overlap with the
+     *  aligned body.
+     */
+
+struct memcopy_kernel {
+    const char *name;
+    u32 size;
+    void (*forward)(u8 *dst, const u8 *src, u32 n);
+    void (*backward)(u8 *dst, const u8 *src, u32 n);
+};
+
+
+#ifdef HAVE_SSE2
+    /*
+     *  SSE2, 16-byte loads and stores
+     */
+
+static void copy_sse2(u8 *dst, const u8 *src, u32 n)
+{
+    __m128i head = _mm_loadu_si128((const __m128i *)src);
+    __m128i tail = _mm_loadu_si128((const __m128i *)(src+n-16));
+    u32 i = 16-((unsigned long)dst & 15), end = n-16;
+    __m128i a, b, c, d;
+
+    _mm_storeu_si128((__m128i *)dst, head);
+    for (; i+64 <= end; i += 64) {
+	__builtin_prefetch(src+i+PREFETCH_DISTANCE);
+	a = _mm_loadu_si128((const __m128i *)(src+i));
+	b = _mm_loadu_si128((const __m128i *)(src+i+16));
+	c = _mm_loadu_si128((const __m128i *)(src+i+32));
+	d = _mm_loadu_si128((const __m128i *)(src+i+48));
+	_mm_store_si128((__m128i *)(dst+i), a);
+	_mm_store_si128((__m128i *)(dst+i+16), b);
+	_mm_store_si128((__m128i *)(dst+i+32), c);
+	_mm_store_si128((__m128i *)(dst+i+48), d);
+    }
+    for (; i < end; i += 16)
+	_mm_store_si128((__m128i *)(dst+i),
+			_mm_loadu_si128((const __m128i *)(src+i)));
+    _mm_storeu_si128((__m128i *)(dst+end), tail);
+}
+
+static void copy_rev_sse2(u8 *dst, const u8 *src, u32 n)
+{
+    __m128i head = _mm_loadu_si128((const __m128i *)src);
+    __m128i tail = _mm_loadu_si128((const __m128i *)(src+n-16));
+    u32 i = (unsigned long)(dst+n) & 15, start = 16;
+    __m128i a, b, c, d;
+
+    _mm_storeu_si128((__m128i *)(dst+n-16), tail);
+    i = n-(i ? i : 16);
+    for (; i >= start+64; i -= 64) {
+	__builtin_prefetch(src+i-PREFETCH_DISTANCE);
+	a = _mm_loadu_si128((const __m128i *)(src+i-16));
+	b = _mm_loadu_si128((const __m128i *)(src+i-32));
+	c = _mm_loadu_si128((const __m128i *)(src+i-48));
+	d = _mm_loadu_si128((const __m128i *)(src+i-64));
+	_mm_store_si128((__m128i *)(dst+i-16), a);
+	_mm_store_si128((__m128i *)(dst+i-32), b);
+	_mm_store_si128((__m128i *)(dst+i-48), c);
+	_mm_store_si128((__m128i *)(dst+i-64), d);
+    }
+    for (; i > start; i -= 16)
+	_mm_store_si128((__m128i *)(dst+i-16),
+			_mm_loadu_si128((const __m128i *)(src+i-16)));
+    _mm_storeu_si128((__m128i *)dst, head);
+}
+#endif /* HAVE_SSE2 */
+
+
+#ifdef HAVE_AVX2
+    /*
+     *  AVX2, 32-byte loads and stores (selected at runtime)
+     */
+
+__attribute__((target("avx2")))
+static void copy_avx2(u8 *dst, const u8 *src, u32 n)
+{
+    __m256i head = _mm256_loadu_si256((const __m256i *)src);
+    __m256i tail = _mm256_loadu_si256((const __m256i *)(src+n-32));
+    u32 i = 32-((unsigned long)dst & 31), end = n-32;
+    __m256i a, b, c, d;
+
+    _mm256_storeu_si256((__m256i *)dst, head);
+    for (; i+128 <= end; i += 128) {
+	__builtin_prefetch(src+i+PREFETCH_DISTANCE);
+	__builtin_prefetch(src+i+PREFETCH_DISTANCE+64);
+	a = _mm256_loadu_si256((const __m256i *)(src+i));
+	b = _mm256_loadu_si256((const __m256i *)(src+i+32));
+	c = _mm256_loadu_si256((const __m256i *)(src+i+64));
+	d = _mm256_loadu_si256((const __m256i *)(src+i+96));
+	_mm256_store_si256((__m256i *)(dst+i), a);
+	_mm256_store_si256((__m256i *)(dst+i+32), b);
+	_mm256_store_si256((__m256i *)(dst+i+64), c);
+	_mm256_store_si256((__m256i *)(dst+i+96), d);
+    }
+    for (; i < end; i += 32)
+	_mm256_store_si256((__m256i *)(dst+i),
+			   _mm256_loadu_si256((const __m256i *)(src+i)));
+    _mm256_storeu_si256((__m256i *)(dst+end), tail);
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx2")))
+static void copy_rev_avx2(u8 *dst, const u8 *src, u32 n)
+{
+    __m256i head = _mm256_loadu_si256((const __m256i *)src);
+    __m256i tail = _mm256_loadu_si256((const __m256i *)(src+n-32));
+    u32 i = (unsigned long)(dst+n) & 31, start = 32;
+    __m256i a, b, c, d;
+
+    _mm256_storeu_si256((__m256i *)(dst+n-32), tail);
+    i = n-(i ? i : 32);
+    for (; i >= start+128; i -= 128) {
+	__builtin_prefetch(src+i-PREFETCH_DISTANCE);
+	__builtin_prefetch(src+i-PREFETCH_DISTANCE-64);
+	a = _mm256_loadu_si256((const __m256i *)(src+i-32));
+	b = _mm256_loadu_si256((const __m256i *)(src+i-64));
+	c = _mm256_loadu_si256((const __m256i *)(src+i-96));
+	d = _mm256_loadu_si256((const __m256i *)(src+i-128));
+	_mm256_store_si256((__m256i *)(dst+i-32), a);
+	_mm256_store_si256((__m256i *)(dst+i-64), b);
+	_mm256_store_si256((__m256i *)(dst+i-96), c);
+	_mm256_store_si256((__m256i *)(dst+i-128), d);
+    }
+    for (; i > start; i -= 32)
+	_mm256_store_si256((__m256i *)(dst+i-32),
+			   _mm256_loadu_si256((const __m256i *)(src+i-32)));
+    _mm256_storeu_si256((__m256i *)dst, head);
+    _mm256_zeroupper();
+}
+#endif /* HAVE_AVX2 */
+
+
+#ifdef HAVE_NEON
+    /*
+     *  NEON, 16-byte loads and stores
+     */
+
+static void copy_neon(u8 *dst, const u8 *src, u32 n)
+{
+    uint8x16_t head = vld1q_u8(src);
+    uint8x16_t tail = vld1q_u8(src+n-16);
+    u32 i = 16-((unsigned long)dst & 15), end = n-16;
+    uint8x16_t a, b, c, d;
+
+    vst1q_u8(dst, head);
+    for (; i+64 <= end; i += 64) {
+	__builtin_prefetch(src+i+PREFETCH_DISTANCE);
+	a = vld1q_u8(src+i);
+	b = vld1q_u8(src+i+16);
+	c = vld1q_u8(src+i+32);
+	d = vld1q_u8(src+i+48);
+	vst1q_u8(dst+i, a);
+	vst1q_u8(dst+i+16, b);
+	vst1q_u8(dst+i+32, c);
+	vst1q_u8(dst+i+48, d);
+    }
+    for (; i < end; i += 16)
+	vst1q_u8(dst+i, vld1q_u8(src+i));
+    vst1q_u8(dst+end, tail);
+}
+
+static void copy_rev_neon(u8 *dst, const u8 *src, u32 n)
+{
+    uint8x16_t head = vld1q_u8(src);
+    uint8x16_t tail = vld1q_u8(src+n-16);
+    u32 i = (unsigned long)(dst+n) & 15, start = 16;
+    uint8x16_t a, b, c, d;
+
+    vst1q_u8(dst+n-16, tail);
+    i = n-(i ? i : 16);
+    for (; i >= start+64; i -= 64) {
+	__builtin_prefetch(src+i-PREFETCH_DISTANCE);
+	a = vld1q_u8(src+i-16);
+	b = vld1q_u8(src+i-32);
+	c = vld1q_u8(src+i-48);
+	d = vld1q_u8(src+i-64);
+	vst1q_u8(dst+i-16, a);
+	vst1q_u8(dst+i-32, b);
+	vst1q_u8(dst+i-48, c);
+	vst1q_u8(dst+i-64, d);
+    }
+    for (; i > start; i -= 16)
+	vst1q_u8(dst+i-16, vld1q_u8(src+i-16));
+    vst1q_u8(dst, head);
+}
+#endif /* HAVE_NEON */
+
+
+#ifdef HAVE_SSE2
+static const struct memcopy_kernel memcopy_sse2 = {
+    "sse2", 16, copy_sse2, copy_rev_sse2
+};
+#endif
+#ifdef HAVE_AVX2
+static const struct memcopy_kernel memcopy_avx2 = {
+    "avx2", 32, copy_avx2, copy_rev_avx2
+};
+#endif
+#ifdef HAVE_NEON
+static const struct memcopy_kernel memcopy_neon = {
+    "neon", 16, copy_neon, copy_rev_neon
+};
+#endif
+
+static inline const struct memcopy_kernel *memcopy_select(void)
+{
+#ifdef HAVE_AVX2
+    if (__builtin_cpu_supports("avx2"))
+	return &memcopy_avx2;
+#endif
+#ifdef HAVE_SSE2
+    return &memcopy_sse2;
+#elif defined(HAVE_NEON)
+    return &memcopy_neon;
+#else
+    return NULL;
+#endif
+}
+
+const char *memcopy_name(void)
+{
+    const struct memcopy_kernel *kernel = memcopy_select();
+
+    return kernel ? kernel->name : "memmove";
+}
+
+
+    /*
+     *  Copy n bytes, source and destination may overlap
+     *
+     *  Short copies, and copies where source and destination are closer than
+     *  a vector, are left to memmove().
+     */
+
+void memcopy(void *dst, const void *src, u32 n)
+{
+    const struct memcopy_kernel *kernel = memcopy_select();
+    unsigned long dist;
+
+    dist = dst > src ? (u8 *)dst-(const u8 *)src : (const u8 *)src-(u8 *)dst;
+    if (!kernel || n < kernel->size || dist < kernel->size)
+	memmove(dst, src, n);
+    else if (dst < src || dist >= n)
+	kernel->forward(dst, src, n);
+    else
+	kernel->backward(dst, src, n);
+}
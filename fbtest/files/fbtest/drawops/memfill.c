@@ -0,0 +1,303 @@
+
+/*
+ *  Byte aligned pattern fill
+ *
+ *  For packed pixel formats with 8, 16 or 32 bits per pixel, all spans start
+ *  on a byte boundary, and a fill is a plain memory fill with a 32-bit
+ *  pattern. This uses the widest vector stores available (SSE2 or AVX2 on
+ *  x86, NEON on ARM), instead of the bit granular bitfill32().
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include "types.h"
+#include "bitstream.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#ifdef __SSE2__
+#define HAVE_SSE2
+#endif
+#if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define HAVE_AVX2
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAVE_NEON
+#endif
+
+#if !defined(HAVE_SSE2) && !defined(HAVE_NEON)
+#define HAVE_LONG
+#endif
+
+
+    /*
+     *  A fill kernel fills n >= 16 bytes at dst. Unaligned heads and tails are
+     *  written using unaligned stores that overlap with the aligned body.
+     */
+
+struct memfill_kernel {
+    const char *name;
+    void (*fill)(u8 *dst, u32 pat, u32 n, int nontemporal);
+};
+
+
+    /*
+     *  Rotate a pattern, so it starts n bytes later in memory
+     */
+
+static inline u32 pat_skip(u32 pat, u32 n)
+{
+    n = (n % 4)*8;
+    if (!n)
+	return pat;
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    return pat >> n | pat << (32-n);
+#else
+    return pat << n | pat >> (32-n);
+#endif
+}
+
+static inline u8 pat_first(u32 pat)
+{
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    return pat;
+#else
+    return pat >> 24;
+#endif
+}
+
+static inline void put_u32(u8 *p, u32 val)
+{
+    __builtin_memcpy(p, &val, 4);
+}
+
+static inline void put_u64(u8 *p, u32 pat)
+{
+    u64 val = (u64)pat << 32 | pat;
+
+    __builtin_memcpy(p, &val, 8);
+}
+
+
+#ifdef HAVE_LONG
+    /*
+     *  Long word stores, for architectures without vector support
+     */
+
+static void fill_long(u8 *dst, u32 pat, u32 n, int nontemporal)
+{
+    u8 *end = dst+n;
+    unsigned long *p, val;
+    u32 i;
+
+    put_u64(dst, pat);
+    put_u64(end-8, pat_skip(pat, n-8));
+
+    p = (unsigned long *)(((unsigned long)dst+BYTES_PER_LONG-1) &
+			  ~(BYTES_PER_LONG-1UL));
+    val = pat_skip(pat, (u8 *)p-dst);
+#if BITS_PER_LONG == 64
+    val |= val << 32;
+#endif
+    n = (end-(u8 *)p)/BYTES_PER_LONG;
+    for (i = n/8; i; i--, p += 8) {
+	p[0] = val;
+	p[1] = val;
+	p[2] = val;
+	p[3] = val;
+	p[4] = val;
+	p[5] = val;
+	p[6] = val;
+	p[7] = val;
+    }
+    for (i = n % 8; i; i--)
+	*p++ = val;
+}
+#endif /* HAVE_LONG */
+
+
+#ifdef HAVE_SSE2
+    /*
+     *  SSE2, 16-byte stores
+     */
+
+static void fill_sse2(u8 *dst, u32 pat, u32 n, int nontemporal)
+{
+    u8 *end = dst+n;
+    __m128i *p, val;
+
+    _mm_storeu_si128((__m128i *)dst, _mm_set1_epi32(pat));
+    _mm_storeu_si128((__m128i *)(end-16), _mm_set1_epi32(pat_skip(pat, n-16)));
+
+    p = (__m128i *)(((unsigned long)dst+16) & ~15UL);
+    val = _mm_set1_epi32(pat_skip(pat, (u8 *)p-dst));
+    n = (end-(u8 *)p)/16;
+    if (nontemporal) {
+	for (; n >= 4; n -= 4, p += 4) {
+	    _mm_stream_si128(p, val);
+	    _mm_stream_si128(p+1, val);
+	    _mm_stream_si128(p+2, val);
+	    _mm_stream_si128(p+3, val);
+	}
+	while (n--)
+	    _mm_stream_si128(p++, val);
+	_mm_sfence();
+    } else {
+	for (; n >= 4; n -= 4, p += 4) {
+	    _mm_store_si128(p, val);
+	    _mm_store_si128(p+1, val);
+	    _mm_store_si128(p+2, val);
+	    _mm_store_si128(p+3, val);
+	}
+	while (n--)
+	    _mm_store_si128(p++, val);
+    }
+}
+#endif /* HAVE_SSE2 */
+
+
+#ifdef HAVE_AVX2
+    /*
+     *  AVX2, 32-byte stores (selected at runtime)
+     */
+
+__attribute__((target("avx2")))
+static void fill_avx2(u8 *dst, u32 pat, u32 n, int nontemporal)
+{
+    u8 *end = dst+n;
+    __m256i *p, val;
+
+    if (n < 32) {
+	_mm_storeu_si128((__m128i *)dst, _mm_set1_epi32(pat));
+	_mm_storeu_si128((__m128i *)(end-16),
+			 _mm_set1_epi32(pat_skip(pat, n-16)));
+	return;
+    }
+
+    _mm256_storeu_si256((__m256i *)dst, _mm256_set1_epi32(pat));
+    _mm256_storeu_si256((__m256i *)(end-32),
+			_mm256_set1_epi32(pat_skip(pat, n-32)));
+
+    p = (__m256i *)(((unsigned long)dst+32) & ~31UL);
+    val = _mm256_set1_epi32(pat_skip(pat, (u8 *)p-dst));
+    n = (end-(u8 *)p)/32;
+    if (nontemporal) {
+	for (; n >= 4; n -= 4, p += 4) {
+	    _mm256_stream_si256(p, val);
+	    _mm256_stream_si256(p+1, val);
+	    _mm256_stream_si256(p+2, val);
+	    _mm256_stream_si256(p+3, val);
+	}
+	while (n--)
+	    _mm256_stream_si256(p++, val);
+	_mm_sfence();
+    } else {
+	for (; n >= 4; n -= 4, p += 4) {
+	    _mm256_store_si256(p, val);
+	    _mm256_store_si256(p+1, val);
+	    _mm256_store_si256(p+2, val);
+	    _mm256_store_si256(p+3, val);
+	}
+	while (n--)
+	    _mm256_store_si256(p++, val);
+    }
+    _mm256_zeroupper();
+}
+#endif /* HAVE_AVX2 */
+
+
+#ifdef HAVE_NEON
+    /*
+     *  NEON, 16-byte stores
+     *
+     *  NEON has no non-temporal store intrinsic, so nontemporal is ignored
+     */
+
+static void fill_neon(u8 *dst, u32 pat, u32 n, int nontemporal)
+{
+    u8 *end = dst+n;
+    u32 *p;
+    uint32x4_t val;
+
+    vst1q_u8(dst, vreinterpretq_u8_u32(vdupq_n_u32(pat)));
+    vst1q_u8(end-16, vreinterpretq_u8_u32(vdupq_n_u32(pat_skip(pat, n-16))));
+
+    p = (u32 *)(((unsigned long)dst+16) & ~15UL);
+    val = vdupq_n_u32(pat_skip(pat, (u8 *)p-dst));
+    n = (end-(u8 *)p)/16;
+    for (; n >= 4; n -= 4, p += 16) {
+	vst1q_u32(p, val);
+	vst1q_u32(p+4, val);
+	vst1q_u32(p+8, val);
+	vst1q_u32(p+12, val);
+    }
+    for (; n; n--, p += 4)
+	vst1q_u32(p, val);
+}
+#endif /* HAVE_NEON */
+
+
+#ifdef HAVE_LONG
+static const struct memfill_kernel memfill_long = { "long", fill_long };
+#endif
+#ifdef HAVE_SSE2
+static const struct memfill_kernel memfill_sse2 = { "sse2", fill_sse2 };
+#endif
+#ifdef HAVE_AVX2
+static const struct memfill_kernel memfill_avx2 = { "avx2", fill_avx2 };
+#endif
+#ifdef HAVE_NEON
+static const struct memfill_kernel memfill_neon = { "neon", fill_neon };
+#endif
+
+static inline const struct memfill_kernel *memfill_select(void)
+{
+#ifdef HAVE_AVX2
+    if (__builtin_cpu_supports("avx2"))
+	return &memfill_avx2;
+#endif
+#ifdef HAVE_SSE2
+    return &memfill_sse2;
+#elif defined(HAVE_NEON)
+    return &memfill_neon;
+#else
+    return &memfill_long;
+#endif
+}
+
+const char *memfill32_name(void)
+{
+    return memfill_select()->name;
+}
+
+
+    /*
+     *  Fill n bytes with a 32-bit pattern
+     *
+     *  The pattern is in memory order, starting at dst. Fills shorter than a
+     *  vector use two overlapping scalar stores.
+     */
+
+void memfill32(void *dst, u32 pat, u32 n, int nontemporal)
+{
+    u8 *p = dst;
+
+    if (n >= 16)
+	memfill_select()->fill(p, pat, n, nontemporal);
+    else if (n >= 8) {
+	put_u64(p, pat);
+	put_u64(p+n-8, pat_skip(pat, n-8));
+    } else if (n >= 4) {
+	put_u32(p, pat);
+	put_u32(p+n-4, pat_skip(pat, n-4));
+    } else
+	while (n--) {
+	    *p++ = pat_first(pat);
+	    pat = pat_skip(pat, 1);
+	}
+}
@@ -0,0 +1,229 @@
+
+/*
+ *  Byte aligned 24-bit pattern fill
+ *
+ *  24 bits don't divide the size of a word or vector, so the pattern of a
+ *  24 bpp fill only repeats every three words (or vectors). Instead of
+ *  rotating the pattern for each word, like bitfill() does, the three words
+ *  are loaded once for the alignment of the destination, and stored in
+ *  unrolled groups.
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <byteswap.h>
+#include <string.h>
+
+#include "types.h"
+#include "bitstream.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#ifdef __SSE2__
+#define HAVE_SSE2
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HAVE_NEON
+#endif
+
+#if !defined(HAVE_SSE2) && !defined(HAVE_NEON)
+#define HAVE_LONG
+#endif
+
+
+    /*
+     *  The pattern bytes, long enough for a period of three vectors starting
+     *  at any of the three byte phases of a pixel
+     */
+
+#define PAT_WORDS	15
+
+static void pat_init(u32 *pat, u32 pixel)
+{
+    u32 w0, w1, w2, i;
+
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+    pixel = bswap_32(pixel) >> 8;
+    w0 = pixel | pixel << 24;
+    w1 = pixel >> 8 | pixel << 16;
+    w2 = pixel >> 16 | pixel << 8;
+#else
+    pixel <<= 8;
+    w0 = pixel | pixel >> 24;
+    w1 = pixel << 8 | pixel >> 16;
+    w2 = pixel << 16 | pixel >> 8;
+#endif
+    for (i = 0; i < PAT_WORDS; i += 3) {
+	pat[i] = w0;
+	pat[i+1] = w1;
+	pat[i+2] = w2;
+    }
+}
+
+
+#ifdef HAVE_LONG
+    /*
+     *  Long word stores, for architectures without vector support
+     */
+
+static void fill_long(u8 *dst, const u8 *pat, u32 n, int nontemporal)
+{
+    u8 *end = dst+n;
+    unsigned long *p, w0, w1, w2;
+    u32 phase;
+
+    memcpy(dst, pat, BYTES_PER_LONG);
+    memcpy(end-BYTES_PER_LONG, pat+(n-BYTES_PER_LONG) % 3, BYTES_PER_LONG);
+
+    p = (unsigned long *)(((unsigned long)dst+BYTES_PER_LONG-1) &
+			  ~(BYTES_PER_LONG-1UL));
+    phase = ((u8 *)p-dst) % 3;
+    memcpy(&w0, pat+phase, BYTES_PER_LONG);
+    memcpy(&w1, pat+phase+BYTES_PER_LONG, BYTES_PER_LONG);
+    memcpy(&w2, pat+phase+2*BYTES_PER_LONG, BYTES_PER_LONG);
+    n = (end-(u8 *)p)/BYTES_PER_LONG;
+    for (; n >= 6; n -= 6, p += 6) {
+	p[0] = w0;
+	p[1] = w1;
+	p[2] = w2;
+	p[3] = w0;
+	p[4] = w1;
+	p[5] = w2;
+    }
+    if (n >= 3) {
+	p[0] = w0;
+	p[1] = w1;
+	p[2] = w2;
+	p += 3;
+	n -= 3;
+    }
+    if (n > 0)
+	p[0] = w0;
+    if (n > 1)
+	p[1] = w1;
+}
+#endif /* HAVE_LONG */
+
+
+#ifdef HAVE_SSE2
+    /*
+     *  SSE2, 16-byte stores
+     */
+
+static void fill_sse2(u8 *dst, const u8 *pat, u32 n, int nontemporal)
+{
+    u8 *end = dst+n;
+    __m128i *p, v0, v1, v2;
+    u32 phase;
+
+    _mm_storeu_si128((__m128i *)dst, _mm_loadu_si128((const __m128i *)pat));
+    _mm_storeu_si128((__m128i *)(end-16),
+		     _mm_loadu_si128((const __m128i *)(pat+(n-16) % 3)));
+
+    p = (__m128i *)(((unsigned long)dst+16) & ~15UL);
+    phase = ((u8 *)p-dst) % 3;
+    v0 = _mm_loadu_si128((const __m128i *)(pat+phase));
+    v1 = _mm_loadu_si128((const __m128i *)(pat+phase+16));
+    v2 = _mm_loadu_si128((const __m128i *)(pat+phase+32));
+    n = (end-(u8 *)p)/16;
+    if (nontemporal) {
+	for (; n >= 3; n -= 3, p += 3) {
+	    _mm_stream_si128(p, v0);
+	    _mm_stream_si128(p+1, v1);
+	    _mm_stream_si128(p+2, v2);
+	}
+	if (n > 0)
+	    _mm_stream_si128(p, v0);
+	if (n > 1)
+	    _mm_stream_si128(p+1, v1);
+	_mm_sfence();
+    } else {
+	for (; n >= 3; n -= 3, p += 3) {
+	    _mm_store_si128(p, v0);
+	    _mm_store_si128(p+1, v1);
+	    _mm_store_si128(p+2, v2);
+	}
+	if (n > 0)
+	    _mm_store_si128(p, v0);
+	if (n > 1)
+	    _mm_store_si128(p+1, v1);
+    }
+}
+#endif /* HAVE_SSE2 */
+
+
+#ifdef HAVE_NEON
+    /*
+     *  NEON, 16-byte stores
+     *
+     *  NEON has no non-temporal store intrinsic, so nontemporal is ignored
+     */
+
+static void fill_neon(u8 *dst, const u8 *pat, u32 n, int nontemporal)
+{
+    u8 *end = dst+n, *p;
+    uint8x16_t v0, v1, v2;
+    u32 phase;
+
+    vst1q_u8(dst, vld1q_u8(pat));
+    vst1q_u8(end-16, vld1q_u8(pat+(n-16) % 3));
+
+    p = (u8 *)(((unsigned long)dst+16) & ~15UL);
+    phase = (p-dst) % 3;
+    v0 = vld1q_u8(pat+phase);
+    v1 = vld1q_u8(pat+phase+16);
+    v2 = vld1q_u8(pat+phase+32);
+    n = (end-p)/16;
+    for (; n >= 3; n -= 3, p += 48) {
+	vst1q_u8(p, v0);
+	vst1q_u8(p+16, v1);
+	vst1q_u8(p+32, v2);
+    }
+    if (n > 0)
+	vst1q_u8(p, v0);
+    if (n > 1)
+	vst1q_u8(p+16, v1);
+}
+#endif /* HAVE_NEON */
+
+
+const char *memfill24_name(void)
+{
+#ifdef HAVE_SSE2
+    return "sse2";
+#elif defined(HAVE_NEON)
+    return "neon";
+#else
+    return "long";
+#endif
+}
+
+
+    /*
+     *  Fill n bytes with a 24-bit pixel, stored most significant byte first
+     *
+     *  n must be a multiple of 3. Fills shorter than a vector are copied from
+     *  the pattern.
+     */
+
+void memfill24(void *dst, u32 pixel, u32 n, int nontemporal)
+{
+    u32 pat[PAT_WORDS];
+
+    pat_init(pat, pixel);
+    if (n < 16)
+	memcpy(dst, pat, n);
+    else
+#ifdef HAVE_SSE2
+	fill_sse2(dst, (const u8 *)pat, n, nontemporal);
+#elif defined(HAVE_NEON)
+	fill_neon(dst, (const u8 *)pat, n, nontemporal);
+#else
+	fill_long(dst, (const u8 *)pat, n, nontemporal);
+#endif
+}
@@ -0,0 +1,255 @@
+
+/*
+ *  Outline drawing template
+ *
+ *  Circles and ellipses are traced as runs of horizontal and vertical lines.
+ *  This file is included once for each way of drawing the runs, with
+ *  NAME(op) giving the name of drawing operation op, and HLINE() and VLINE()
+ *  drawing a run. generic.c uses the frame buffer level draw_hline() and
+ *  draw_vline(), packed.c inlined stores for each packed pixel depth.
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#ifndef OUTLINE_TYPES
+#define OUTLINE_TYPES
+
+    /*
+     *  Outline runs
+     *
+     *  Outlines are traced in one quadrant, and adjacent pixels on the same
+     *  line or column are merged into runs, which are mirrored to the other
+     *  quadrants. Runs touching an axis are merged with their mirror images,
+     *  so no pixel is drawn twice.
+     */
+
+struct outline {
+    u32 cx, cy;
+    pixel_t pixel;
+    int valid;
+    u32 x0, y0, x1, y1;		/* current run, relative to the center */
+};
+
+static inline void outline_init(struct outline *o, u32 cx, u32 cy,
+				pixel_t pixel)
+{
+    o->cx = cx;
+    o->cy = cy;
+    o->pixel = pixel;
+    o->valid = 0;
+}
+
+#endif /* OUTLINE_TYPES */
+
+
+static void NAME(outline_flush)(struct outline *o)
+{
+    u32 cx = o->cx, cy = o->cy, len;
+
+    if (!o->valid)
+	return;
+    o->valid = 0;
+    if (o->y0 == o->y1) {
+	/* Horizontal run, or a single pixel */
+	if (!o->x0) {
+	    HLINE(cx-o->x1, cy-o->y0, 2*o->x1+1, o->pixel);
+	    if (o->y0)
+		HLINE(cx-o->x1, cy+o->y0, 2*o->x1+1, o->pixel);
+	} else {
+	    len = o->x1-o->x0+1;
+	    HLINE(cx-o->x1, cy-o->y0, len, o->pixel);
+	    HLINE(cx+o->x0, cy-o->y0, len, o->pixel);
+	    if (o->y0) {
+		HLINE(cx-o->x1, cy+o->y0, len, o->pixel);
+		HLINE(cx+o->x0, cy+o->y0, len, o->pixel);
+	    }
+	}
+    } else {
+	/* Vertical run */
+	if (!o->y0) {
+	    VLINE(cx-o->x0, cy-o->y1, 2*o->y1+1, o->pixel);
+	    if (o->x0)
+		VLINE(cx+o->x0, cy-o->y1, 2*o->y1+1, o->pixel);
+	} else {
+	    len = o->y1-o->y0+1;
+	    VLINE(cx-o->x0, cy-o->y1, len, o->pixel);
+	    VLINE(cx-o->x0, cy+o->y0, len, o->pixel);
+	    if (o->x0) {
+		VLINE(cx+o->x0, cy-o->y1, len, o->pixel);
+		VLINE(cx+o->x0, cy+o->y0, len, o->pixel);
+	    }
+	}
+    }
+}
+
+static void NAME(outline_add)(struct outline *o, u32 x, u32 y)
+{
+    if (o->valid) {
+	if (o->y0 == o->y1 && y == o->y0) {
+	    if (x == o->x1+1) {
+		o->x1 = x;
+		return;
+	    }
+	    if (x+1 == o->x0) {
+		o->x0 = x;
+		return;
+	    }
+	}
+	if (o->x0 == o->x1 && x == o->x0) {
+	    if (y == o->y1+1) {
+		o->y1 = y;
+		return;
+	    }
+	    if (y+1 == o->y0) {
+		o->y0 = y;
+		return;
+	    }
+	}
+	NAME(outline_flush)(o);
+    }
+    o->valid = 1;
+    o->x0 = o->x1 = x;
+    o->y0 = o->y1 = y;
+}
+
+
+    /*
+     *  Draw a circle using the differential version of the midpoint algorithm
+     *
+     *  Cfr. Computer Graphics: Principles and Practices, Second Edition in C,
+     *  Foley et al., 1997, p. 87
+     *
+     *  The first octant yields the horizontal runs, its mirror image along
+     *  the diagonal the vertical runs.
+     */
+
+void NAME(draw_circle)(u32 x, u32 y, u32 r, pixel_t pixel)
+{
+    struct outline flat, steep;
+    int x1 = 0;
+    int y1 = r;
+    int d = 1-r;
+    int de = 3;
+    int dse = -2*r+5;
+
+    outline_init(&flat, x, y, pixel);
+    outline_init(&steep, x, y, pixel);
+    do {
+	NAME(outline_add)(&flat, x1, y1);
+	if (x1 < y1)
+	    NAME(outline_add)(&steep, y1, x1);
+	if (d < 0) {	// Select E
+	    d += de;
+	    de += 2;
+	    dse += 2;
+	} else {	// Select SE
+	    d += dse;
+	    de += 2;
+	    dse += 4;
+	    y1--;
+	}
+	x1++;
+    } while (x1 <= y1);
+    NAME(outline_flush)(&flat);
+    NAME(outline_flush)(&steep);
+}
+
+
+    /*
+     *  Draw an ellipse using a differential version of the Bresenham algorithm
+     *  for ellipses
+     */
+
+void NAME(draw_ellipse)(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
+{
+    struct outline o;
+
+    if (a == b)
+	NAME(draw_circle)(x, y, a, pixel);
+    else {
+	u32 a2 = a*a;
+	u32 b2 = b*b;
+
+	outline_init(&o, x, y, pixel);
+	if (a <= b) {
+	    u32 x1 = 0;
+	    u32 y1 = b;
+	    int S = a2*(1-2*b)+2*b2;
+	    int T = b2-2*a2*(2*b-1);
+	    int dT1 = 4*b2;
+	    int dS1 = dT1+2*b2;
+	    int dS2 = -4*a2*(b-1);
+	    int dT2 = dS2+2*a2;
+
+	    NAME(outline_add)(&o, x1, y1);
+	    do {
+		if (S < 0) {
+		    S += dS1;
+		    T += dT1;
+		    dS1 += 4*b2;
+		    dT1 += 4*b2;
+		    x1++;
+		} else if (T < 0) {
+		    S += dS1+dS2;
+		    T += dT1+dT2;
+		    dS1 += 4*b2;
+		    dT1 += 4*b2;
+		    dS2 += 4*a2;
+		    dT2 += 4*a2;
+		    x1++;
+		    y1--;
+		} else {
+		    S += dS2;
+		    T += dT2;
+		    dS2 += 4*a2;
+		    dT2 += 4*a2;
+		    y1--;
+		}
+		NAME(outline_add)(&o, x1, y1);
+	    } while (y1 > 0);
+	} else {
+	    u32 x1 = a;
+	    u32 y1 = 0;
+            int S = b2*(1-2*a)+2*a2;
+            int T = a2-2*b2*(2*a-1);
+            int dT1 = 4*a2;
+            int dS1 = dT1+2*a2;
+            int dS2 = -4*b2*(a-1);
+            int dT2 = dS2+2*b2;
+
+	    NAME(outline_add)(&o, x1, y1);
+	    do {
+		if (S < 0) {
+		    S += dS1;
+		    T += dT1;
+		    dS1 += 4*a2;
+		    dT1 += 4*a2;
+		    y1++;
+		} else if (T < 0) {
+		    S += dS1+dS2;
+		    T += dT1+dT2;
+		    dS1 += 4*a2;
+		    dT1 += 4*a2;
+		    dS2 += 4*b2;
+		    dT2 += 4*b2;
+		    x1--;
+		    y1++;
+		} else {
+		    S += dS2;
+		    T += dT2;
+		    dS2 += 4*b2;
+		    dT2 += 4*b2;
+		    x1--;
+		}
+		NAME(outline_add)(&o, x1, y1);
+	    } while (x1 > 0);
+	}
+	NAME(outline_flush)(&o);
+    }
+}
+
+#undef NAME
+#undef HLINE
+#undef VLINE
@@ -0,0 +1,60 @@
+
+/*
+ *  Generic drawing operations for packed pixels
+ *
+ *  The cfb drivers leave filled shapes, outlines and chunky pixmaps to the
+ *  generic routines, which draw through the frame buffer level operations,
+ *  i.e. an indirect call for every run or pixel. For 8, 16, 24 and 32 bpp,
+ *  drawops_init() installs versions specialized for the depth instead.
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include "types.h"
+#include "drawops.h"
+#include "fb.h"
+
+
+#define next_line	(fb_current->draw_next_line)
+
+#define PACKED_INLINE	16	/* pixels */
+
+#define BPP	8
+#include "packed.h"
+#undef BPP
+
+#define BPP	16
+#include "packed.h"
+#undef BPP
+
+#define BPP	24
+#include "packed.h"
+#undef BPP
+
+#define BPP	32
+#include "packed.h"
+#undef BPP
+
+
+const struct drawops *packed_drawops(void)
+{
+    if (fb_fix.type != FB_TYPE_PACKED_PIXELS)
+	return NULL;
+
+    switch (fb_var.bits_per_pixel) {
+	case 8:
+	    return &packed8_drawops;
+
+	case 16:
+	    return &packed16_drawops;
+
+	case 24:
+	    return &packed24_drawops;
+
+	case 32:
+	    return &packed32_drawops;
+    }
+    return NULL;
+}
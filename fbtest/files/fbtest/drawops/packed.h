@@ -0,0 +1,100 @@
+
+/*
+ *  Generic drawing operations specialized for a packed pixel depth
+ *
+ *  This file is included by packed.c once for each depth, with BPP defined
+ *  as 8, 16, 24 or 32. Pixels are stored directly instead of through the
+ *  frame buffer level operations, so the compiler can inline the stores,
+ *  and keep the line length and pointers in registers.
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#define PASTE(a, b, c)		a ## b ## _ ## c
+#define EXPAND(a, b, c)		PASTE(a, b, c)
+#define SPEC(op)		EXPAND(packed, BPP, op)
+
+static inline void SPEC(put)(u8 *dst, pixel_t pixel)
+{
+#if BPP == 8
+    *dst = pixel;
+#elif BPP == 16
+    *(u16 *)dst = pixel;
+#elif BPP == 24
+    dst[0] = (pixel >> 16) & 0xff;
+    dst[1] = (pixel >> 8) & 0xff;
+    dst[2] = pixel & 0xff;
+#else
+    *(u32 *)dst = pixel;
+#endif
+}
+
+    /*
+     *  Runs of up to PACKED_INLINE pixels are stored here, longer ones are
+     *  left to the vectorized frame buffer level draw_hline()
+     */
+
+static inline void SPEC(hline)(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    u8 *dst;
+
+    if (length > PACKED_INLINE) {
+	(fb_drawops.draw_hline)(x, y, length, pixel);
+	return;
+    }
+    for (dst = fb_current->fb+y*next_line+x*BPP/8; length--; dst += BPP/8)
+	SPEC(put)(dst, pixel);
+}
+
+static inline void SPEC(vline)(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    u32 stride = next_line;
+    u8 *dst;
+
+    for (dst = fb_current->fb+y*stride+x*BPP/8; length--; dst += stride)
+	SPEC(put)(dst, pixel);
+}
+
+static void SPEC(fill_spans)(const struct span *spans, u32 num, pixel_t pixel)
+{
+    for (; num--; spans++)
+	SPEC(hline)(spans->x, spans->y, spans->length, pixel);
+}
+
+#if BPP != 8
+    /*
+     *  At 8 bpp, cfb8 copies whole lines instead
+     */
+
+static void SPEC(draw_chunky)(u32 x, u32 y, u32 width, u32 height,
+			      const u8 *data, u32 pitch)
+{
+    u32 stride = next_line, i;
+    u8 *dst;
+
+    for (dst = fb_current->fb+y*stride+x*BPP/8; height--;
+	 dst += stride, data += pitch)
+	for (i = 0; i < width; i++)
+	    SPEC(put)(dst+i*BPP/8, data[i]);
+}
+#endif
+
+#define NAME(op)			SPEC(op)
+#define HLINE(x, y, length, pixel)	SPEC(hline)((x), (y), (length), (pixel))
+#define VLINE(x, y, length, pixel)	SPEC(vline)((x), (y), (length), (pixel))
+#include "outline.h"
+
+static const struct drawops SPEC(drawops) = {
+    .fill_spans =	SPEC(fill_spans),
+#if BPP != 8
+    .draw_chunky =	SPEC(draw_chunky),
+#endif
+    .draw_circle =	SPEC(draw_circle),
+    .draw_ellipse =	SPEC(draw_ellipse),
+};
+
+#undef SPEC
+#undef EXPAND
+#undef PASTE
@@ -14,15 +14,24 @@
  *  more details.
  */
 
+#include <string.h>
+
 #include "types.h"
 #include "drawops.h"
 #include "bitstream.h"
 #include "fb.h"
+#include "util.h"
+
 
+#define screen		(fb_current->draw_screen)
+#define next_line	(fb_current->draw_next_line)
+#define next_plane	(fb_current->draw_next_plane)
 
-static u8 *screen;
-static u32 next_line;
-static u32 next_plane;
+    /* Bytes per line in one plane */
+#define plane_line	(fb_fix.type == FB_TYPE_INTERLEAVED_PLANES ? next_plane \
+							   : next_line)
+
+#define PIXMAP_CHUNK	256	/* pixels per plane row */
 
 static int planar_init(void)
 {
@@ -47,7 +56,7 @@ static int planar_init(void)
 	    if (fb_fix.type_aux != len)
 		return 0;
 	    /* ilbm */
-	    next_line = len*fb_var.yres_virtual;
+	    next_line = len*fb_var.bits_per_pixel;
 	    next_plane = len;
 	    break;
 
@@ -55,7 +64,7 @@ static int planar_init(void)
 	    return 0;
 	    break;
     }
-    screen = fb;
+    fb_current->draw_screen = fb_current->fb;
     return 1;
 }
 
@@ -118,20 +127,51 @@ static void planar_draw_hline(u32 x, u32 y, u32 length, pixel_t pixel)
     unsigned long *dst;
     int dst_idx;
 
-    dst = (unsigned long *)((unsigned long)fb & ~(BYTES_PER_LONG-1));
-    dst_idx = ((unsigned long)fb & (BYTES_PER_LONG-1))*8;
+    dst = (unsigned long *)((unsigned long)fb_current->fb &
+			    ~(BYTES_PER_LONG-1));
+    dst_idx = ((unsigned long)fb_current->fb & (BYTES_PER_LONG-1))*8;
     dst_idx += y*next_line*8+x;
     fill_one_line(dst, dst_idx, length, pixel);
 }
 
+    /*
+     *  Draw a vertical line, one plane at a time
+     */
+
+static void planar_draw_vline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    u8 *plane, *p, mask;
+    u32 n;
+    int i;
+
+    plane = screen+y*next_line+(x/8);
+    mask = 0x80 >> (x & 7);
+    i = fb_var.bits_per_pixel;
+    while (1) {
+	p = plane;
+	n = length;
+	if (pixel & 1)
+	    for (; n--; p += next_line)
+		*p |= mask;
+	else
+	    for (; n--; p += next_line)
+		*p &= ~mask;
+	if (!--i)
+	    break;
+	pixel >>= 1;
+	plane += next_plane;
+    }
+}
+
 static void planar_fill_rect(u32 x, u32 y, u32 width, u32 height,
 			     pixel_t pixel)
 {
     unsigned long *dst;
     int dst_idx;
 
-    dst = (unsigned long *)((unsigned long)fb & ~(BYTES_PER_LONG-1));
-    dst_idx = ((unsigned long)fb & (BYTES_PER_LONG-1))*8;
+    dst = (unsigned long *)((unsigned long)fb_current->fb &
+			    ~(BYTES_PER_LONG-1));
+    dst_idx = ((unsigned long)fb_current->fb & (BYTES_PER_LONG-1))*8;
     dst_idx += y*next_line*8+x;
     while (height--) {
 	fill_one_line(dst, dst_idx, width, pixel);
@@ -175,8 +215,9 @@ static void planar_expand_bitmap(u32 x, u32 y, u32 width, u32 height,
     unsigned long *dst;
     int dst_idx;
 
-    dst = (unsigned long *)((unsigned long)fb & ~(BYTES_PER_LONG-1));
-    dst_idx = ((unsigned long)fb & (BYTES_PER_LONG-1))*8;
+    dst = (unsigned long *)((unsigned long)fb_current->fb &
+			    ~(BYTES_PER_LONG-1));
+    dst_idx = ((unsigned long)fb_current->fb & (BYTES_PER_LONG-1))*8;
     dst_idx += y*next_line*8+x;
     while (height--) {
 	expand_one_line(dst, dst_idx, width, data, pixel0, pixel1);
@@ -186,6 +227,91 @@ static void planar_expand_bitmap(u32 x, u32 y, u32 width, u32 height,
 }
 
 
+    /*
+     *  Chunky pixels are written one plane row at a time
+     *
+     *  Up to PIXMAP_CHUNK pixels are converted to plane words using c2p(),
+     *  and the bytes of each plane are written using a single bitcpy().
+     *  Pixmaps with more than 8 planes are left to the generic routine.
+     */
+
+static void write_chunky(unsigned long *dst, int dst_idx, const u8 *src,
+			 u32 n)
+{
+    unsigned long buf[PIXMAP_CHUNK/BITS_PER_LONG];
+    u16 words[PIXMAP_CHUNK/16*8];
+    u32 bpp = fb_var.bits_per_pixel, depth = min(bpp, 8U);
+    u32 groups = (n+15)/16, g, i;
+    u8 *b;
+
+    c2p(words, src, groups, depth);
+    for (i = 0; i < bpp; i++) {
+	dst += dst_idx >> SHIFT_PER_LONG;
+	dst_idx &= (BITS_PER_LONG-1);
+	if (i < depth) {
+	    for (g = 0, b = (u8 *)buf; g < groups; g++) {
+		*b++ = words[g*depth+i] >> 8;
+		*b++ = words[g*depth+i];
+	    }
+	    bitcpy(dst, dst_idx, buf, 0, n);
+	} else {
+	    bitfill32(dst, dst_idx, 0, n);
+	}
+	dst_idx += next_plane*8;
+    }
+}
+
+static void planar_draw_pixmap(u32 x, u32 y, u32 width, u32 height,
+			       const pixel_t *pixmap)
+{
+    u8 line[PIXMAP_CHUNK];
+    unsigned long *dst;
+    int dst_idx;
+    u32 n, chunk, i;
+
+    if (fb_var.bits_per_pixel > 8) {
+	generic_draw_pixmap(x, y, width, height, pixmap);
+	return;
+    }
+
+    dst = (unsigned long *)((unsigned long)fb_current->fb &
+			    ~(BYTES_PER_LONG-1));
+    dst_idx = ((unsigned long)fb_current->fb & (BYTES_PER_LONG-1))*8;
+    dst_idx += y*next_line*8+x;
+    for (; height--; dst_idx += next_line*8)
+	for (n = 0; n < width; n += chunk, pixmap += chunk) {
+	    chunk = min(width-n, (u32)PIXMAP_CHUNK);
+	    for (i = 0; i < chunk; i++)
+		line[i] = pixmap[i];
+	    write_chunky(dst, dst_idx+n, line, chunk);
+	}
+}
+
+static void planar_draw_chunky(u32 x, u32 y, u32 width, u32 height,
+			       const u8 *data, u32 pitch)
+{
+    u8 line[PIXMAP_CHUNK];
+    const u8 *src;
+    unsigned long *dst;
+    int dst_idx;
+    u32 n, chunk;
+
+    dst = (unsigned long *)((unsigned long)fb_current->fb &
+			    ~(BYTES_PER_LONG-1));
+    dst_idx = ((unsigned long)fb_current->fb & (BYTES_PER_LONG-1))*8;
+    dst_idx += y*next_line*8+x;
+    for (; height--; dst_idx += next_line*8, data += pitch)
+	for (n = 0; n < width; n += chunk) {
+	    chunk = min(width-n, (u32)PIXMAP_CHUNK);
+	    src = data+n;
+	    /* Partial groups must not read beyond the end of the line */
+	    if (chunk & 15)
+		src = memcpy(line, src, chunk);
+	    write_chunky(dst, dst_idx+n, src, chunk);
+	}
+}
+
+
 static inline void copy_one_line(unsigned long *dst, int dst_idx,
 				 unsigned long *src, int src_idx, u32 n)
 {
@@ -220,6 +346,40 @@ static inline void copy_one_line_rev(unsigned long *dst, int dst_idx,
     }
 }
 
+    /*
+     *  Byte aligned copies move whole bytes of each plane. Full lines are
+     *  contiguous within a plane (afb), or across all planes (ilbm), so
+     *  scrolling is a single memory move per plane.
+     */
+
+static void planar_copy_rect_bytes(u32 dx, u32 dy, u32 width, u32 height,
+				   u32 sx, u32 sy)
+{
+    u32 n = width/8, planes = fb_var.bits_per_pixel;
+    u8 *dst = screen+dy*next_line+dx/8;
+    const u8 *src = screen+sy*next_line+sx/8;
+    long step = next_line;
+    u32 i;
+
+    if (n == plane_line) {
+	if (fb_fix.type == FB_TYPE_INTERLEAVED_PLANES)
+	    planes = 1;
+	for (i = 0; i < planes; i++)
+	    memcopy(dst+i*next_plane, src+i*next_plane, height*next_line);
+	return;
+    }
+
+    if (dy > sy) {
+	/* Overlapping downwards, start at the bottom */
+	dst += (height-1)*next_line;
+	src += (height-1)*next_line;
+	step = -step;
+    }
+    for (; height--; dst += step, src += step)
+	for (i = 0; i < planes; i++)
+	    memcopy(dst+i*next_plane, src+i*next_plane, n);
+}
+
 static void planar_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx,
 			     u32 sy)
 {
@@ -227,13 +387,19 @@ static void planar_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx,
     int dst_idx, src_idx;
     int rev_copy = 0;
 
+    if (!((dx | sx | width) & 7) && !fb_current->no_simd) {
+	planar_copy_rect_bytes(dx, dy, width, height, sx, sy);
+	return;
+    }
+
     if (dy > sy || (dy == sy && dx > sx)) {
 	dy += height;
 	sy += height;
 	rev_copy = 1;
     }
-    dst = src = (unsigned long *)((unsigned long)fb & ~(BYTES_PER_LONG-1));
-    dst_idx = src_idx = ((unsigned long)fb & (BYTES_PER_LONG-1))*8;
+    dst = src = (unsigned long *)((unsigned long)fb_current->fb &
+				  ~(BYTES_PER_LONG-1));
+    dst_idx = src_idx = ((unsigned long)fb_current->fb & (BYTES_PER_LONG-1))*8;
     dst_idx += dy*next_line*8+dx;
     src_idx += sy*next_line*8+sx;
     if (rev_copy) {
@@ -257,8 +423,11 @@ const struct drawops planar_drawops = {
     .set_pixel =	planar_setpixel,
     .get_pixel =	planar_getpixel,
     .draw_hline =	planar_draw_hline,
+    .draw_vline =	planar_draw_vline,
     .fill_rect =	planar_fill_rect,
     .expand_bitmap =	planar_expand_bitmap,
+    .draw_pixmap =	planar_draw_pixmap,
+    .draw_chunky =	planar_draw_chunky,
     .copy_rect =	planar_copy_rect,
 };
 
@@ -23,29 +23,82 @@
 #include "fb.h"
 #include "util.h"
 #include "colormap.h"
+#include "frame.h"
+#include "shadow.h"
+#include "clip.h"
+#include "dlist.h"
+#include "rotate.h"
+#include "workers.h"
 
 
-static int fb_fd = -1;
+    /*
+     *  Current context of the calling thread
+     */
+
+__thread struct fb_context *fb_current;
+
+#define fb_start	(fb_current->map_start)
+#define fb_len		(fb_current->map_len)
+#define fb_offset	(fb_current->map_offset)
+#define fb_addr		(fb_current->map_addr)
+
 
-struct fb_fix_screeninfo fb_fix;
-struct fb_var_screeninfo fb_var;
-struct fb_cmap fb_cmap;
+    /*
+     *  Allocate a context for a frame buffer device
+     */
+
+struct fb_context *fb_context_alloc(const char *dev)
+{
+    struct fb_context *ctx;
 
-static unsigned long fb_start;
-static u32 fb_len, fb_offset;
-static void *fb_addr;
-u8 *fb;
+    if (!(ctx = calloc(1, sizeof(*ctx))))
+	Fatal("calloc %zu: %s\n", sizeof(*ctx), strerror(errno));
+    ctx->dev = dev;
+    ctx->fd = -1;
+    return ctx;
+}
+
+
+    /*
+     *  Free a context, after fb_cleanup()
+     */
+
+void fb_context_free(struct fb_context *ctx)
+{
+    if (fb_current == ctx)
+	fb_current = NULL;
+    free(ctx->drawops);
+    free(ctx->visops);
+    free(ctx->frame);
+    free(ctx);
+}
+
+
+    /*
+     *  Select the current context of the calling thread
+     */
+
+void fb_select(struct fb_context *ctx)
+{
+    fb_current = ctx;
+}
 
 
     /*
      *   Saved frame buffer device state
      */
 
-static struct fb_var_screeninfo saved_var;
-static struct fb_fix_screeninfo saved_fix;
-static struct fb_cmap saved_cmap;
-static u16 *saved_red, *saved_green, *saved_blue, *saved_transp;
-static u8 *saved_fb;
+#define saved_var	(fb_current->saved_var)
+#define saved_fix	(fb_current->saved_fix)
+#define saved_cmap	(fb_current->saved_cmap)
+#define saved_red	(fb_current->saved_red)
+#define saved_green	(fb_current->saved_green)
+#define saved_blue	(fb_current->saved_blue)
+#define saved_transp	(fb_current->saved_transp)
+#define saved_fb	(fb_current->saved_fb)
+#define saved_len	(fb_current->saved_len)
+#define saved_head	(fb_current->saved_head)
+#define saved_tail	(fb_current->saved_tail)
 
 
 static void fix_validate(void);
@@ -53,20 +106,89 @@ static void var_validate(void);
 static void var_validate_change(const struct fb_var_screeninfo *old,
 				int error);
 static void cmap_validate(void);
-static void cmap_validate_change(const struct fb_cmap *old, int error);
+static void cmap_validate_change(const typeof(fb_cmap) *old, int error);
 static void fb_dump_cmap(void);
 
 
+    /*
+     *  Kernel frame buffer device backend
+     */
+
+#define fb_fd		(fb_current->fd)
+
+static int fbdev_probe(const char *dev)
+{
+    return 1;
+}
+
+static int fbdev_open(const char *dev)
+{
+    fb_fd = open(dev, O_RDWR);
+    return fb_fd;
+}
+
+static void fbdev_close(void)
+{
+    close(fb_fd);
+    fb_fd = -1;
+}
+
+static int fbdev_ioctl(unsigned long request, void *arg)
+{
+    return ioctl(fb_fd, request, arg);
+}
+
+static void *fbdev_mmap(u32 len)
+{
+    return mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fb_fd, 0);
+}
+
+static int fbdev_munmap(void *addr, u32 len)
+{
+    return munmap(addr, len);
+}
+
+const struct devops fbdev_devops = {
+    .name =	"fbdev (kernel frame buffer device)",
+    .probe =	fbdev_probe,
+    .open =	fbdev_open,
+    .close =	fbdev_close,
+    .ioctl =	fbdev_ioctl,
+    .mmap =	fbdev_mmap,
+    .munmap =	fbdev_munmap,
+};
+
+
+    /*
+     *  Supported frame buffer device backends
+     */
+
+static const struct devops *all_devops[] = {
+    &vfb_devops,
+    &fbdev_devops,
+    NULL
+};
+
+
     /*
      *  Open the frame buffer device
      */
 
 void fb_open(void)
 {
+    int i;
+
     Debug("fb_open()\n");
-    if ((fb_fd = open(Opt_Fbdev, O_RDWR)) == -1) {
-	Fatal("open %s: %s\n", Opt_Fbdev, strerror(errno));
+    for (i = 0; all_devops[i]; i++)
+	if (all_devops[i]->probe(fb_current->dev))
+	    break;
+    if (!all_devops[i])
+	Fatal("No backend available for %s\n", fb_current->dev);
+    if (all_devops[i]->open(fb_current->dev) == -1) {
+	Fatal("open %s: %s\n", fb_current->dev, strerror(errno));
     }
+    fb_current->devops = all_devops[i];
+    Debug("Using devops %s\n", fb_current->devops->name);
 }
 
 
@@ -77,9 +199,9 @@ void fb_open(void)
 void fb_close(void)
 {
     Debug("fb_close()\n");
-    if (fb_fd != -1) {
-	close(fb_fd);
-	fb_fd = -1;
+    if (fb_current->devops) {
+	fb_current->devops->close();
+	fb_current->devops = NULL;
     }
 }
 
@@ -91,7 +213,7 @@ void fb_close(void)
 int fb_get_fix(void)
 {
     Debug("fb_get_fix()\n");
-    if (ioctl(fb_fd, FBIOGET_FSCREENINFO, &fb_fix) == -1) {
+    if (fb_current->devops->ioctl(FBIOGET_FSCREENINFO, &fb_fix) == -1) {
 	Fatal("ioctl FBIOGET_FSCREENINFO: %s\n", strerror(errno));
     }
     fix_validate();
@@ -106,7 +228,7 @@ int fb_get_fix(void)
 int fb_get_var(void)
 {
     Debug("fb_get_var()\n");
-    if (ioctl(fb_fd, FBIOGET_VSCREENINFO, &fb_var) == -1) {
+    if (fb_current->devops->ioctl(FBIOGET_VSCREENINFO, &fb_var) == -1) {
 	Fatal("ioctl FBIOGET_VSCREENINFO: %s\n", strerror(errno));
     }
     var_validate();
@@ -124,7 +246,7 @@ int fb_set_var(void)
     int error;
 
     Debug("fb_set_var()\n");
-    error = ioctl(fb_fd, FBIOPUT_VSCREENINFO, &fb_var);
+    error = fb_current->devops->ioctl(FBIOPUT_VSCREENINFO, &fb_var);
     var_validate_change(&var, error);
     if (error == -1) {
 	Fatal("ioctl FBIOPUT_VSCREENINFO: %s\n", strerror(errno));
@@ -140,7 +262,7 @@ int fb_set_var(void)
 int fb_get_cmap(void)
 {
     Debug("fb_get_cmap()\n");
-    if (ioctl(fb_fd, FBIOGETCMAP, &fb_cmap) == -1) {
+    if (fb_current->devops->ioctl(FBIOGETCMAP, &fb_cmap) == -1) {
 	Fatal("ioctl FBIOGETCMAP: %s\n", strerror(errno));
     }
     cmap_validate();
@@ -156,13 +278,13 @@ int fb_get_cmap(void)
 
 int fb_set_cmap(void)
 {
-    struct fb_cmap cmap = fb_cmap;
+    typeof(fb_cmap) cmap = fb_cmap;
     int error;
 
     Debug("fb_set_cmap()\n");
     if (Opt_Debug)
 	fb_dump_cmap();
-    error = ioctl(fb_fd, FBIOPUTCMAP, &fb_cmap);
+    error = fb_current->devops->ioctl(FBIOPUTCMAP, &fb_cmap);
     cmap_validate_change(&cmap, error);
     if (error == -1) {
 	Fatal("ioctl FBIOPUTCMAP: %s\n", strerror(errno));
@@ -184,7 +306,7 @@ int fb_pan(u32 xoffset, u32 yoffset)
     fb_var.xoffset = xoffset;
     fb_var.yoffset = yoffset;
     var = fb_var;
-    error = ioctl(fb_fd, FBIOPAN_DISPLAY, &fb_var);
+    error = fb_current->devops->ioctl(FBIOPAN_DISPLAY, &fb_var);
     var_validate_change(&var, error);
     if (error == -1) {
 	Fatal("ioctl FBIOPAN_DISPLAY: %s\n", strerror(errno));
@@ -193,6 +315,25 @@ int fb_pan(u32 xoffset, u32 yoffset)
 }
 
 
+    /*
+     *  Wait for the next vertical blank
+     *
+     *  Returns zero if the device doesn't support this
+     */
+
+int fb_wait_for_vsync(void)
+{
+    u32 crtc = 0;
+
+    if (fb_current->devops->ioctl(FBIO_WAITFORVSYNC, &crtc) == -1) {
+	if (errno == ENOTTY || errno == EINVAL || errno == ENOSYS)
+	    return 0;
+	Fatal("ioctl FBIO_WAITFORVSYNC: %s\n", strerror(errno));
+    }
+    return 1;
+}
+
+
     /*
      *  Map the frame buffer
      */
@@ -214,10 +355,10 @@ void fb_map(void)
     fb_len = (fb_offset+fb_fix.smem_len+~page_mask) & page_mask;
     Debug("fb_start = %lx, fb_offset = %x, fb_len = %x\n", fb_start, fb_offset,
 	  fb_len);
-    fb_addr = mmap(NULL, fb_len, PROT_READ | PROT_WRITE, MAP_SHARED, fb_fd, 0);
+    fb_addr = fb_current->devops->mmap(fb_len);
     if (fb_addr == MAP_FAILED)
 	Fatal("mmap smem: %s\n", strerror(errno));
-    fb = fb_addr+fb_offset;
+    fb_current->fb = fb_addr+fb_offset;
 }
 
 
@@ -228,21 +369,230 @@ void fb_map(void)
 void fb_unmap(void)
 {
     Debug("fb_unmap()\n");
-    if (munmap(fb_addr, fb_len) == -1)
+    if (fb_current->devops->munmap(fb_addr, fb_len) == -1)
 	Fatal("munmap smem: %s\n", strerror(errno));
 }
 
 
+    /*
+     *  Copy from/to frame buffer memory
+     *
+     *  We can't use memcpy(), because on PPC it uses dcbz, which is not
+     *  allowed on non-cacheable memory :-(
+     */
+
+void fb_memcpy(void *dst, const void *src, u32 n)
+{
+    u8 *d8 = dst;
+    const u8 *s8 = src;
+    unsigned long *d;
+    const unsigned long *s;
+    u32 m;
+
+    if (((unsigned long)d8 ^ (unsigned long)s8) & (BYTES_PER_LONG-1)) {
+	/* Different alignment */
+	while (n--)
+	    *d8++ = *s8++;
+	return;
+    }
+
+    while (n && ((unsigned long)d8 & (BYTES_PER_LONG-1))) {
+	*d8++ = *s8++;
+	n--;
+    }
+    d = (unsigned long *)d8;
+    s = (const unsigned long *)s8;
+    m = n/BYTES_PER_LONG;
+    while (m >= 8) {
+	d[0] = s[0];
+	d[1] = s[1];
+	d[2] = s[2];
+	d[3] = s[3];
+	d[4] = s[4];
+	d[5] = s[5];
+	d[6] = s[6];
+	d[7] = s[7];
+	d += 8;
+	s += 8;
+	m -= 8;
+    }
+    while (m--)
+	*d++ = *s++;
+    d8 = (u8 *)d;
+    s8 = (const u8 *)s;
+    n &= BYTES_PER_LONG-1;
+    while (n--)
+	*d8++ = *s8++;
+}
+
+
+    /*
+     *  Size of the part of the frame buffer memory used by the virtual screen
+     *
+     *  smem_len is often much larger, to allow for other video modes
+     */
+
+static u32 fb_used_len(void)
+{
+    u32 len = fb_fix.line_length*fb_var.yres_virtual;
+
+    switch (fb_fix.type) {
+	case FB_TYPE_PACKED_PIXELS:
+	    break;
+
+	case FB_TYPE_PLANES:
+	    len *= fb_var.bits_per_pixel;
+	    break;
+
+	case FB_TYPE_INTERLEAVED_PLANES:
+	    if (fb_fix.type_aux != 2)
+		len *= fb_var.bits_per_pixel;	/* ilbm */
+	    break;
+
+	default:
+	    len = 0;
+	    break;
+    }
+    if (!len || len > fb_fix.smem_len)
+	len = fb_fix.smem_len;
+    return len;
+}
+
+
+    /*
+     *  Compressed snapshots
+     *
+     *  The contents are run-length encoded in long words. Each record starts
+     *  with a control word: if SNAP_RUN is set, the next word is repeated
+     *  (control & ~SNAP_RUN) times, else (control) literal words follow.
+     *  Bytes before the first and after the last aligned long word are
+     *  stored separately.
+     */
+
+#define SNAP_RUN	(1UL << (BITS_PER_LONG-1))
+
+struct snap {
+    unsigned long *buf;
+    u32 len, size;		/* in long words */
+    u32 literal;		/* control word of open literal record */
+};
+
+static void snap_put(struct snap *snap, unsigned long val)
+{
+    if (snap->len == snap->size) {
+	snap->size = snap->size ? 2*snap->size : 16384;
+	if (!(snap->buf = realloc(snap->buf, snap->size*sizeof(*snap->buf))))
+	    Fatal("realloc %zu: %s\n", snap->size*sizeof(*snap->buf),
+		  strerror(errno));
+    }
+    snap->buf[snap->len++] = val;
+}
+
+static void snap_put_group(struct snap *snap, unsigned long val, u32 count)
+{
+    if (count > 1) {
+	snap_put(snap, SNAP_RUN | count);
+	snap_put(snap, val);
+	snap->literal = 0;
+    } else {
+	if (!snap->literal) {
+	    snap->literal = snap->len;
+	    snap_put(snap, 0);
+	}
+	snap->buf[snap->literal]++;
+	snap_put(snap, val);
+    }
+}
+
+static unsigned long *snap_compress(const u8 *src, u32 len, u32 head,
+				    u32 words)
+{
+    const unsigned long *p = (const unsigned long *)(src+head);
+    unsigned long val, prev = 0;
+    struct snap snap = { NULL, 0, 0, 0 };
+    u32 count = 0;
+    void *tmp;
+
+    memcpy(saved_head, src, head);
+    memcpy(saved_tail, src+head+words*BYTES_PER_LONG,
+	   len-head-words*BYTES_PER_LONG);
+
+    /* buf[0] is never a literal control word */
+    snap_put(&snap, words);
+    while (words--) {
+	val = *p++;
+	if (count && val == prev) {
+	    count++;
+	    continue;
+	}
+	if (count)
+	    snap_put_group(&snap, prev, count);
+	prev = val;
+	count = 1;
+    }
+    if (count)
+	snap_put_group(&snap, prev, count);
+
+    Debug("Compressed to %zu bytes\n", snap.len*sizeof(*snap.buf));
+
+    /* Release the unused space */
+    if ((tmp = realloc(snap.buf, snap.len*sizeof(*snap.buf))))
+	snap.buf = tmp;
+    return snap.buf;
+}
+
+static void snap_decompress(u8 *dst, u32 len, u32 head,
+			    const unsigned long *snap)
+{
+    unsigned long *d = (unsigned long *)(dst+head);
+    const unsigned long *s = snap;
+    u32 words = *s++;
+    unsigned long ctrl, val;
+    u32 n;
+
+    fb_memcpy(dst, saved_head, head);
+    fb_memcpy(dst+head+words*BYTES_PER_LONG, saved_tail,
+	      len-head-words*BYTES_PER_LONG);
+
+    while (words) {
+	ctrl = *s++;
+	n = ctrl & ~SNAP_RUN;
+	words -= n;
+	if (ctrl & SNAP_RUN) {
+	    val = *s++;
+	    while (n--)
+		*d++ = val;
+	} else {
+	    while (n--)
+		*d++ = *s++;
+	}
+    }
+}
+
+
     /*
      *  Save the frame buffer contents
+     *
+     *  Only the part used by the virtual screen is saved
      */
 
 void fb_save(void)
 {
-    Debug("fb_save()\n");
-    if (!(saved_fb = malloc(fb_fix.smem_len)))
-	Fatal("malloc %d: %s\n", fb_fix.smem_len, strerror(errno));
-    memcpy(saved_fb, fb, fb_fix.smem_len);
+    u32 head, words;
+
+    saved_len = fb_used_len();
+    Debug("fb_save(): %u of %u bytes\n", saved_len, fb_fix.smem_len);
+    if (Opt_Compress) {
+	head = -(unsigned long)fb_current->fb & (BYTES_PER_LONG-1);
+	if (head > saved_len)
+	    head = saved_len;
+	words = (saved_len-head)/BYTES_PER_LONG;
+	saved_fb = (u8 *)snap_compress(fb_current->fb, saved_len, head, words);
+    } else {
+	if (!(saved_fb = malloc(saved_len)))
+	    Fatal("malloc %u: %s\n", saved_len, strerror(errno));
+	fb_memcpy(saved_fb, fb_current->fb, saved_len);
+    }
 }
 
 
@@ -252,9 +602,19 @@ void fb_save(void)
 
 void fb_restore(void)
 {
+    u32 head;
+
     Debug("fb_restore()\n");
-    memcpy(fb, saved_fb, fb_fix.smem_len);
+    if (Opt_Compress) {
+	head = -(unsigned long)fb_current->fb & (BYTES_PER_LONG-1);
+	if (head > saved_len)
+	    head = saved_len;
+	snap_decompress(fb_current->fb, saved_len, head,
+			(unsigned long *)saved_fb);
+    } else
+	fb_memcpy(fb_current->fb, saved_fb, saved_len);
     free(saved_fb);
+    saved_fb = NULL;
 }
 
 
@@ -267,12 +627,13 @@ void fb_restore(void)
 
 void fb_clear(void)
 {
-    u32 size = fb_fix.smem_len/sizeof(unsigned long);
-    unsigned long *p = (unsigned long *)fb;
+    u32 size = fb_used_len()/sizeof(unsigned long);
+    unsigned long *p = (unsigned long *)fb_current->fb;
 
     Debug("fb_clear()\n");
     while (size--)
 	*p++ = 0;
+    shadow_mark_dirty(0, 0, fb_var.xres_virtual, fb_var.yres_virtual);
 }
 
 
@@ -397,7 +758,7 @@ static void cmap_validate(void)
      *  Validate a change of the colormap
      */
 
-static void cmap_validate_change(const struct fb_cmap *old, int error)
+static void cmap_validate_change(const typeof(fb_cmap) *old, int error)
 {
     /* FIXME */
 
@@ -490,12 +851,21 @@ void fb_init(void)
 
 void fb_cleanup(void)
 {
+    if (!fb_current)
+	return;
+
     Debug("fb_cleanup()\n");
+    dlist_cleanup();
+    rotate_cleanup();
+    frame_cleanup();
+    shadow_cleanup();
+    clip_cleanup();
+    workers_cleanup();
     if (saved_fb)
 	fb_restore();
-    if (fb)
+    if (fb_current->fb)
 	fb_unmap();
-    if (fb_fd != -1) {
+    if (fb_current->devops) {
 	if (saved_cmap.len) {
 	    fb_cmap = saved_cmap;
 	    RESTORE_AND_FREE_COMPONENT(red);
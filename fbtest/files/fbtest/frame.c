@@ -0,0 +1,249 @@
+/*
+ *  Page flipping
+ *
+ *  Double and triple buffering on top of panning, synchronized to the
+ *  vertical blank if the device supports FBIO_WAITFORVSYNC.
+ *
+ *  With two buffers, the back buffer is still being scanned out until the
+ *  previous flip has been latched, so begin_frame() waits for the vertical
+ *  blank. With three or more buffers, drawing can start immediately, and
+ *  end_frame() only waits if a flip is still pending.
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "frame.h"
+#include "shadow.h"
+#include "clip.h"
+#include "dlist.h"
+#include "util.h"
+
+
+    /*
+     *  Page flipping state, per frame buffer context
+     */
+
+struct frame {
+    u32 buffers;		/* 0 = not initialized, 1 = no page flipping */
+    u32 height;			/* distance between buffers, in lines */
+    u32 cur;			/* buffer shown, or about to be shown */
+    u32 back;			/* buffer being drawn */
+    int pending;		/* flip to cur not yet latched */
+    int vsync;			/* FBIO_WAITFORVSYNC is available */
+    u8 *base;
+    u64 first, last;
+    struct frame_stats stats;
+};
+
+#define frame_buffers	(fb_current->frame->buffers)
+#define frame_height	(fb_current->frame->height)
+#define frame_cur	(fb_current->frame->cur)
+#define frame_back	(fb_current->frame->back)
+#define frame_pending	(fb_current->frame->pending)
+#define frame_vsync	(fb_current->frame->vsync)
+#define frame_base	(fb_current->frame->base)
+#define frame_first	(fb_current->frame->first)
+#define frame_last	(fb_current->frame->last)
+
+
+    /*
+     *  Refresh period in microseconds, from the video timings
+     */
+
+static u32 frame_period(void)
+{
+    u64 htotal, vtotal, period;
+
+    htotal = fb_var.xres+fb_var.left_margin+fb_var.right_margin+
+	     fb_var.hsync_len;
+    vtotal = fb_var.yres+fb_var.upper_margin+fb_var.lower_margin+
+	     fb_var.vsync_len;
+    if ((fb_var.vmode & FB_VMODE_MASK) == FB_VMODE_INTERLACED)
+	vtotal /= 2;
+    else if ((fb_var.vmode & FB_VMODE_MASK) == FB_VMODE_DOUBLE)
+	vtotal *= 2;
+    period = fb_var.pixclock*htotal*vtotal/1000000;
+    /* No timings, or too short to be real (e.g. a tiny mode) */
+    if (!period)
+	return 1000000/60;
+    return period;
+}
+
+
+    /*
+     *  Byte offset of a line in the frame buffer
+     */
+
+static u32 frame_line_offset(u32 y)
+{
+    u32 len = y*fb_fix.line_length;
+
+    if (fb_fix.type == FB_TYPE_INTERLEAVED_PLANES && fb_fix.type_aux != 2)
+	len *= fb_var.bits_per_pixel;	/* ilbm */
+    return len;
+}
+
+
+    /*
+     *  Wait for the pending flip to be latched
+     */
+
+static void frame_wait_vsync(void)
+{
+    if (frame_vsync)
+	frame_vsync = fb_wait_for_vsync();
+    frame_pending = 0;
+}
+
+
+    /*
+     *  Initialization
+     */
+
+u32 frame_init(u32 num_buffers)
+{
+    u32 n = 1;
+
+    Debug("frame_init(%u)\n", num_buffers);
+    if (!fb_current->frame &&
+	!(fb_current->frame = calloc(1, sizeof(struct frame))))
+	Fatal("calloc %zu: %s\n", sizeof(struct frame), strerror(errno));
+    frame_cleanup();
+
+    frame_base = fb_current->fb;
+    frame_height = fb_var.yres;
+    if (fb_fix.ypanstep) {
+	frame_height = (fb_var.yres+fb_fix.ypanstep-1)/fb_fix.ypanstep*
+		       fb_fix.ypanstep;
+	n = (fb_var.yres_virtual-fb_var.yres)/frame_height+1;
+    }
+    frame_buffers = num_buffers ? min(num_buffers, n) : 1;
+    if (frame_buffers > 1)
+	clip_set_screen(fb_var.xres_virtual, frame_height);
+    frame_cur = 0;
+    frame_back = 0;
+    frame_pending = 0;
+    if (fb_var.yoffset)
+	fb_pan(fb_var.xoffset, 0);
+
+    frame_vsync = fb_wait_for_vsync();
+    memset(&fb_current->frame->stats, 0, sizeof(struct frame_stats));
+    fb_current->frame->stats.period = frame_period();
+    frame_first = frame_last = 0;
+
+    Message("Using %u frame buffer(s), %svsync\n", frame_buffers,
+	    frame_vsync ? "" : "no ");
+    return frame_buffers;
+}
+
+
+    /*
+     *  Clean up
+     */
+
+void frame_cleanup(void)
+{
+    if (!fb_current->frame || !frame_buffers)
+	return;
+
+    Debug("frame_cleanup()\n");
+    dlist_submit();
+    if (frame_buffers > 1) {
+	if (frame_pending)
+	    frame_wait_vsync();
+	if (fb_current->fb != frame_base) {
+	    fb_current->fb = frame_base;
+	    drawops_retarget();
+	}
+	if (fb_var.yoffset)
+	    fb_pan(fb_var.xoffset, 0);
+	clip_set_screen(fb_var.xres_virtual, fb_var.yres_virtual);
+    }
+    frame_buffers = 0;
+}
+
+
+    /*
+     *  Start drawing a frame
+     */
+
+void begin_frame(void)
+{
+    if (!fb_current->frame || frame_buffers < 2)
+	return;
+
+    dlist_submit();
+    frame_back = (frame_cur+1) % frame_buffers;
+    if (frame_pending && frame_buffers == 2)
+	frame_wait_vsync();
+    fb_current->fb = frame_base+frame_line_offset(frame_back*frame_height);
+    drawops_retarget();
+}
+
+
+    /*
+     *  Finish drawing a frame and show it
+     */
+
+static void frame_account(void)
+{
+    struct frame_stats *stats = &fb_current->frame->stats;
+    u64 now = get_ticks();
+    u32 vblanks;
+
+    if (stats->frames) {
+	vblanks = (now-frame_last+stats->period/2)/stats->period;
+	if (vblanks > 1) {
+	    stats->late++;
+	    stats->missed += vblanks-1;
+	}
+    } else
+	frame_first = now;
+    frame_last = now;
+    stats->frames++;
+    stats->usecs = frame_last-frame_first;
+}
+
+void end_frame(void)
+{
+    dlist_submit();
+    shadow_flush();
+    if (!fb_current->frame)
+	return;
+    if (frame_buffers < 2) {
+	/* No page flipping, at least pace to the refresh rate */
+	if (frame_buffers)
+	    frame_wait_vsync();
+	frame_account();
+	return;
+    }
+
+    if (frame_pending)
+	frame_wait_vsync();
+    fb_pan(fb_var.xoffset, frame_back*frame_height);
+    frame_cur = frame_back;
+    frame_pending = frame_vsync;
+    frame_account();
+}
+
+
+    /*
+     *  Statistics
+     */
+
+void frame_get_stats(struct frame_stats *stats)
+{
+    if (fb_current->frame)
+	*stats = fb_current->frame->stats;
+    else
+	memset(stats, 0, sizeof(*stats));
+}
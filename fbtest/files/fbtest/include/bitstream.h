@@ -28,6 +28,21 @@ extern void bitcpy_not(unsigned long *dst, int dst_idx,
 		       const unsigned long *src, int src_idx, u32 n);
 
 
+    /*
+     *  Funnel shifts of whole words for the above, using vector operations if
+     *  available
+     *
+     *  These return the number of words done, and leave the rest to the
+     *  caller.
+     */
+
+extern u32 bitshift(unsigned long *dst, const unsigned long *src, u32 n,
+		    int left, unsigned long *d0, unsigned long inv);
+extern u32 bitshift_rev(unsigned long *dst, const unsigned long *src, u32 n,
+			int left, unsigned long *d0, unsigned long inv);
+extern const char *bitshift_name(void);
+
+
     /*
      *   Pattern fill
      */
@@ -36,3 +51,59 @@ extern void bitfill32(unsigned long *dst, int dst_idx, u32 pat, u32 n);
 extern void bitfill(unsigned long *dst, int dst_idx, unsigned long pat,
 		    int left, int right, u32 n);
 
+
+    /*
+     *  Byte aligned 32-bit pattern fill, using vector stores if available
+     *
+     *  Non-temporal stores bypass the cache, which pays off for fills that
+     *  are larger than the cache.
+     */
+
+extern void memfill32(void *dst, u32 pat, u32 n, int nontemporal);
+extern const char *memfill32_name(void);
+
+
+    /*
+     *  Byte aligned 24-bit pattern fill, using vector stores if available
+     *
+     *  The pixel is stored most significant byte first, and n must be a
+     *  multiple of 3.
+     */
+
+extern void memfill24(void *dst, u32 pixel, u32 n, int nontemporal);
+extern const char *memfill24_name(void);
+
+
+    /*
+     *  Byte aligned copy, using vector loads and stores if available
+     *
+     *  Source and destination may overlap.
+     */
+
+extern void memcopy(void *dst, const void *src, u32 n);
+extern const char *memcopy_name(void);
+
+
+
+    /*
+     *  Porter-Duff source over compositing of premultiplied ARGB8888 pixels
+     *  into ARGB8888 or RGB565 pixels, using vector operations if available
+     *
+     *  blend32() doesn't modify the destination bits set in keep.
+     */
+
+extern void blend32(u32 *dst, const u32 *src, u32 n, u32 keep);
+extern void blend16(u16 *dst, const u32 *src, u32 n);
+extern const char *blend_name(void);
+
+
+    /*
+     *  Chunky to planar conversion of groups of 16 8-bit pixels, using vector
+     *  operations if available
+     *
+     *  Each group becomes depth consecutive plane words, as in iplan2, with
+     *  the first pixel in the most significant bit.
+     */
+
+extern void c2p(u16 *dst, const u8 *src, u32 groups, u32 depth);
+extern const char *c2p_name(void);
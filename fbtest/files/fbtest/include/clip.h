@@ -0,0 +1,23 @@
+/*
+ *  Clipping
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+
+    /*
+     *  Clip all drawing operations to a rectangle
+     *
+     *  clip_init() must be called before shadow_init(). clip_push() narrows
+     *  the clip rectangle to its intersection with the given rectangle, until
+     *  the matching clip_pop(). clip_set_screen() changes the outer bounds,
+     *  e.g. to the size of a back buffer.
+     */
+
+extern void clip_init(void);
+extern void clip_cleanup(void);
+extern void clip_set_screen(u32 width, u32 height);
+extern void clip_push(int x, int y, int width, int height);
+extern void clip_pop(void);
@@ -15,7 +15,7 @@ extern const rgba_t clut_console[16];
 extern const rgba_t clut_vga[16];
 extern const rgba_t clut_windows[4];
 
-extern void clut_create_rgbcube(rgba_t *clut, u32 rlen, u32 glen, u32 blen);
-extern void clut_create_linear(rgba_t *clut, u32 len);
+extern void clut_create_rgbcube(rgba_t *table, u32 rlen, u32 glen, u32 blen);
+extern void clut_create_linear(rgba_t *table, u32 len);
 extern void clut_init_nice(void);
 
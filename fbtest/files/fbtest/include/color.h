@@ -13,7 +13,7 @@
 extern u32 color_error(const rgba_t *a, const rgba_t *b);
 extern void color_add(rgba_t *a, const rgba_t *b, const rgba_t *c);
 extern void color_sub(rgba_t *a, const rgba_t *b, const rgba_t *c);
-extern u32 color_find(const rgba_t *color, const rgba_t *clut, u32 clutsize);
+extern u32 color_find(const rgba_t *color, const rgba_t *table, u32 size);
 
 
     /*
@@ -0,0 +1,25 @@
+/*
+ *  Display lists
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+
+    /*
+     *  Record drawing operations and draw them sorted by band
+     *
+     *  All drawing between dlist_begin() and dlist_end() is deferred, and
+     *  bitmaps and pixmaps are copied. dlist_submit() draws the pending
+     *  commands, e.g. before looking at the frame buffer contents. This needs
+     *  the clipping layer, without it drawing stays immediate.
+     *
+     *  The display list is a drawops layer, so no other layer (e.g. rotation)
+     *  may be pushed or popped between dlist_begin() and dlist_end().
+     */
+
+extern void dlist_begin(void);
+extern void dlist_submit(void);
+extern void dlist_end(void);
+extern void dlist_cleanup(void);
@@ -12,6 +12,28 @@
  */
 
 
+    /*
+     *  A horizontal span, for filling shapes one line at a time
+     */
+
+struct span {
+    u32 x, y, length;
+};
+
+    /*
+     *  Polygons are given by their vertices, and filled according to a fill
+     *  rule for self-intersecting polygons
+     */
+
+struct point {
+    u32 x, y;
+};
+
+enum fill_rule {
+    FILL_EVEN_ODD,	/* odd number of crossings */
+    FILL_NON_ZERO,	/* non-zero winding number */
+};
+
 struct drawops {
     const char *name;
     int (*init)(void);
@@ -21,49 +43,89 @@ struct drawops {
     void (*draw_vline)(u32 x, u32 y, u32 length, pixel_t pixel);
     void (*draw_rect)(u32 x, u32 y, u32 width, u32 height, pixel_t pixel);
     void (*fill_rect)(u32 x, u32 y, u32 width, u32 height, pixel_t pixel);
+    void (*fill_spans)(const struct span *spans, u32 num, pixel_t pixel);
     void (*draw_line)(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel);
     void (*expand_bitmap)(u32 x, u32 y, u32 width, u32 height, const u8 *data,
 			  u32 pitch, pixel_t pixel0, pixel_t pixel1);
     void (*draw_pixmap)(u32 x, u32 y, u32 width, u32 height,
 			  const pixel_t *pixmap);
+    void (*draw_chunky)(u32 x, u32 y, u32 width, u32 height, const u8 *data,
+			u32 pitch);
     void (*draw_circle)(u32 x, u32 y, u32 r, pixel_t pixel);
     void (*fill_circle)(u32 x, u32 y, u32 r, pixel_t pixel);
     void (*draw_ellipse)(u32 x, u32 y, u32 a, u32 b, pixel_t pixel);
     void (*fill_ellipse)(u32 x, u32 y, u32 a, u32 b, pixel_t pixel);
     void (*copy_rect)(u32 dx, u32 dy, u32 width, u32 height, u32 sx, u32 sy);
+    void (*fill_polygon)(const struct point *points, u32 num,
+			 enum fill_rule rule, pixel_t pixel);
+    void (*blend_rect)(u32 x, u32 y, u32 width, u32 height, u32 argb);
+    void (*blend_pixmap)(u32 x, u32 y, u32 width, u32 height, const u32 *argb);
     /* FIXME: text */
 };
 
-extern struct drawops drawops;
+    /*
+     *  Current drawing operations
+     *
+     *  The drawing operations of the current context are the operations used
+     *  by the application. Layers (e.g. the shadow frame buffer) may be
+     *  stacked on top of fb_drawops, which are the plain frame buffer level
+     *  operations. Code implementing the frame buffer level operations
+     *  defines DRAWOPS as fb_drawops, so it doesn't recurse into the layers.
+     */
+
+#define fb_drawops	(*fb_current->fbops)
 
+#ifndef DRAWOPS
+#define DRAWOPS		(*fb_current->drawops)
+#endif
 
-#define set_pixel(x, y, pixel)	drawops.set_pixel((x), (y), (pixel))
-#define get_pixel(x, y)	drawops.get_pixel((x), (y))
+#define set_pixel(x, y, pixel)	DRAWOPS.set_pixel((x), (y), (pixel))
+#define get_pixel(x, y)	DRAWOPS.get_pixel((x), (y))
 #define draw_hline(x, y, length, pixel)	\
-    drawops.draw_hline((x), (y), (length), (pixel))
+    DRAWOPS.draw_hline((x), (y), (length), (pixel))
 #define draw_vline(x, y, length, pixel)	\
-    drawops.draw_vline((x), (y), (length), (pixel))
+    DRAWOPS.draw_vline((x), (y), (length), (pixel))
 #define draw_rect(x, y, width, height, pixel)	\
-    drawops.draw_rect((x), (y), (width), (height), (pixel))
+    DRAWOPS.draw_rect((x), (y), (width), (height), (pixel))
 #define fill_rect(x, y, width, height, pixel)	\
-    drawops.fill_rect((x), (y), (width), (height), (pixel))
+    DRAWOPS.fill_rect((x), (y), (width), (height), (pixel))
+#define fill_spans(spans, num, pixel)	\
+    DRAWOPS.fill_spans((spans), (num), (pixel))
 #define draw_line(x1, y1, x2, y2, pixel)	\
-    drawops.draw_line((x1), (y1), (x2), (y2), (pixel))
+    DRAWOPS.draw_line((x1), (y1), (x2), (y2), (pixel))
 #define expand_bitmap(x, y, width, height, data, pitch, pixel0, pixel1)	\
-    drawops.expand_bitmap((x), (y), (width), (height), (data), (pitch),	\
+    DRAWOPS.expand_bitmap((x), (y), (width), (height), (data), (pitch),	\
 			  (pixel0), (pixel1))
 #define draw_pixmap(x, y, width, height, pixmap)	\
-    drawops.draw_pixmap((x), (y), (width), (height), (pixmap))
+    DRAWOPS.draw_pixmap((x), (y), (width), (height), (pixmap))
+    /* 8-bit pixels, e.g. to flush a chunky back buffer */
+#define draw_chunky(x, y, width, height, data, pitch)	\
+    DRAWOPS.draw_chunky((x), (y), (width), (height), (data), (pitch))
 #define draw_circle(x, y, r, pixel)	\
-    drawops.draw_circle((x), (y), (r), (pixel))
+    DRAWOPS.draw_circle((x), (y), (r), (pixel))
 #define fill_circle(x, y, r, pixel)	\
-    drawops.fill_circle((x), (y), (r), (pixel))
+    DRAWOPS.fill_circle((x), (y), (r), (pixel))
 #define draw_ellipse(x, y, a, b, pixel)	\
-    drawops.draw_ellipse((x), (y), (a), (b), (pixel))
+    DRAWOPS.draw_ellipse((x), (y), (a), (b), (pixel))
 #define fill_ellipse(x, y, a, b, pixel)	\
-    drawops.fill_ellipse((x), (y), (a), (b), (pixel))
+    DRAWOPS.fill_ellipse((x), (y), (a), (b), (pixel))
 #define copy_rect(dx, dy, width, height, sx, sy)	\
-    drawops.copy_rect((dx), (dy), (width), (height), (sx), (sy))
+    DRAWOPS.copy_rect((dx), (dy), (width), (height), (sx), (sy))
+#define fill_polygon(points, num, rule, pixel)	\
+    DRAWOPS.fill_polygon((points), (num), (rule), (pixel))
+
+    /*
+     *  Porter-Duff source over compositing
+     *
+     *  The source pixels are premultiplied ARGB8888 values, i.e. each color
+     *  component has already been multiplied by alpha/255. Only truecolor and
+     *  directcolor visuals are supported.
+     */
+
+#define blend_rect(x, y, width, height, argb)	\
+    DRAWOPS.blend_rect((x), (y), (width), (height), (argb))
+#define blend_pixmap(x, y, width, height, argb)	\
+    DRAWOPS.blend_pixmap((x), (y), (width), (height), (argb))
 
 
     /*
@@ -90,18 +152,34 @@ extern void generic_draw_rect(u32 x, u32 y, u32 width, u32 height,
 			      pixel_t pixel);
 extern void generic_fill_rect(u32 x, u32 y, u32 width, u32 height,
 			      pixel_t pixel);
+extern void generic_fill_spans(const struct span *spans, u32 num,
+			       pixel_t pixel);
 extern void generic_draw_line(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel);
 extern void generic_expand_bitmap(u32 x, u32 y, u32 width, u32 height,
 				  const u8 *data, u32 pitch, pixel_t pixel0,
 				  pixel_t pixel1);
 extern void generic_draw_pixmap(u32 x, u32 y, u32 width, u32 height,
 				const pixel_t *data);
+extern void generic_draw_chunky(u32 x, u32 y, u32 width, u32 height,
+				const u8 *data, u32 pitch);
 extern void generic_draw_circle(u32 x, u32 y, u32 r, pixel_t pixel);
 extern void generic_fill_circle(u32 x, u32 y, u32 r, pixel_t pixel);
 extern void generic_draw_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel);
 extern void generic_fill_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel);
 extern void generic_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx,
 			      u32 sy);
+extern void generic_fill_polygon(const struct point *points, u32 num,
+				 enum fill_rule rule, pixel_t pixel);
+extern void generic_blend_rect(u32 x, u32 y, u32 width, u32 height, u32 argb);
+extern void generic_blend_pixmap(u32 x, u32 y, u32 width, u32 height,
+				 const u32 *argb);
+
+    /*
+     *  Generic drawing operations specialized for the current packed pixel
+     *  depth, or NULL. Operations that are not specialized are NULL.
+     */
+
+extern const struct drawops *packed_drawops(void);
 
 
     /*
@@ -111,8 +189,43 @@ extern void generic_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx,
 extern int cfb_init(void);
 extern void cfb_draw_hline(u32 x, u32 y, u32 length, pixel_t pixel);
 extern void cfb_fill_rect(u32 x, u32 y, u32 width, u32 height, pixel_t pixel);
+extern void cfb_expand_bitmap(u32 x, u32 y, u32 width, u32 height,
+			      const u8 *data, u32 pitch, pixel_t pixel0,
+			      pixel_t pixel1);
 extern void cfb_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx,
 			  u32 sy);
+extern void cfb_blend_rect(u32 x, u32 y, u32 width, u32 height, u32 argb);
+extern void cfb_blend_pixmap(u32 x, u32 y, u32 width, u32 height,
+			     const u32 *argb);
+
+    /*
+     *  Lines and pixmaps at 1, 2 and 4 bpp
+     */
+
+extern void cfb_draw_line(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel);
+extern void cfb_draw_pixmap(u32 x, u32 y, u32 width, u32 height,
+			    const pixel_t *pixmap);
+
+    /*
+     *  Lines at 8, 16, 24 and 32 bpp, drawn by stepping a pointer
+     *
+     *  cfb_line_init() draws horizontal lines itself and returns 0, else it
+     *  sets up a line of length+1 pixels, starting at dst. For each pixel
+     *  after the first one, the error term, starting at -dmajor/2, is
+     *  incremented by dminor. If it becomes non-negative, dst is moved by
+     *  minor bytes, and dmajor is subtracted. dst is always moved by major
+     *  bytes.
+     */
+
+struct cfb_line {
+    u8 *dst;
+    long major, minor;
+    int dmajor, dminor;
+    u32 length;
+};
+
+extern int cfb_line_init(struct cfb_line *line, u32 x1, u32 y1, u32 x2,
+			 u32 y2, pixel_t pixel);
 
 
     /*
@@ -120,4 +233,21 @@ extern void cfb_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx,
      */
 
 extern void drawops_init(void);
+extern void drawops_retarget(void);
+
+
+    /*
+     *  Layers
+     *
+     *  drawops_push_layer() installs the non-NULL operations of a layer on
+     *  top of the current drawing operations, and saves the previous ones in
+     *  *below, to be called by the layer. Layers must be popped in reverse
+     *  order. drawops_layer_on_top() tells whether all operations of a layer
+     *  are still installed, i.e. nothing was pushed on top of it.
+     */
+
+extern void drawops_push_layer(const struct drawops *layer,
+			       struct drawops *below);
+extern void drawops_pop_layer(const struct drawops *below);
+extern int drawops_layer_on_top(const struct drawops *layer);
 
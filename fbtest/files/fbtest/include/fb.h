@@ -10,13 +10,124 @@
 #include <linux/fb.h>
 
 
+    /*
+     *  Frame buffer device backends
+     *
+     *  The ioctl() and mmap() calls are routed through these, so the test
+     *  suite can run on a real frame buffer device or on a memory-backed
+     *  virtual one
+     */
+
+struct devops {
+    const char *name;
+    int (*probe)(const char *dev);
+    int (*open)(const char *dev);
+    void (*close)(void);
+    int (*ioctl)(unsigned long request, void *arg);
+    void *(*mmap)(u32 len);
+    int (*munmap)(void *addr, u32 len);
+};
+
+extern const struct devops fbdev_devops;
+extern const struct devops vfb_devops;
+
+
+    /*
+     *  Frame buffer context
+     *
+     *  All state of an opened frame buffer device. Each thread has a current
+     *  context, selected using fb_select(), on which the frame buffer,
+     *  drawing and visual routines operate. Several contexts can be used
+     *  concurrently from different threads, but a context must not be
+     *  current in more than one thread at the same time. The only exception
+     *  are its own worker threads, which run frame buffer level drawing
+     *  operations while the owning thread waits for them.
+     *
+     *  Most members are accessed through the macros below and in drawops.h
+     *  and visual.h, never directly, as those macros have the same names.
+     */
+
+struct drawops;
+struct visops;
+struct frame;
+struct shadow;
+struct clip;
+struct dlist;
+struct rotate;
+struct workers;
+
+struct fb_context {
+    /* Device */
+    const char *dev;
+    const struct devops *devops;
+    int fd;				/* kernel backend */
+    void *devpriv;			/* other backends */
+    struct fb_fix_screeninfo fix;
+    struct fb_var_screeninfo var;
+    struct fb_cmap cmap;
+
+    /* Mapping */
+    unsigned long map_start;
+    u32 map_len, map_offset;
+    void *map_addr;
+    u8 *fb;
+
+    /* Saved device state */
+    struct fb_var_screeninfo saved_var;
+    struct fb_fix_screeninfo saved_fix;
+    struct fb_cmap saved_cmap;
+    u16 *saved_red, *saved_green, *saved_blue, *saved_transp;
+    u8 *saved_fb;
+    u32 saved_len;
+    u8 saved_head[BYTES_PER_LONG], saved_tail[BYTES_PER_LONG];
+
+    /* Drawing operations */
+    struct drawops *drawops, *fbops;
+    u8 *draw_screen;
+    u32 draw_width, draw_next_line, draw_next_plane;
+    int no_simd;			/* use the scalar code paths only */
+    u32 expand_tab[16][4];		/* expand_bitmap() nibble patterns */
+    pixel_t expand_pixel0, expand_pixel1;
+    u32 expand_bpp;			/* 0 if expand_tab is not valid */
+
+    /* Visual operations and visuals */
+    struct visops *visops;
+    int visual;
+    pixel_t black_pixel, white_pixel;
+    u32 gray_len, gray_bits;
+    const pixel_t *gray_pixel;
+    u32 idx_len, idx_bits;
+    const pixel_t *idx_pixel;
+    rgba_t *clut;
+    u32 red_len, green_len, blue_len, alpha_len;
+    u32 red_bits, green_bits, blue_bits, alpha_bits;
+    const pixel_t *red_pixel, *green_pixel, *blue_pixel, *alpha_pixel;
+
+    /* Page flipping, shadow frame buffer, clipping, display lists, rotation */
+    struct frame *frame;
+    struct shadow *shadow;
+    struct clip *clip;
+    struct dlist *dlist;
+    struct rotate *rotate;
+
+    /* Worker threads */
+    struct workers *workers;
+};
+
+extern __thread struct fb_context *fb_current;
+
+extern struct fb_context *fb_context_alloc(const char *dev);
+extern void fb_context_free(struct fb_context *ctx);
+extern void fb_select(struct fb_context *ctx);
+
+
     /*
      *  Frame buffer device kernel API
      */
 
-extern struct fb_var_screeninfo fb_var;
-extern struct fb_fix_screeninfo fb_fix;
-extern struct fb_cmap fb_cmap;
+#define fb_var		(fb_current->var)
+#define fb_fix		(fb_current->fix)
+#define fb_cmap		(fb_current->cmap)
 
 extern void fb_open(void);
 extern void fb_close(void);
@@ -26,6 +137,7 @@ extern int fb_set_var(void);
 extern int fb_get_cmap(void);
 extern int fb_set_cmap(void);
 extern int fb_pan(u32 xoffset, u32 yoffset);
+extern int fb_wait_for_vsync(void);
 extern void fb_map(void);
 extern void fb_unmap(void);
 
@@ -40,7 +152,10 @@ extern void fb_cleanup(void);
 
     /*
      *  Mapped frame buffer
+     *
+     *  Drawing goes to fb_current->fb, which points to the mapped frame
+     *  buffer, or to the shadow frame buffer or page flipping back buffer
+     *  that replaces it.
      */
 
-extern u8 *fb;
-
+extern void fb_memcpy(void *dst, const void *src, u32 n);
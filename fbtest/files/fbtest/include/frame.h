@@ -0,0 +1,36 @@
+/*
+ *  Page flipping
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+
+    /*
+     *  Frame statistics
+     */
+
+struct frame_stats {
+    u32 frames;		/* number of frames shown */
+    u32 late;		/* frames that were shown after their vblank */
+    u32 missed;		/* total number of vblanks missed by late frames */
+    u64 usecs;		/* time between the first and the last frame */
+    u32 period;		/* refresh period in microseconds */
+};
+
+
+    /*
+     *  Frame API
+     *
+     *  frame_init() carves the virtual screen into (at most) the requested
+     *  number of buffers and returns the number of buffers available.
+     *  Between begin_frame() and end_frame(), fb and the drawing operations
+     *  point to the back buffer, using the coordinates of the visible screen
+     */
+
+extern u32 frame_init(u32 num_buffers);
+extern void frame_cleanup(void);
+extern void begin_frame(void);
+extern void end_frame(void);
+extern void frame_get_stats(struct frame_stats *stats);
@@ -0,0 +1,26 @@
+/*
+ *  Rotated display
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+
+    /*
+     *  Draw on a logical screen, rotated clockwise by FB_ROTATE_CW,
+     *  FB_ROTATE_UD or FB_ROTATE_CCW quarter turns (e.g. fb_var.rotate)
+     *
+     *  rotate_init() must be called after clip_init() and shadow_init(), and
+     *  outside of display lists. FB_ROTATE_UR removes the rotation. The
+     *  logical screen is rotate_xres() by rotate_yres() pixels, and clip
+     *  rectangles and display lists started while rotated are in logical
+     *  coordinates. rotate_map_rect() maps a logical rectangle to the frame
+     *  buffer.
+     */
+
+extern void rotate_init(u32 angle);
+extern void rotate_cleanup(void);
+extern u32 rotate_xres(void);
+extern u32 rotate_yres(void);
+extern void rotate_map_rect(int *x, int *y, int *width, int *height);
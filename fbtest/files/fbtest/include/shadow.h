@@ -0,0 +1,21 @@
+/*
+ *  Shadow frame buffer
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+
+    /*
+     *  Draw in a copy of the frame buffer in normal (cached) memory, and copy
+     *  only the modified tiles to the real frame buffer on flush.
+     *
+     *  shadow_init() must be called before frame_init(). end_frame() flushes
+     *  automatically.
+     */
+
+extern void shadow_init(void);
+extern void shadow_cleanup(void);
+extern void shadow_flush(void);
+extern void shadow_mark_dirty(int x, int y, int width, int height);
@@ -67,6 +67,21 @@ extern const struct test test010;
 extern const struct test test011;
 extern const struct test test012;
 extern const struct test test013;
+extern const struct test test014;
+extern const struct test test015;
+extern const struct test test016;
+extern const struct test test017;
+extern const struct test test018;
+extern const struct test test019;
+extern const struct test test020;
+extern const struct test test021;
+extern const struct test test022;
+extern const struct test test023;
+extern const struct test test024;
+extern const struct test test025;
+extern const struct test test026;
+extern const struct test test027;
+extern const struct test test028;
 
 
     /*
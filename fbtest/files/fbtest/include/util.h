@@ -81,6 +81,13 @@ extern void wait_for_key(int timeout);
 extern void wait_ms(int ms);
 
 
+    /*
+     *  Time stamp in microseconds
+     */
+
+extern u64 get_ticks(void);
+
+
     /*
      *  Benchmarking
      */
@@ -103,9 +110,13 @@ extern double benchmark(void (*func)(unsigned long n, void *data), void *data);
      *   Command line options
      */
 
-extern const char *Opt_Fbdev;
+extern const char *Opt_Fbdev[];
+extern int Opt_NumFbdev;
+extern int Opt_Compress;
 extern int Opt_Debug;
 extern int Opt_List;
 extern int Opt_Quiet;
+extern int Opt_Shadow;
+extern int Opt_Threads;
 extern int Opt_Verbose;
 
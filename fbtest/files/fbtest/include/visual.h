@@ -34,55 +34,51 @@ enum visual_id {
 extern int visual_set(enum visual_id id);
 
 
+    /*
+     *  The visual state below consists of members of the current frame buffer
+     *  context, e.g. fb_current->black_pixel
+     */
+
+
     /*
      *  Generic mode
      */
 
 #define match_color(color)	\
-    visops.match_color((color), NULL)
+    fb_current->visops->match_color((color), NULL)
 #define match_color_error(color, error)	\
-    visops.match_color((color), (error)
+    fb_current->visops->match_color((color), (error)
 
 
     /*
-     *  Monochrome
+     *  Monochrome: black_pixel, white_pixel
      */
 
-extern pixel_t black_pixel, white_pixel;
-
 
     /*
-     *   Grayscale
+     *   Grayscale: gray_len, gray_bits, gray_pixel
      */
 
-extern u32 gray_len, gray_bits;
-extern const pixel_t *gray_pixel;
-
 
     /*
-     *  Pseudocolor CLUT
+     *  Pseudocolor CLUT: idx_len, idx_bits, idx_pixel, clut
      */
 
-extern u32 idx_len, idx_bits;
-extern const pixel_t *idx_pixel;
-extern rgba_t *clut;
-
 extern void clut_update(void);
 
 
     /*
-     *   RGB(A) for Truecolor
+     *   RGB(A) for Truecolor: red_len, green_len, blue_len, alpha_len,
+     *   red_bits, green_bits, blue_bits, alpha_bits, red_pixel, green_pixel,
+     *   blue_pixel, alpha_pixel
      */
 
-extern u32 red_len, green_len, blue_len, alpha_len;
-extern u32 red_bits, green_bits, blue_bits, alpha_bits;
-extern const pixel_t *red_pixel, *green_pixel, *blue_pixel, *alpha_pixel;
-
 #define rgba_pixel(r, g, b, a)	\
-    (red_pixel[(r)] | green_pixel[(g)] | blue_pixel[(b)] |	\
-     (alpha_pixel ? alpha_pixel[(a)] : 0))
+    (fb_current->red_pixel[(r)] | fb_current->green_pixel[(g)] |	\
+     fb_current->blue_pixel[(b)] |	\
+     (fb_current->alpha_pixel ? fb_current->alpha_pixel[(a)] : 0))
 #define rgb_pixel(r, g, b)	\
-    rgba_pixel((r), (g), (b), alpha_len-1)
+    rgba_pixel((r), (g), (b), fb_current->alpha_len-1)
 
 
     /*
@@ -0,0 +1,22 @@
+/*
+ *  Worker threads
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+
+    /*
+     *  Draw large rectangles and pixmaps using several threads
+     *
+     *  workers_init() must be called right after drawops_init(), before any
+     *  other layer is pushed. By default one thread per online CPU is used,
+     *  workers_set_threads() limits this, e.g. for benchmarking.
+     */
+
+extern void workers_init(void);
+extern void workers_cleanup(void);
+extern u32 workers_get_threads(void);
+extern u32 workers_max_threads(void);
+extern void workers_set_threads(u32 n);
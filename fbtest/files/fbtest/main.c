@@ -9,6 +9,7 @@
  *  more details.
  */
 
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,17 +21,25 @@
 #include "drawops.h"
 #include "visual.h"
 #include "visops.h"
+#include "shadow.h"
+#include "clip.h"
+#include "workers.h"
 #include "test.h"
 
 #define DEFAULT_FBDEV	"/dev/fb0"
+#define MAX_FBDEV	8
 
 
 const char *ProgramName;
 
-const char *Opt_Fbdev = DEFAULT_FBDEV;
+const char *Opt_Fbdev[MAX_FBDEV] = { DEFAULT_FBDEV };
+int Opt_NumFbdev = 0;
+int Opt_Compress = 0;
 int Opt_Debug = 0;
 int Opt_List = 0;
 int Opt_Quiet = 0;
+int Opt_Shadow = 0;
+int Opt_Threads = 0;
 int Opt_Verbose = 0;
 
 
@@ -46,12 +55,18 @@ static void Usage(void)
 	   "Valid options are:\n"
 	   "    -h, --help       Display this usage information\n"
 	   "    -f, --fbdev dev  Specify frame buffer device (default: %s)\n"
+	   "                     Use vfb[:options] for a virtual frame buffer\n"
+	   "                     Repeat to test up to %u devices concurrently\n"
+	   "    -z, --compress   Compress the saved frame buffer contents\n"
 	   "    -d, --debug      Enable debug mode\n"
 	   "    -l, --list       List tests only, don't run them\n"
 	   "    -q, --quiet      Suppress messages\n"
+	   "    -s, --shadow     Draw in a shadow frame buffer\n"
+	   "    -j, --threads n  Draw large areas using n threads (default: "
+	   "all CPUs)\n"
 	   "    -v, --verbose    Enable verbose mode\n"
 	   "\n",
-	   ProgramName, DEFAULT_FBDEV);
+	   ProgramName, DEFAULT_FBDEV, MAX_FBDEV);
     exit(1);
 }
 
@@ -67,6 +82,39 @@ static void SigHandler(int signo)
 }
 
 
+    /*
+     *  Run the tests on one frame buffer device
+     */
+
+static int Test_Argc;
+static char **Test_Argv;
+
+static void *run_tests(void *dev)
+{
+    struct fb_context *ctx = fb_context_alloc(dev);
+    int i;
+
+    fb_select(ctx);
+    fb_init();
+    drawops_init();
+    workers_init();
+    clip_init();
+    visops_init();
+    if (Opt_Shadow)
+	shadow_init();
+
+    if (Test_Argc < 2) {
+	Message("Running all tests\n");
+	test_run(NULL);
+    } else
+	for (i = 1; i < Test_Argc; i++)
+	    test_run(Test_Argv[i]);
+    fb_cleanup();
+    fb_context_free(ctx);
+    return NULL;
+}
+
+
     /*
      *  Main routine
      */
@@ -81,11 +129,17 @@ int main(int argc, char *argv[])
 	else if (!strcmp(argv[1], "-f") || !strcmp(argv[1], "--fbdev")) {
 	    if (argc <= 2)
 		Usage();
+	    else if (Opt_NumFbdev == MAX_FBDEV)
+		Fatal("Too many frame buffer devices (max %u)\n", MAX_FBDEV);
 	    else {
-		Opt_Fbdev = argv[2];
+		Opt_Fbdev[Opt_NumFbdev++] = argv[2];
 		argv += 2;
 		argc -= 2;
 	    }
+	} else if (!strcmp(argv[1], "-z") || !strcmp(argv[1], "--compress")) {
+	    Opt_Compress = 1;
+	    argv++;
+	    argc--;
 	} else if (!strcmp(argv[1], "-d") || !strcmp(argv[1], "--debug")) {
 	    Opt_Debug = 1;
 	    argv++;
@@ -98,6 +152,15 @@ int main(int argc, char *argv[])
 	    Opt_Quiet = 1;
 	    argv++;
 	    argc--;
+	} else if (!strcmp(argv[1], "-s") || !strcmp(argv[1], "--shadow")) {
+	    Opt_Shadow = 1;
+	    argv++;
+	    argc--;
+	} else if (!strcmp(argv[1], "-j") || !strcmp(argv[1], "--threads")) {
+	    if (argc <= 2 || (Opt_Threads = atoi(argv[2])) <= 0)
+		Usage();
+	    argv += 2;
+	    argc -= 2;
 	} else if (!strcmp(argv[1], "-v") || !strcmp(argv[1], "--verbose")) {
 	    Opt_Verbose = 1;
 	    argv++;
@@ -127,20 +190,22 @@ int main(int argc, char *argv[])
 		argv++;
 	    }
     } else {
-	fb_init();
-	drawops_init();
-	visops_init();
-
-	if (argc < 2) {
-	    Message("Running all tests\n");
-	    test_run(NULL);
-	} else
-	    while (argc > 1) {
-		test_run(argv[1]);
-		argc--;
-		argv++;
-	    }
-	fb_cleanup();
+	Test_Argc = argc;
+	Test_Argv = argv;
+	if (Opt_NumFbdev <= 1)
+	    run_tests((void *)Opt_Fbdev[0]);
+	else {
+	    /* One thread per device, each with its own context */
+	    pthread_t threads[MAX_FBDEV];
+	    int i, error;
+
+	    for (i = 0; i < Opt_NumFbdev; i++)
+		if ((error = pthread_create(&threads[i], NULL, run_tests,
+					    (void *)Opt_Fbdev[i])))
+		    Fatal("pthread_create: %s\n", strerror(error));
+	    for (i = 0; i < Opt_NumFbdev; i++)
+		pthread_join(threads[i], NULL);
+	}
     }
     exit(0);
 }
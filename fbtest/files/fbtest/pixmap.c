@@ -12,6 +12,7 @@
 #include <stdlib.h>
 
 #include "types.h"
+#include "fb.h"
 #include "clut.h"
 #include "image.h"
 #include "pixmap.h"
@@ -94,10 +95,9 @@ static void image_bw_to_pixmap(const struct image *image, pixel_t *pixmap)
      *  Convert a GREY256/CLUT256 image to a pixmap
      */
 
-static pixel_t lut[256];
-
 static void image_lut256_to_pixmap(const struct image *image, pixel_t *pixmap)
 {
+    pixel_t lut[256];
     rgba_t color;
     const unsigned char *src;
     pixel_t *dst;
@@ -0,0 +1,575 @@
+/*
+ *  Rotated display
+ *
+ *  A layer on top of the drawing operations maps all primitives from a
+ *  logical screen, in the orientation given by FB_ROTATE_CW, FB_ROTATE_UD or
+ *  FB_ROTATE_CCW (as in fb_var.rotate), to the physical frame buffer. The
+ *  logical screen is rotated clockwise by 90, 180 or 270 degrees.
+ *
+ *  Rectangles map to rectangles, so fills, copies and outlines are passed
+ *  to the layer below with mapped coordinates. At 90 and 270 degrees, lines
+ *  and spans become columns, drawn by the native vline operation, and vice
+ *  versa. Pixmaps and chunky back buffers are rotated in bands of
+ *  ROTATE_TILE lines, transposed in tiles of ROTATE_TILE by ROTATE_TILE
+ *  pixels, so both the source and the band stay in the cache, instead of
+ *  drawing every pixel at its mapped position.
+ *
+ *  Polygons are not mapped, as the fill rule samples the top left corner of
+ *  each pixel, and includes left and top edges, which become other corners
+ *  and edges when rotated. They are scan converted in logical coordinates,
+ *  and their spans are rotated.
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "rotate.h"
+#include "util.h"
+
+
+#define ROTATE_TILE	16	/* pixels, a cache line of 32-bit pixels */
+#define ROTATE_SPANS	64
+
+    /*
+     *  Rotation state, per frame buffer context
+     */
+
+struct rotate {
+    u32 angle;			/* FB_ROTATE_* */
+    u32 width, height;		/* physical screen */
+    void *buf;			/* rotated image data */
+    u32 buf_size;
+    struct drawops below;
+    struct drawops *fbops;	/* saved while scan converting polygons */
+    struct drawops logical;
+};
+
+#define rotate_angle	(fb_current->rotate->angle)
+#define rotate_width	(fb_current->rotate->width)
+#define rotate_height	(fb_current->rotate->height)
+#define rotate_below	(fb_current->rotate->below)
+
+
+static int rotate_quarter(void)
+{
+    return rotate_angle == FB_ROTATE_CW || rotate_angle == FB_ROTATE_CCW;
+}
+
+static void *rotate_buffer(u32 size)
+{
+    struct rotate *rotate = fb_current->rotate;
+
+    if (size > rotate->buf_size) {
+	free(rotate->buf);
+	if (!(rotate->buf = malloc(size)))
+	    Fatal("malloc %u: %s\n", size, strerror(errno));
+	rotate->buf_size = size;
+    }
+    return rotate->buf;
+}
+
+
+    /*
+     *  Coordinate mapping
+     *
+     *  Coordinates are signed, so primitives partially off the logical screen
+     *  map to primitives partially off the physical screen, to be clipped by
+     *  the layer below.
+     */
+
+static void rotate_map_point(int *x, int *y)
+{
+    int x0 = *x, y0 = *y;
+
+    switch (rotate_angle) {
+	case FB_ROTATE_CW:
+	    *x = rotate_width-1-y0;
+	    *y = x0;
+	    break;
+
+	case FB_ROTATE_UD:
+	    *x = rotate_width-1-x0;
+	    *y = rotate_height-1-y0;
+	    break;
+
+	case FB_ROTATE_CCW:
+	    *x = y0;
+	    *y = rotate_height-1-x0;
+	    break;
+    }
+}
+
+void rotate_map_rect(int *x, int *y, int *width, int *height)
+{
+    int x0 = *x, y0 = *y, w = *width, h = *height;
+
+    if (!fb_current->rotate)
+	return;
+
+    switch (rotate_angle) {
+	case FB_ROTATE_CW:
+	    *x = rotate_width-y0-h;
+	    *y = x0;
+	    *width = h;
+	    *height = w;
+	    break;
+
+	case FB_ROTATE_UD:
+	    *x = rotate_width-x0-w;
+	    *y = rotate_height-y0-h;
+	    break;
+
+	case FB_ROTATE_CCW:
+	    *x = y0;
+	    *y = rotate_height-x0-w;
+	    *width = h;
+	    *height = w;
+	    break;
+    }
+}
+
+u32 rotate_xres(void)
+{
+    if (fb_current->rotate && rotate_quarter())
+	return fb_var.yres;
+    return fb_var.xres;
+}
+
+u32 rotate_yres(void)
+{
+    if (fb_current->rotate && rotate_quarter())
+	return fb_var.xres;
+    return fb_var.yres;
+}
+
+
+    /*
+     *  Tiled image rotation
+     *
+     *  A logical image of width by height pixels, with lines of pitch pixels,
+     *  maps to a physical rectangle, whose pixel (u, v) is found at
+     *  u*su+v*sv pixels from the first one.
+     */
+
+struct rotate_image {
+    int x, y, width, height;	/* physical rectangle */
+    long base, su, sv;
+};
+
+static void rotate_image_init(struct rotate_image *img, u32 x, u32 y,
+			      u32 width, u32 height, u32 pitch)
+{
+    img->x = x;
+    img->y = y;
+    img->width = width;
+    img->height = height;
+    rotate_map_rect(&img->x, &img->y, &img->width, &img->height);
+
+    switch (rotate_angle) {
+	case FB_ROTATE_CW:
+	    img->base = (height-1)*(long)pitch;
+	    img->su = -(long)pitch;
+	    img->sv = 1;
+	    break;
+
+	case FB_ROTATE_UD:
+	    img->base = (height-1)*(long)pitch+width-1;
+	    img->su = -1;
+	    img->sv = -(long)pitch;
+	    break;
+
+	case FB_ROTATE_CCW:
+	    img->base = width-1;
+	    img->su = pitch;
+	    img->sv = -1;
+	    break;
+
+	default:
+	    img->base = 0;
+	    img->su = 1;
+	    img->sv = pitch;
+	    break;
+    }
+}
+
+    /*
+     *  Gather height (at most ROTATE_TILE) lines of a physical rectangle of the
+     *  given width from src, one tile at a time
+     */
+
+#define ROTATE_TILES(name, type)					\
+static void name(type *dst, const type *src, long su, long sv, u32 width, \
+		 u32 height)						\
+{									\
+    u32 u0, u1, u, v;							\
+    const type *s;							\
+    type *d;								\
+									\
+    for (u0 = 0; u0 < width; u0 = u1) {					\
+	u1 = min(u0+ROTATE_TILE, width);				\
+	for (v = 0; v < height; v++) {					\
+	    s = src+u0*su+v*sv;						\
+	    d = dst+v*width+u0;						\
+	    for (u = u0; u < u1; u++, s += su)				\
+		*d++ = *s;						\
+	}								\
+    }									\
+}
+
+ROTATE_TILES(rotate_tiles32, u32)
+ROTATE_TILES(rotate_tiles8, u8)
+
+#undef ROTATE_TILES
+
+
+    /*
+     *  Drawing operations layer
+     */
+
+static void rotate_set_pixel(u32 x, u32 y, pixel_t pixel)
+{
+    int x0 = x, y0 = y;
+
+    rotate_map_point(&x0, &y0);
+    (rotate_below.set_pixel)(x0, y0, pixel);
+}
+
+static pixel_t rotate_get_pixel(u32 x, u32 y)
+{
+    int x0 = x, y0 = y;
+
+    rotate_map_point(&x0, &y0);
+    return (rotate_below.get_pixel)(x0, y0);
+}
+
+static void rotate_draw_hline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    int x0 = x, y0 = y, w = length, h = 1;
+
+    rotate_map_rect(&x0, &y0, &w, &h);
+    if (rotate_quarter())
+	(rotate_below.draw_vline)(x0, y0, h, pixel);
+    else
+	(rotate_below.draw_hline)(x0, y0, w, pixel);
+}
+
+static void rotate_draw_vline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    int x0 = x, y0 = y, w = 1, h = length;
+
+    rotate_map_rect(&x0, &y0, &w, &h);
+    if (rotate_quarter())
+	(rotate_below.draw_hline)(x0, y0, w, pixel);
+    else
+	(rotate_below.draw_vline)(x0, y0, h, pixel);
+}
+
+static void rotate_draw_rect(u32 x, u32 y, u32 width, u32 height,
+			     pixel_t pixel)
+{
+    int x0 = x, y0 = y, w = width, h = height;
+
+    if (!width || !height) {
+	/* Degenerate, draw it like generic_draw_rect() does */
+	rotate_draw_hline(x, y, width, pixel);
+	if (height >= 2)
+	    rotate_draw_vline(x, y+1, height-2, pixel);
+	if (height)
+	    rotate_draw_hline(x, y+height-1, width, pixel);
+	return;
+    }
+
+    rotate_map_rect(&x0, &y0, &w, &h);
+    (rotate_below.draw_rect)(x0, y0, w, h, pixel);
+}
+
+static void rotate_fill_rect(u32 x, u32 y, u32 width, u32 height,
+			     pixel_t pixel)
+{
+    int x0 = x, y0 = y, w = width, h = height;
+
+    rotate_map_rect(&x0, &y0, &w, &h);
+    (rotate_below.fill_rect)(x0, y0, w, h, pixel);
+}
+
+static void rotate_fill_spans(const struct span *spans, u32 num,
+			      pixel_t pixel)
+{
+    struct span rotated[ROTATE_SPANS];
+    int x0, y0, w, h;
+    u32 i, n;
+
+    for (i = 0, n = 0; i < num; i++) {
+	x0 = spans[i].x;
+	y0 = spans[i].y;
+	w = spans[i].length;
+	h = 1;
+	rotate_map_rect(&x0, &y0, &w, &h);
+	if (rotate_quarter()) {
+	    (rotate_below.draw_vline)(x0, y0, h, pixel);
+	    continue;
+	}
+	if (n == ROTATE_SPANS) {
+	    (rotate_below.fill_spans)(rotated, n, pixel);
+	    n = 0;
+	}
+	rotated[n].x = x0;
+	rotated[n].y = y0;
+	rotated[n].length = w;
+	n++;
+    }
+    if (n)
+	(rotate_below.fill_spans)(rotated, n, pixel);
+}
+
+static void rotate_draw_line(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel)
+{
+    int x10 = x1, y10 = y1, x20 = x2, y20 = y2;
+
+    rotate_map_point(&x10, &y10);
+    rotate_map_point(&x20, &y20);
+    (rotate_below.draw_line)(x10, y10, x20, y20, pixel);
+}
+
+    /*
+     *  Bitmaps are small (e.g. font glyphs), and rotated one bit at a time
+     */
+
+static void rotate_expand_bitmap(u32 x, u32 y, u32 width, u32 height,
+				 const u8 *data, u32 pitch, pixel_t pixel0,
+				 pixel_t pixel1)
+{
+    struct rotate_image img;
+    u32 dst_pitch, u, v;
+    long offset;
+    u8 *dst;
+
+    rotate_image_init(&img, x, y, width, height, width);
+    dst_pitch = (img.width+7)/8;
+    dst = rotate_buffer(dst_pitch*img.height);
+    memset(dst, 0, dst_pitch*img.height);
+    for (v = 0; v < (u32)img.height; v++)
+	for (u = 0; u < (u32)img.width; u++) {
+	    /* Pixel offset in a logical image with lines of width pixels */
+	    offset = img.base+u*img.su+v*img.sv;
+	    if (data[offset/width*pitch+offset%width/8] &
+		(0x80 >> (offset%width % 8)))
+		dst[v*dst_pitch+u/8] |= 0x80 >> (u % 8);
+	}
+    (rotate_below.expand_bitmap)(img.x, img.y, img.width, img.height, dst,
+				 dst_pitch, pixel0, pixel1);
+}
+
+static void rotate_draw_pixmap(u32 x, u32 y, u32 width, u32 height,
+			       const pixel_t *pixmap)
+{
+    struct rotate_image img;
+    pixel_t *band;
+    u32 v, n;
+
+    if (!width || !height)
+	return;
+
+    rotate_image_init(&img, x, y, width, height, width);
+    band = rotate_buffer(img.width*ROTATE_TILE*sizeof(*band));
+    for (v = 0; v < (u32)img.height; v += n) {
+	n = min(img.height-v, (u32)ROTATE_TILE);
+	rotate_tiles32(band, pixmap+img.base+v*img.sv, img.su, img.sv,
+		       img.width, n);
+	(rotate_below.draw_pixmap)(img.x, img.y+v, img.width, n, band);
+    }
+}
+
+static void rotate_draw_chunky(u32 x, u32 y, u32 width, u32 height,
+			       const u8 *data, u32 pitch)
+{
+    struct rotate_image img;
+    u32 v, n;
+    u8 *band;
+
+    if (!width || !height)
+	return;
+
+    rotate_image_init(&img, x, y, width, height, pitch);
+    band = rotate_buffer(img.width*ROTATE_TILE);
+    for (v = 0; v < (u32)img.height; v += n) {
+	n = min(img.height-v, (u32)ROTATE_TILE);
+	rotate_tiles8(band, data+img.base+v*img.sv, img.su, img.sv, img.width,
+		      n);
+	(rotate_below.draw_chunky)(img.x, img.y+v, img.width, n, band,
+				   img.width);
+    }
+}
+
+static void rotate_draw_circle(u32 x, u32 y, u32 r, pixel_t pixel)
+{
+    int x0 = x, y0 = y;
+
+    rotate_map_point(&x0, &y0);
+    (rotate_below.draw_circle)(x0, y0, r, pixel);
+}
+
+static void rotate_fill_circle(u32 x, u32 y, u32 r, pixel_t pixel)
+{
+    int x0 = x, y0 = y;
+
+    rotate_map_point(&x0, &y0);
+    (rotate_below.fill_circle)(x0, y0, r, pixel);
+}
+
+static void rotate_draw_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
+{
+    int x0 = x, y0 = y;
+
+    rotate_map_point(&x0, &y0);
+    if (rotate_quarter())
+	(rotate_below.draw_ellipse)(x0, y0, b, a, pixel);
+    else
+	(rotate_below.draw_ellipse)(x0, y0, a, b, pixel);
+}
+
+static void rotate_fill_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
+{
+    int x0 = x, y0 = y;
+
+    rotate_map_point(&x0, &y0);
+    if (rotate_quarter())
+	(rotate_below.fill_ellipse)(x0, y0, b, a, pixel);
+    else
+	(rotate_below.fill_ellipse)(x0, y0, a, b, pixel);
+}
+
+static void rotate_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx,
+			     u32 sy)
+{
+    int dx0 = dx, dy0 = dy, sx0 = sx, sy0 = sy, w = width, h = height;
+
+    rotate_map_rect(&sx0, &sy0, &w, &h);
+    w = width;
+    h = height;
+    rotate_map_rect(&dx0, &dy0, &w, &h);
+    (rotate_below.copy_rect)(dx0, dy0, w, h, sx0, sy0);
+}
+
+    /*
+     *  The generic polygon code draws spans using the frame buffer level
+     *  operations, which are temporarily replaced to rotate the spans
+     */
+
+static void rotate_fill_polygon(const struct point *points, u32 num,
+				enum fill_rule rule, pixel_t pixel)
+{
+    struct rotate *rotate = fb_current->rotate;
+
+    rotate->fbops = fb_current->fbops;
+    rotate->logical = *rotate->fbops;
+    rotate->logical.fill_spans = rotate_fill_spans;
+    fb_current->fbops = &rotate->logical;
+    generic_fill_polygon(points, num, rule, pixel);
+    fb_current->fbops = rotate->fbops;
+}
+
+static void rotate_blend_rect(u32 x, u32 y, u32 width, u32 height, u32 argb)
+{
+    int x0 = x, y0 = y, w = width, h = height;
+
+    rotate_map_rect(&x0, &y0, &w, &h);
+    (rotate_below.blend_rect)(x0, y0, w, h, argb);
+}
+
+static void rotate_blend_pixmap(u32 x, u32 y, u32 width, u32 height,
+				const u32 *argb)
+{
+    struct rotate_image img;
+    u32 *band, v, n;
+
+    if (!width || !height)
+	return;
+
+    rotate_image_init(&img, x, y, width, height, width);
+    band = rotate_buffer(img.width*ROTATE_TILE*sizeof(*band));
+    for (v = 0; v < (u32)img.height; v += n) {
+	n = min(img.height-v, (u32)ROTATE_TILE);
+	rotate_tiles32(band, argb+img.base+v*img.sv, img.su, img.sv,
+		       img.width, n);
+	(rotate_below.blend_pixmap)(img.x, img.y+v, img.width, n, band);
+    }
+}
+
+static const struct drawops rotate_drawops = {
+    .name =		"rotate",
+    .set_pixel =	rotate_set_pixel,
+    .get_pixel =	rotate_get_pixel,
+    .draw_hline =	rotate_draw_hline,
+    .draw_vline =	rotate_draw_vline,
+    .draw_rect =	rotate_draw_rect,
+    .fill_rect =	rotate_fill_rect,
+    .fill_spans =	rotate_fill_spans,
+    .draw_line =	rotate_draw_line,
+    .expand_bitmap =	rotate_expand_bitmap,
+    .draw_pixmap =	rotate_draw_pixmap,
+    .draw_chunky =	rotate_draw_chunky,
+    .draw_circle =	rotate_draw_circle,
+    .fill_circle =	rotate_fill_circle,
+    .draw_ellipse =	rotate_draw_ellipse,
+    .fill_ellipse =	rotate_fill_ellipse,
+    .copy_rect =	rotate_copy_rect,
+    .fill_polygon =	rotate_fill_polygon,
+    .blend_rect =	rotate_blend_rect,
+    .blend_pixmap =	rotate_blend_pixmap,
+};
+
+
+    /*
+     *  Initialization
+     */
+
+void rotate_init(u32 angle)
+{
+    struct rotate *rotate;
+
+    Debug("rotate_init(%u)\n", angle);
+    if (fb_current->rotate)
+	rotate_cleanup();
+    if (angle == FB_ROTATE_UR)
+	return;
+    if (angle > FB_ROTATE_CCW)
+	Fatal("Invalid rotation %u\n", angle);
+
+    if (!(rotate = calloc(1, sizeof(*rotate))))
+	Fatal("calloc %zu: %s\n", sizeof(*rotate), strerror(errno));
+    rotate->angle = angle;
+    rotate->width = fb_var.xres;
+    rotate->height = fb_var.yres;
+    fb_current->rotate = rotate;
+    drawops_push_layer(&rotate_drawops, &rotate_below);
+
+    Message("Drawing rotated by %u degrees\n", angle*90);
+}
+
+
+    /*
+     *  Clean up
+     */
+
+void rotate_cleanup(void)
+{
+    struct rotate *rotate = fb_current->rotate;
+
+    if (!rotate)
+	return;
+
+    Debug("rotate_cleanup()\n");
+    drawops_pop_layer(&rotate->below);
+    fb_current->rotate = NULL;
+    free(rotate->buf);
+    free(rotate);
+}
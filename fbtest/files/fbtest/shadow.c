@@ -0,0 +1,448 @@
+/*
+ *  Shadow frame buffer
+ *
+ *  The frame buffer memory may be non-cacheable, which makes the
+ *  read-modify-write cycles in the drawing operations very slow. Instead,
+ *  all drawing is done in a copy of the frame buffer in normal memory. A
+ *  layer on top of the drawing operations keeps track of the modified tiles,
+ *  and shadow_flush() copies only those to the real frame buffer, using
+ *  sequential long word writes.
+ *
+ *  Tiles are in pixels of the virtual screen, so this works for all frame
+ *  buffer types, and with page flipping.
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "shadow.h"
+#include "util.h"
+
+
+#define TILE_WIDTH	64	/* pixels, a multiple of 16 for iplan2 */
+#define TILE_HEIGHT	16	/* lines */
+
+#define SHADOW_ALIGN	64
+
+    /*
+     *  Shadow state, per frame buffer context
+     */
+
+struct shadow {
+    u8 *mem, *base, *real;
+    u32 next_line;
+    unsigned long *dirty;
+    u32 htiles, vtiles;
+    u32 pitch;			/* longs per row of tiles */
+    struct drawops below;
+};
+
+#define shadow_mem	(fb_current->shadow->mem)
+#define shadow_fb	(fb_current->shadow->base)
+#define shadow_real	(fb_current->shadow->real)
+#define shadow_next_line	(fb_current->shadow->next_line)
+#define shadow_dirty	(fb_current->shadow->dirty)
+#define tiles_x		(fb_current->shadow->htiles)
+#define tiles_y		(fb_current->shadow->vtiles)
+#define row_words	(fb_current->shadow->pitch)
+#define shadow_below	(fb_current->shadow->below)
+
+
+static void shadow_copy_span(u32 offset, u32 len)
+{
+    fb_memcpy(shadow_real+offset, shadow_fb+offset, len);
+}
+
+
+    /*
+     *  Copy a rectangle of the virtual screen to the real frame buffer
+     *
+     *  x0 is a multiple of TILE_WIDTH, so all spans start on a byte boundary
+     */
+
+static void shadow_flush_rect(u32 x0, u32 x1, u32 y0, u32 y1)
+{
+    u32 bpp = fb_var.bits_per_pixel;
+    u32 len = fb_fix.line_length;
+    int full = x0 == 0 && x1 == fb_var.xres_virtual;
+    u32 start, end, y, p;
+
+    switch (fb_fix.type) {
+	case FB_TYPE_PACKED_PIXELS:
+	    if (full) {
+		shadow_copy_span(y0*len, (y1-y0)*len);
+		break;
+	    }
+	    start = x0*bpp/8;
+	    end = (x1*bpp+7)/8;
+	    for (y = y0; y < y1; y++)
+		shadow_copy_span(y*len+start, end-start);
+	    break;
+
+	case FB_TYPE_PLANES:
+	    start = x0/8;
+	    end = (x1+7)/8;
+	    for (p = 0; p < bpp; p++) {
+		if (full)
+		    shadow_copy_span(p*len*fb_var.yres_virtual+y0*len,
+				     (y1-y0)*len);
+		else
+		    for (y = y0; y < y1; y++)
+			shadow_copy_span(p*len*fb_var.yres_virtual+y*len+start,
+					 end-start);
+	    }
+	    break;
+
+	case FB_TYPE_INTERLEAVED_PLANES:
+	    if (fb_fix.type_aux == 2) {
+		/* iplan2 */
+		if (full) {
+		    shadow_copy_span(y0*len, (y1-y0)*len);
+		    break;
+		}
+		start = x0/16*2*bpp;
+		end = (x1+15)/16*2*bpp;
+		for (y = y0; y < y1; y++)
+		    shadow_copy_span(y*len+start, end-start);
+	    } else {
+		/* ilbm */
+		if (full) {
+		    shadow_copy_span(y0*len*bpp, (y1-y0)*len*bpp);
+		    break;
+		}
+		start = x0/8;
+		end = (x1+7)/8;
+		for (y = y0; y < y1; y++)
+		    for (p = 0; p < bpp; p++)
+			shadow_copy_span((y*bpp+p)*len+start, end-start);
+	    }
+	    break;
+    }
+}
+
+
+    /*
+     *  Dirty tile tracking
+     */
+
+static inline int shadow_test_tile(const unsigned long *row, u32 tx)
+{
+    return (row[tx/BITS_PER_LONG] >> (tx % BITS_PER_LONG)) & 1;
+}
+
+void shadow_mark_dirty(int x, int y, int width, int height)
+{
+    int x1, y1, tx, ty, tx0, tx1, ty1;
+    unsigned long *row;
+
+    if (!fb_current->shadow || width <= 0 || height <= 0)
+	return;
+
+    /* Coordinates are relative to fb, which may point to a back buffer */
+    y += (fb_current->fb-shadow_fb)/shadow_next_line;
+    x1 = x+width;
+    y1 = y+height;
+    if (x < 0)
+	x = 0;
+    if (y < 0)
+	y = 0;
+    if (x1 > (int)fb_var.xres_virtual)
+	x1 = fb_var.xres_virtual;
+    if (y1 > (int)fb_var.yres_virtual)
+	y1 = fb_var.yres_virtual;
+    if (x >= x1 || y >= y1)
+	return;
+
+    tx0 = x/TILE_WIDTH;
+    tx1 = (x1-1)/TILE_WIDTH;
+    ty1 = (y1-1)/TILE_HEIGHT;
+    for (ty = y/TILE_HEIGHT; ty <= ty1; ty++) {
+	row = shadow_dirty+ty*row_words;
+	for (tx = tx0; tx <= tx1; tx++)
+	    row[tx/BITS_PER_LONG] |= 1UL << (tx % BITS_PER_LONG);
+    }
+}
+
+
+    /*
+     *  Copy all dirty tiles to the real frame buffer
+     */
+
+void shadow_flush(void)
+{
+    u32 tx, tx0, ty, y0, y1, i;
+    unsigned long *row;
+
+    if (!fb_current->shadow)
+	return;
+
+    for (ty = 0; ty < tiles_y; ty++) {
+	row = shadow_dirty+ty*row_words;
+	for (i = 0; i < row_words && !row[i]; i++)
+	    ;
+	if (i == row_words)
+	    continue;
+
+	y0 = ty*TILE_HEIGHT;
+	y1 = min(y0+TILE_HEIGHT, fb_var.yres_virtual);
+	for (tx = 0; tx < tiles_x; ) {
+	    if (!shadow_test_tile(row, tx)) {
+		tx++;
+		continue;
+	    }
+	    /* Merge adjacent dirty tiles into a single run */
+	    for (tx0 = tx; tx < tiles_x && shadow_test_tile(row, tx); tx++)
+		;
+	    shadow_flush_rect(tx0*TILE_WIDTH,
+			      min(tx*TILE_WIDTH, fb_var.xres_virtual), y0, y1);
+	}
+	memset(row, 0, row_words*sizeof(*row));
+    }
+}
+
+
+    /*
+     *  Drawing operations layer
+     */
+
+static void shadow_set_pixel(u32 x, u32 y, pixel_t pixel)
+{
+    shadow_mark_dirty(x, y, 1, 1);
+    (shadow_below.set_pixel)(x, y, pixel);
+}
+
+static void shadow_draw_hline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    shadow_mark_dirty(x, y, length, 1);
+    (shadow_below.draw_hline)(x, y, length, pixel);
+}
+
+static void shadow_draw_vline(u32 x, u32 y, u32 length, pixel_t pixel)
+{
+    shadow_mark_dirty(x, y, 1, length);
+    (shadow_below.draw_vline)(x, y, length, pixel);
+}
+
+static void shadow_draw_rect(u32 x, u32 y, u32 width, u32 height,
+			     pixel_t pixel)
+{
+    shadow_mark_dirty(x, y, width, height);
+    (shadow_below.draw_rect)(x, y, width, height, pixel);
+}
+
+static void shadow_fill_rect(u32 x, u32 y, u32 width, u32 height,
+			     pixel_t pixel)
+{
+    shadow_mark_dirty(x, y, width, height);
+    (shadow_below.fill_rect)(x, y, width, height, pixel);
+}
+
+static void shadow_fill_spans(const struct span *spans, u32 num,
+			      pixel_t pixel)
+{
+    int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+    u32 i;
+
+    for (i = 0; i < num; i++) {
+	x0 = min(x0, (int)spans[i].x);
+	x1 = max(x1, (int)(spans[i].x+spans[i].length));
+	y0 = min(y0, (int)spans[i].y);
+	y1 = max(y1, (int)spans[i].y+1);
+    }
+    if (num)
+	shadow_mark_dirty(x0, y0, x1-x0, y1-y0);
+    (shadow_below.fill_spans)(spans, num, pixel);
+}
+
+static void shadow_draw_line(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel)
+{
+    shadow_mark_dirty(min((int)x1, (int)x2), min((int)y1, (int)y2),
+		      abs((int)x2-(int)x1)+1, abs((int)y2-(int)y1)+1);
+    (shadow_below.draw_line)(x1, y1, x2, y2, pixel);
+}
+
+static void shadow_expand_bitmap(u32 x, u32 y, u32 width, u32 height,
+				 const u8 *data, u32 pitch, pixel_t pixel0,
+				 pixel_t pixel1)
+{
+    shadow_mark_dirty(x, y, width, height);
+    (shadow_below.expand_bitmap)(x, y, width, height, data, pitch, pixel0,
+			       pixel1);
+}
+
+static void shadow_draw_pixmap(u32 x, u32 y, u32 width, u32 height,
+			       const pixel_t *pixmap)
+{
+    shadow_mark_dirty(x, y, width, height);
+    (shadow_below.draw_pixmap)(x, y, width, height, pixmap);
+}
+
+static void shadow_draw_chunky(u32 x, u32 y, u32 width, u32 height,
+			       const u8 *data, u32 pitch)
+{
+    shadow_mark_dirty(x, y, width, height);
+    (shadow_below.draw_chunky)(x, y, width, height, data, pitch);
+}
+
+static void shadow_draw_circle(u32 x, u32 y, u32 r, pixel_t pixel)
+{
+    shadow_mark_dirty((int)x-(int)r, (int)y-(int)r, 2*r+1, 2*r+1);
+    (shadow_below.draw_circle)(x, y, r, pixel);
+}
+
+static void shadow_fill_circle(u32 x, u32 y, u32 r, pixel_t pixel)
+{
+    shadow_mark_dirty((int)x-(int)r, (int)y-(int)r, 2*r+1, 2*r+1);
+    (shadow_below.fill_circle)(x, y, r, pixel);
+}
+
+static void shadow_draw_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
+{
+    shadow_mark_dirty((int)x-(int)a, (int)y-(int)b, 2*a+1, 2*b+1);
+    (shadow_below.draw_ellipse)(x, y, a, b, pixel);
+}
+
+static void shadow_fill_ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
+{
+    shadow_mark_dirty((int)x-(int)a, (int)y-(int)b, 2*a+1, 2*b+1);
+    (shadow_below.fill_ellipse)(x, y, a, b, pixel);
+}
+
+static void shadow_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx,
+			     u32 sy)
+{
+    shadow_mark_dirty(dx, dy, width, height);
+    (shadow_below.copy_rect)(dx, dy, width, height, sx, sy);
+}
+
+static void shadow_fill_polygon(const struct point *points, u32 num,
+				enum fill_rule rule, pixel_t pixel)
+{
+    int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+    u32 i;
+
+    for (i = 0; i < num; i++) {
+	x0 = min(x0, (int)points[i].x);
+	x1 = max(x1, (int)points[i].x);
+	y0 = min(y0, (int)points[i].y);
+	y1 = max(y1, (int)points[i].y);
+    }
+    if (num)
+	shadow_mark_dirty(x0, y0, x1-x0, y1-y0);
+    (shadow_below.fill_polygon)(points, num, rule, pixel);
+}
+
+static void shadow_blend_rect(u32 x, u32 y, u32 width, u32 height, u32 argb)
+{
+    shadow_mark_dirty(x, y, width, height);
+    (shadow_below.blend_rect)(x, y, width, height, argb);
+}
+
+static void shadow_blend_pixmap(u32 x, u32 y, u32 width, u32 height,
+				const u32 *argb)
+{
+    shadow_mark_dirty(x, y, width, height);
+    (shadow_below.blend_pixmap)(x, y, width, height, argb);
+}
+
+static const struct drawops shadow_drawops = {
+    .name =		"shadow",
+    .set_pixel =	shadow_set_pixel,
+    .draw_hline =	shadow_draw_hline,
+    .draw_vline =	shadow_draw_vline,
+    .draw_rect =	shadow_draw_rect,
+    .fill_rect =	shadow_fill_rect,
+    .fill_spans =	shadow_fill_spans,
+    .draw_line =	shadow_draw_line,
+    .expand_bitmap =	shadow_expand_bitmap,
+    .draw_pixmap =	shadow_draw_pixmap,
+    .draw_chunky =	shadow_draw_chunky,
+    .draw_circle =	shadow_draw_circle,
+    .fill_circle =	shadow_fill_circle,
+    .draw_ellipse =	shadow_draw_ellipse,
+    .fill_ellipse =	shadow_fill_ellipse,
+    .copy_rect =	shadow_copy_rect,
+    .fill_polygon =	shadow_fill_polygon,
+    .blend_rect =	shadow_blend_rect,
+    .blend_pixmap =	shadow_blend_pixmap,
+};
+
+
+    /*
+     *  Initialization
+     */
+
+void shadow_init(void)
+{
+    u32 size = fb_fix.smem_len;
+    struct shadow *shadow;
+
+    Debug("shadow_init()\n");
+    if (fb_current->shadow)
+	return;
+
+    if (!(shadow = calloc(1, sizeof(*shadow))))
+	Fatal("calloc %zu: %s\n", sizeof(*shadow), strerror(errno));
+
+    /* Keep the same alignment as the real frame buffer */
+    if (!(shadow->mem = malloc(size+2*SHADOW_ALIGN)))
+	Fatal("malloc %u: %s\n", size+2*SHADOW_ALIGN, strerror(errno));
+    shadow->base = (u8 *)(((unsigned long)shadow->mem+SHADOW_ALIGN-1) &
+			~(SHADOW_ALIGN-1UL)) +
+		 ((unsigned long)fb_current->fb & (SHADOW_ALIGN-1));
+
+    shadow->htiles = (fb_var.xres_virtual+TILE_WIDTH-1)/TILE_WIDTH;
+    shadow->vtiles = (fb_var.yres_virtual+TILE_HEIGHT-1)/TILE_HEIGHT;
+    shadow->pitch = (shadow->htiles+BITS_PER_LONG-1)/BITS_PER_LONG;
+    if (!(shadow->dirty = calloc(shadow->vtiles*shadow->pitch,
+				 sizeof(*shadow->dirty))))
+	Fatal("calloc %zu: %s\n",
+	      shadow->vtiles*shadow->pitch*sizeof(*shadow->dirty),
+	      strerror(errno));
+
+    shadow->next_line = fb_fix.line_length;
+    if (fb_fix.type == FB_TYPE_INTERLEAVED_PLANES && fb_fix.type_aux != 2)
+	shadow->next_line *= fb_var.bits_per_pixel;	/* ilbm */
+
+    memcpy(shadow->base, fb_current->fb, size);
+    shadow->real = fb_current->fb;
+    fb_current->shadow = shadow;
+    fb_current->fb = shadow_fb;
+    drawops_retarget();
+    drawops_push_layer(&shadow_drawops, &shadow_below);
+
+    Message("Using shadow frame buffer, %ux%u tiles of %ux%u\n", tiles_x,
+	    tiles_y, TILE_WIDTH, TILE_HEIGHT);
+}
+
+
+    /*
+     *  Clean up
+     */
+
+void shadow_cleanup(void)
+{
+    struct shadow *shadow = fb_current->shadow;
+
+    if (!shadow)
+	return;
+
+    Debug("shadow_cleanup()\n");
+    shadow_flush();
+    drawops_pop_layer(&shadow->below);
+    fb_current->fb = shadow->real+(fb_current->fb-shadow->base);
+    drawops_retarget();
+    fb_current->shadow = NULL;
+    free(shadow->dirty);
+    free(shadow->mem);
+    free(shadow);
+}
@@ -33,6 +33,21 @@ static const struct test *all_tests[] = {
     &test011,
     &test012,
     &test013,
+    &test014,
+    &test015,
+    &test016,
+    &test017,
+    &test018,
+    &test019,
+    &test020,
+    &test021,
+    &test022,
+    &test023,
+    &test024,
+    &test025,
+    &test026,
+    &test027,
+    &test028,
     NULL
 };
 
@@ -62,7 +77,7 @@ static void run_one_test(const struct test *test)
     }
 
     TEST_REQ_MIN(bits_per_pixel, fb_var.bits_per_pixel);
-    TEST_REQ_MIN(num_colors, idx_len);
+    TEST_REQ_MIN(num_colors, fb_current->idx_len);
     TEST_REQ_MIN(red_length, fb_var.red.length);
     TEST_REQ_MIN(green_length, fb_var.green.length);
     TEST_REQ_MIN(blue_length, fb_var.blue.length);
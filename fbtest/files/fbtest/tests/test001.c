@@ -30,7 +30,8 @@ static enum test_res test001_func(void)
     for (i = 1, y0 = 0; i <= Y_BLOCKS; i++, y0 = y1) {
 	y1 = i*fb_var.yres/Y_BLOCKS;
 	for (j = 1, x0 = 0; j <= X_BLOCKS; j++, x0 = x1) {
-	    pixel = (i+j) & 1 ? white_pixel : black_pixel;
+	    pixel = (i+j) & 1 ? fb_current->white_pixel
+			      : fb_current->black_pixel;
 	    x1 = j*fb_var.xres/X_BLOCKS;
 	    fill_rect(x0, y0, x1-x0, y1-y0, pixel);
 	}
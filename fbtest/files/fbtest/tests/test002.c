@@ -26,23 +26,25 @@ static enum test_res test002_func(void)
     int i;
     u32 a, b, x1, x2, y1, y2;
 
-    fill_rect(0, 0, fb_var.xres, fb_var.yres, black_pixel);
+    fill_rect(0, 0, fb_var.xres, fb_var.yres, fb_current->black_pixel);
     for (i = 0; i <= Y_BLOCKS; i++)
-	draw_hline(0, i*(fb_var.yres-1)/Y_BLOCKS, fb_var.xres, white_pixel);
+	draw_hline(0, i*(fb_var.yres-1)/Y_BLOCKS, fb_var.xres,
+		   fb_current->white_pixel);
     for (i = 0; i <= X_BLOCKS; i++)
-	draw_vline(i*(fb_var.xres-1)/X_BLOCKS, 0, fb_var.yres, white_pixel);
+	draw_vline(i*(fb_var.xres-1)/X_BLOCKS, 0, fb_var.yres,
+		   fb_current->white_pixel);
     draw_ellipse(fb_var.xres/2, fb_var.yres/2, 3*fb_var.xres/8,
-		 fb_var.yres/2-1, white_pixel);
+		 fb_var.yres/2-1, fb_current->white_pixel);
     a = (fb_var.xres-1)/X_BLOCKS;
     b = (fb_var.yres-1)/Y_BLOCKS;
     x1 = (fb_var.xres-1)/X_BLOCKS;
     y1 = (fb_var.yres-1)/Y_BLOCKS;
     x2 = (X_BLOCKS-1)*(fb_var.xres-1)/X_BLOCKS;
     y2 = (Y_BLOCKS-1)*(fb_var.yres-1)/Y_BLOCKS;
-    draw_ellipse(x1, y1, a, b, white_pixel);
-    draw_ellipse(x2, y1, a, b, white_pixel);
-    draw_ellipse(x1, y2, a, b, white_pixel);
-    draw_ellipse(x2, y2, a, b, white_pixel);
+    draw_ellipse(x1, y1, a, b, fb_current->white_pixel);
+    draw_ellipse(x2, y1, a, b, fb_current->white_pixel);
+    draw_ellipse(x1, y2, a, b, fb_current->white_pixel);
+    draw_ellipse(x2, y2, a, b, fb_current->white_pixel);
     wait_for_key(10);
     return TEST_OK;
 }
@@ -26,10 +26,10 @@ static enum test_res test003_func(void)
     u32 x0, x1;
 
     for (i = 0; i < 16; i++)
-	clut[i] = clut_console[i];
+	fb_current->clut[i] = clut_console[i];
     clut_update();
     for (i = 1, x0 = 0; i <= 16; i++, x0 = x1) {
-	pixel = idx_pixel[i-1];
+	pixel = fb_current->idx_pixel[i-1];
 	x1 = i*fb_var.xres/16;
 	fill_rect(x0, 0, x1-x0, fb_var.yres, pixel);
     }
@@ -13,6 +13,7 @@
 
 #include "types.h"
 #include "fb.h"
+#include "clip.h"
 #include "color.h"
 #include "drawops.h"
 #include "image.h"
@@ -27,23 +28,17 @@ static enum test_res test004_func(void)
 {
     const struct image *image;
     pixel_t *pixmap;
-    int x, y, width, height, i;
+    int x, y;
 
     image = &penguin;
     pixmap = create_pixmap(image);
 
     fill_rect(0, 0, fb_var.xres, fb_var.yres, match_color(&c_black));
-    for (y = 0; y < fb_var.yres; y += image->height) {
-	height = min(image->height, fb_var.yres-y);
-	for (x = 0; x < fb_var.xres; x += image->width) {
-	    width = min(image->width, fb_var.xres-x);
-	    if (width == image->width)
-		draw_pixmap(x, y, image->width, height, pixmap);
-	    else
-		for (i = 0; i < height; i++)
-		    draw_pixmap(x, y+i, width, 1, pixmap+i*image->width);
-	}
-    }
+    clip_push(0, 0, fb_var.xres, fb_var.yres);
+    for (y = 0; y < fb_var.yres; y += image->height)
+	for (x = 0; x < fb_var.xres; x += image->width)
+	    draw_pixmap(x, y, image->width, image->height, pixmap);
+    clip_pop();
     wait_for_key(10);
     return TEST_OK;
 }
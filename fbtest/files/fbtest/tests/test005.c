@@ -27,14 +27,14 @@ static enum test_res test005_func(void)
     int x_bits, y_bits, x_blocks, y_blocks;
 
     clut_init_nice();
-    y_bits = idx_bits/2;
-    x_bits = idx_bits-y_bits;
+    y_bits = fb_current->idx_bits/2;
+    x_bits = fb_current->idx_bits-y_bits;
     x_blocks = 1<<x_bits;
     y_blocks = 1<<y_bits;
     for (i = 1, y0 = 0; i <= y_blocks; i++, y0 = y1) {
 	y1 = i*fb_var.yres/y_blocks;
 	for (j = 1, x0 = 0; j <= x_blocks; j++, x0 = x1) {
-	    pixel = idx_pixel[(i-1)*x_blocks+(j-1)];
+	    pixel = fb_current->idx_pixel[(i-1)*x_blocks+(j-1)];
 	    x1 = j*fb_var.xres/x_blocks;
 	    fill_rect(x0, y0, x1-x0, y1-y0, pixel);
 	}
@@ -27,10 +27,10 @@ static enum test_res test006_func(void)
     pixel_t pixels[2];
     u32 x0, x1, y0, y1;
 
-    for (i = 1, x0 = 0; i <= gray_len; i++, x0 = x1) {
-	pixels[0] = gray_pixel[i-1];
-	pixels[1] = gray_pixel[gray_len-i];
-	x1 = i*fb_var.xres/gray_len;
+    for (i = 1, x0 = 0; i <= fb_current->gray_len; i++, x0 = x1) {
+	pixels[0] = fb_current->gray_pixel[i-1];
+	pixels[1] = fb_current->gray_pixel[fb_current->gray_len-i];
+	x1 = i*fb_var.xres/fb_current->gray_len;
 	for (j = 1, y0 = 0; j <= Y_BLOCKS; j++, y0 = y1) {
 	    y1 = j*fb_var.yres/Y_BLOCKS;
 	    fill_rect(x0, y0, x1-x0, y1-y0, pixels[j & 1]);
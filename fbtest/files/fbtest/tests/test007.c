@@ -51,30 +51,32 @@ static void increase_level(int *component)
 
 static enum test_res test007_func(void)
 {
+    struct fb_context *ctx = fb_current;
     int i;
 
-    fill_rect(0, 0, fb_var.xres, fb_var.yres, black_pixel);
-    for (i = 0; i < red_len; i++)
-	clut[i].r = EXPAND_TO_16BIT(i, red_len-1);
-    for (i = 0; i < green_len; i++)
-	clut[i].g = EXPAND_TO_16BIT(i, green_len-1);
-    for (i = 0; i < blue_len; i++)
-	clut[i].b = EXPAND_TO_16BIT(i, blue_len-1);
-    for (i = 0; i < alpha_len; i++)
-	clut[i].a = 65535;
+    fill_rect(0, 0, fb_var.xres, fb_var.yres, ctx->black_pixel);
+    for (i = 0; i < ctx->red_len; i++)
+	ctx->clut[i].r = EXPAND_TO_16BIT(i, ctx->red_len-1);
+    for (i = 0; i < ctx->green_len; i++)
+	ctx->clut[i].g = EXPAND_TO_16BIT(i, ctx->green_len-1);
+    for (i = 0; i < ctx->blue_len; i++)
+	ctx->clut[i].b = EXPAND_TO_16BIT(i, ctx->blue_len-1);
+    for (i = 0; i < ctx->alpha_len; i++)
+	ctx->clut[i].a = 65535;
     clut_update();
 
     Message("Red and green, increasing blue level\n");
-    draw_grid(red_len, green_len, red_pixel, green_pixel);
-    increase_level(&clut[0].b);
+    draw_grid(ctx->red_len, ctx->green_len, ctx->red_pixel, ctx->green_pixel);
+    increase_level(&ctx->clut[0].b);
 
     Message("Green and blue, increasing red level\n");
-    draw_grid(green_len, blue_len, green_pixel, blue_pixel);
-    increase_level(&clut[0].r);
+    draw_grid(ctx->green_len, ctx->blue_len, ctx->green_pixel,
+	      ctx->blue_pixel);
+    increase_level(&ctx->clut[0].r);
 
     Message("Blue and red, increasing green level\n");
-    draw_grid(blue_len, red_len, blue_pixel, red_pixel);
-    increase_level(&clut[0].g);
+    draw_grid(ctx->blue_len, ctx->red_len, ctx->blue_pixel, ctx->red_pixel);
+    increase_level(&ctx->clut[0].g);
 
     return TEST_OK;
 }
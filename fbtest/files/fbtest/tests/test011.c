@@ -101,7 +101,8 @@ static void move(u32 cx, u32 cy, u32 x1, u32 y1, u32 x2, u32 y2)
 
     linegen_init(&gen, x1, y1, x2, y2);
     while (linegen_next(&gen, &x, &y)) {
-	fill_circle(cx+x, cy+y, 2, cnt & 4 ? black_pixel : white_pixel);
+	fill_circle(cx+x, cy+y, 2, cnt & 4 ? fb_current->black_pixel
+					    : fb_current->white_pixel);
 	fb_pan(x, y);
 	wait_ms(SLEEP_MS);
 	cnt++;
@@ -115,12 +116,13 @@ static enum test_res test011_func(void)
     fb_var.yres_virtual = 3240; 
 	Debug("test11 starts\n");
 //	fill_rect(0, 0, fb_var.xres, fb_var.yres, black_pixel);
-    fill_rect(0, 0, fb_var.xres_virtual, fb_var.yres_virtual, black_pixel);
+    fill_rect(0, 0, fb_var.xres_virtual, fb_var.yres_virtual,
+	      fb_current->black_pixel);
     Debug("fill_rect fb_var.xres_virtual %d  fb_var.yres_virtual %d\n",fb_var.xres_virtual, fb_var.yres_virtual);
     Debug("fill_rect ok\n");
     for (y = 0; y < fb_var.yres_virtual; y += BLOCKSIZE) {
 	even = (y / BLOCKSIZE) % 2;
-	draw_hline(0, y, fb_var.xres_virtual, white_pixel);
+	draw_hline(0, y, fb_var.xres_virtual, fb_current->white_pixel);
     Debug("draw_hline ok\n");
 	for (x = 0; x < fb_var.xres_virtual; x += BLOCKSIZE) {
 	    if (even && x+4 < fb_var.xres_virtual &&
@@ -128,13 +130,13 @@ static enum test_res test011_func(void)
 		fill_rect(x+4, y+4,
 			  min(BLOCKSIZE-8, fb_var.xres_virtual-x-4),
 			  min(BLOCKSIZE-8, fb_var.yres_virtual-y-4),
-			  white_pixel);
+			  fb_current->white_pixel);
 	    even ^= 1;
 //	Debug("loop fill_rect ok\n");
 	}
     }
     for (x = 0; x < fb_var.xres_virtual; x += BLOCKSIZE)
-	draw_vline(x, 0, fb_var.yres_virtual, white_pixel);
+	draw_vline(x, 0, fb_var.yres_virtual, fb_current->white_pixel);
     Debug("draw_vline ok\n");
     cx = fb_var.xres/2;
     cy = fb_var.yres/2;
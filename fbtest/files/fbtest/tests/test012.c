@@ -15,6 +15,7 @@
 #include "types.h"
 #include "fb.h"
 #include "drawops.h"
+#include "bitstream.h"
 #include "visual.h"
 #include "test.h"
 #include "util.h"
@@ -36,10 +37,10 @@ static void fill_squares(unsigned long n, void *data)
 		  param->size, param->size, lrand48() & param->pixelmask);
 }
 
-static void benchmark_squares(u32 size)
+static void benchmark_squares(u32 size, int compare)
 {
     struct param param;
-    double rate;
+    double rate, scalar;
 
     param.xrange = fb_var.xres_virtual-size+1;
     param.yrange = fb_var.yres_virtual-size+1;
@@ -50,7 +51,21 @@ static void benchmark_squares(u32 size)
     if (rate < 0)
 	return;
 
-    printf("%ux%u squares: %.2f Mpixels/s\n", size, size, rate*size*size/1e6);
+    if (!compare) {
+	printf("%ux%u squares: %.2f Mpixels/s\n", size, size,
+	       rate*size*size/1e6);
+	return;
+    }
+
+    fb_current->no_simd = 1;
+    scalar = benchmark(fill_squares, &param);
+    fb_current->no_simd = 0;
+    if (scalar < 0)
+	return;
+
+    printf("%ux%u squares: %.2f Mpixels/s (scalar %.2f Mpixels/s, "
+	   "speedup %.2f)\n", size, size, rate*size*size/1e6,
+	   scalar*size*size/1e6, rate/scalar);
 }
 
 static enum test_res test012_func(void)
@@ -58,13 +73,22 @@ static enum test_res test012_func(void)
     unsigned int i;
     u32 sizes[3] = { 10, 20, 50 };
     u32 size;
+    int compare;
+
+    /* Compare the vectorized fill with the scalar one, if it's used */
+    compare = fb_fix.type == FB_TYPE_PACKED_PIXELS &&
+	      (fb_var.bits_per_pixel == 8 || fb_var.bits_per_pixel == 16 ||
+	       fb_var.bits_per_pixel == 24 || fb_var.bits_per_pixel == 32);
+    if (compare)
+	printf("Vectorized fill: %s\n", fb_var.bits_per_pixel == 24 ?
+	       memfill24_name() : memfill32_name());
 
     while (1)
 	for (i = 0; i < sizeof(sizes)/sizeof(*sizes); i++) {
 	    size = sizes[i];
 	    if (size > fb_var.xres_virtual || size > fb_var.yres_virtual)
 		goto out;
-	    benchmark_squares(size);
+	    benchmark_squares(size, compare);
 	    sizes[i] *= 10;
 	}
 
@@ -0,0 +1,67 @@
+/*
+ *  Test014
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <stdio.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "frame.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+#define NUM_BUFFERS	3
+#define NUM_FRAMES	300
+
+
+static enum test_res test014_func(void)
+{
+    struct frame_stats stats;
+    u32 i, r, bar, x, y;
+    int dx, dy;
+
+    frame_init(NUM_BUFFERS);
+
+    r = min(fb_var.xres, fb_var.yres)/16+1;
+    bar = fb_var.xres/32+1;
+    x = r;
+    y = r;
+    dx = dy = max(r/4, 1U);
+    for (i = 0; i < NUM_FRAMES; i++) {
+	begin_frame();
+	fill_rect(0, 0, fb_var.xres, fb_var.yres, fb_current->black_pixel);
+	fill_rect(i*bar % (fb_var.xres-bar+1), 0, bar, fb_var.yres,
+		  fb_current->white_pixel);
+	fill_circle(x, y, r, fb_current->white_pixel);
+	end_frame();
+
+	if ((dx < 0 && x < r-dx) || (dx > 0 && x+r+dx >= fb_var.xres))
+	    dx = -dx;
+	if ((dy < 0 && y < r-dy) || (dy > 0 && y+r+dy >= fb_var.yres))
+	    dy = -dy;
+	x += dx;
+	y += dy;
+    }
+
+    frame_get_stats(&stats);
+    frame_cleanup();
+
+    printf("%u frames in %.2f s: %.1f fps (refresh %.1f Hz), %u late, "
+	   "%u vblanks missed\n", stats.frames, stats.usecs/1e6,
+	   stats.usecs ? (stats.frames-1)*1e6/stats.usecs : 0.0,
+	   1e6/stats.period, stats.late, stats.missed);
+    return TEST_OK;
+}
+
+const struct test test014 = {
+    .name =	"test014",
+    .desc =	"Page flipping animation",
+    .visual =	VISUAL_MONO,
+    .func =	test014_func,
+};
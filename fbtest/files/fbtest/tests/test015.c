@@ -0,0 +1,99 @@
+
+/*
+ *  Test015
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+
+#define NUM_OPS		2000
+
+    /*
+     *  Fills and copies of random rectangles, on both the vectorized and the
+     *  bit granular scalar paths, must put the pixels where set_pixel() does
+     */
+
+static enum test_res test015_func(void)
+{
+    u32 width = min(fb_var.xres, 256), height = min(fb_var.yres, 64);
+    u32 i, j, x, y, w, h, sx, sy, errors = 0;
+    pixel_t pixelmask, pixel, *ref, *tmp;
+
+    ref = malloc(width*height*sizeof(*ref));
+    tmp = malloc(width*height*sizeof(*tmp));
+    if (!ref || !tmp)
+	Fatal("Not enough memory\n");
+    pixelmask = (1ULL << fb_var.bits_per_pixel)-1;
+    for (y = 0, i = 0; y < height; y++)
+	for (x = 0; x < width; x++, i++) {
+	    ref[i] = lrand48() & pixelmask;
+	    set_pixel(x, y, ref[i]);
+	}
+
+    for (i = 0; i < NUM_OPS; i++) {
+	w = 1+lrand48() % width;
+	h = 1+lrand48() % height;
+	x = lrand48() % (width-w+1);
+	y = lrand48() % (height-h+1);
+	fb_current->no_simd = i & 1;
+	switch (i % 3) {
+	    case 0:
+		pixel = lrand48() & pixelmask;
+		fill_rect(x, y, w, h, pixel);
+		for (j = 0; j < w*h; j++)
+		    ref[(y+j/w)*width+x+j%w] = pixel;
+		break;
+
+	    case 1:
+		pixel = lrand48() & pixelmask;
+		draw_hline(x, y, w, pixel);
+		for (j = 0; j < w; j++)
+		    ref[y*width+x+j] = pixel;
+		break;
+
+	    case 2:
+		sx = lrand48() % (width-w+1);
+		sy = lrand48() % (height-h+1);
+		copy_rect(x, y, w, h, sx, sy);
+		for (j = 0; j < h; j++)
+		    memcpy(&tmp[j*w], &ref[(sy+j)*width+sx], w*sizeof(*ref));
+		for (j = 0; j < h; j++)
+		    memcpy(&ref[(y+j)*width+x], &tmp[j*w], w*sizeof(*ref));
+		break;
+	}
+    }
+    fb_current->no_simd = 0;
+
+    for (y = 0, i = 0; y < height; y++)
+	for (x = 0; x < width; x++, i++)
+	    if (get_pixel(x, y) != ref[i] && !errors++)
+		Message("Mismatch at (%u, %u)\n", x, y);
+    free(tmp);
+    free(ref);
+    if (errors) {
+	Message("%u pixels differ\n", errors);
+	return TEST_FAIL;
+    }
+
+    wait_for_key(10);
+    return TEST_OK;
+}
+
+const struct test test015 = {
+    .name =	"test015",
+    .desc =	"Pixel order of fills and copies",
+    .visual =	VISUAL_GENERIC,
+    .func =	test015_func,
+};
@@ -0,0 +1,110 @@
+
+/*
+ *  Test016
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+
+struct param {
+    u32 xrange;
+    u32 yrange;
+    u32 size;
+    const pixel_t *pixmap;
+    void (*draw)(u32 x, u32 y, u32 width, u32 height,
+		 const pixel_t *pixmap);
+};
+
+static void draw_pixmaps(unsigned long n, void *data)
+{
+    struct param *param = data;
+
+    while (n--)
+	param->draw(lrand48() % param->xrange,
+		    lrand48() % param->yrange, param->size,
+		    param->size, param->pixmap);
+}
+
+static void benchmark_pixmaps(u32 size, const pixel_t *pixmap, int compare)
+{
+    struct param param;
+    double rate, generic;
+
+    param.xrange = fb_var.xres_virtual-size+1;
+    param.yrange = fb_var.yres_virtual-size+1;
+    param.size = size;
+    param.pixmap = pixmap;
+    param.draw = DRAWOPS.draw_pixmap;
+
+    rate = benchmark(draw_pixmaps, &param);
+    if (rate < 0)
+	return;
+
+    if (!compare) {
+	printf("%ux%u pixmaps: %.2f Mpixels/s\n", size, size,
+	       rate*size*size/1e6);
+	return;
+    }
+
+    param.draw = generic_draw_pixmap;
+    generic = benchmark(draw_pixmaps, &param);
+    if (generic < 0)
+	return;
+
+    printf("%ux%u pixmaps: %.2f Mpixels/s (generic %.2f Mpixels/s, "
+	   "speedup %.2f)\n", size, size, rate*size*size/1e6,
+	   generic*size*size/1e6, rate/generic);
+}
+
+static enum test_res test016_func(void)
+{
+    unsigned int i;
+    u32 sizes[3] = { 10, 20, 50 };
+    u32 size, maxsize;
+    pixel_t *pixmap, pixelmask;
+    int compare;
+
+    maxsize = min(fb_var.xres_virtual, fb_var.yres_virtual);
+    pixmap = malloc(maxsize*maxsize*sizeof(*pixmap));
+    if (!pixmap)
+	Fatal("Not enough memory\n");
+    pixelmask = (1ULL << fb_var.bits_per_pixel)-1;
+    for (i = 0; i < maxsize*maxsize; i++)
+	pixmap[i] = lrand48() & pixelmask;
+
+    /* Compare with the generic routine, if there's a native one */
+    compare = fb_drawops.draw_pixmap != generic_draw_pixmap;
+
+    while (1)
+	for (i = 0; i < sizeof(sizes)/sizeof(*sizes); i++) {
+	    size = sizes[i];
+	    if (size > maxsize)
+		goto out;
+	    benchmark_pixmaps(size, pixmap, compare);
+	    sizes[i] *= 10;
+	}
+
+out:
+    free(pixmap);
+    wait_for_key(10);
+    return TEST_OK;
+}
+
+const struct test test016 = {
+    .name =	"test016",
+    .desc =	"Drawing pixmaps",
+    .visual =	VISUAL_GENERIC,
+    .func =	test016_func,
+};
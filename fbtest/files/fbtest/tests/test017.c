@@ -0,0 +1,145 @@
+
+/*
+ *  Test017
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "dlist.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+#define SCENE_SEED	16
+#define SCENE_SIZE	32	/* max. primitive size */
+
+
+struct param {
+    u32 xrange;
+    u32 yrange;
+    pixel_t pixelmask;
+    const u8 *bitmap;
+    const pixel_t *pixmap;
+};
+
+    /*
+     *  Draw a random mix of small primitives, all within the visible screen
+     */
+
+static void draw_scene(unsigned long n, void *data)
+{
+    const struct param *param = data;
+    u32 x, y, w, h;
+    pixel_t pixel;
+
+    while (n--) {
+	x = lrand48() % param->xrange;
+	y = lrand48() % param->yrange;
+	w = lrand48() % SCENE_SIZE + 1;
+	h = lrand48() % SCENE_SIZE + 1;
+	pixel = lrand48() & param->pixelmask;
+	switch (lrand48() % 6) {
+	    case 0:
+		fill_rect(x, y, w, h, pixel);
+		break;
+	    case 1:
+		draw_rect(x, y, w, h, pixel);
+		break;
+	    case 2:
+		draw_line(x, y, x+w-1, y+h-1, pixel);
+		break;
+	    case 3:
+		fill_circle(x+SCENE_SIZE/2, y+SCENE_SIZE/2, w/2+1, pixel);
+		break;
+	    case 4:
+		expand_bitmap(x, y, w, h, param->bitmap, SCENE_SIZE/8, pixel,
+			      ~pixel & param->pixelmask);
+		break;
+	    case 5:
+		draw_pixmap(x, y, w, h, param->pixmap);
+		break;
+	}
+    }
+}
+
+static void draw_scene_dlist(unsigned long n, void *data)
+{
+    dlist_begin();
+    draw_scene(n, data);
+    dlist_end();
+}
+
+static enum test_res test017_func(void)
+{
+    struct param param;
+    u8 bitmap[SCENE_SIZE*SCENE_SIZE/8];
+    pixel_t pixmap[SCENE_SIZE*SCENE_SIZE], *screen;
+    u32 i, x, y, n, errors = 0;
+    double immediate, deferred;
+
+    if (fb_var.xres < 2*SCENE_SIZE || fb_var.yres < 2*SCENE_SIZE)
+	return TEST_NA;
+
+    param.xrange = fb_var.xres-SCENE_SIZE;
+    param.yrange = fb_var.yres-SCENE_SIZE;
+    param.pixelmask = (1ULL << fb_var.bits_per_pixel)-1;
+    for (i = 0; i < sizeof(bitmap); i++)
+	bitmap[i] = lrand48();
+    for (i = 0; i < SCENE_SIZE*SCENE_SIZE; i++)
+	pixmap[i] = lrand48() & param.pixelmask;
+    param.bitmap = bitmap;
+    param.pixmap = pixmap;
+
+    screen = malloc(fb_var.xres*fb_var.yres*sizeof(*screen));
+    if (!screen)
+	Fatal("Not enough memory\n");
+
+    /* Draw the same scene immediately and using a display list */
+    n = fb_var.xres*fb_var.yres/(SCENE_SIZE*SCENE_SIZE)*4;
+    fill_rect(0, 0, fb_var.xres, fb_var.yres, fb_current->black_pixel);
+    srand48(SCENE_SEED);
+    draw_scene(n, &param);
+    for (y = 0, i = 0; y < fb_var.yres; y++)
+	for (x = 0; x < fb_var.xres; x++)
+	    screen[i++] = get_pixel(x, y);
+
+    fill_rect(0, 0, fb_var.xres, fb_var.yres, fb_current->black_pixel);
+    srand48(SCENE_SEED);
+    draw_scene_dlist(n, &param);
+    for (y = 0, i = 0; y < fb_var.yres; y++)
+	for (x = 0; x < fb_var.xres; x++, i++)
+	    if (get_pixel(x, y) != screen[i] && !errors++)
+		Message("Display list mismatch at (%u, %u)\n", x, y);
+    free(screen);
+    if (errors) {
+	Message("%u pixels differ\n", errors);
+	return TEST_FAIL;
+    }
+
+    immediate = benchmark(draw_scene, &param);
+    if (immediate < 0)
+	return TEST_OK;
+    deferred = benchmark(draw_scene_dlist, &param);
+    if (deferred < 0)
+	return TEST_OK;
+    printf("Immediate %.0f primitives/s, display list %.0f primitives/s "
+	   "(speedup %.2f)\n", immediate, deferred, deferred/immediate);
+
+    wait_for_key(10);
+    return TEST_OK;
+}
+
+const struct test test017 = {
+    .name =	"test017",
+    .desc =	"Display list",
+    .visual =	VISUAL_GENERIC,
+    .func =	test017_func,
+};
@@ -0,0 +1,138 @@
+
+/*
+ *  Test018
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "workers.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+
+struct param {
+    u32 width;
+    u32 height;
+    pixel_t pixelmask;
+    const pixel_t *pixmap;
+};
+
+static void fill_screen(unsigned long n, void *data)
+{
+    const struct param *param = data;
+
+    while (n--)
+	fill_rect(0, 0, param->width, param->height, n & param->pixelmask);
+}
+
+static void draw_screen(unsigned long n, void *data)
+{
+    const struct param *param = data;
+
+    while (n--)
+	draw_pixmap(0, 0, param->width, param->height, param->pixmap);
+}
+
+static void copy_screen(unsigned long n, void *data)
+{
+    const struct param *param = data;
+    u32 half = param->height/2;
+
+    while (n--)
+	copy_rect(0, n & 1 ? half : 0, param->width, half, 0,
+		  n & 1 ? 0 : half);
+}
+
+    /*
+     *  Large operations, including overlapping copies in all directions
+     */
+
+static void draw_scene(const struct param *param)
+{
+    u32 w = param->width, h = param->height;
+
+    draw_pixmap(0, 0, w, h, param->pixmap);
+    fill_rect(3, 5, w-7, h/2, fb_current->white_pixel);
+    copy_rect(0, 37, w, h-37, 0, 0);
+    copy_rect(0, 0, w, h-101, 0, 101);
+    copy_rect(13, 0, w-13, h, 0, 0);
+    copy_rect(0, 0, w-29, h, 29, 0);
+    copy_rect(7, 1, w-7, h-1, 0, 0);
+}
+
+static enum test_res test018_func(void)
+{
+    struct param param;
+    pixel_t *pixmap, *screen;
+    u32 i, x, y, n, errors = 0;
+    double rate[3];
+
+    param.width = fb_var.xres;
+    param.height = fb_var.yres;
+    pixmap = malloc(param.width*param.height*sizeof(*pixmap));
+    screen = malloc(param.width*param.height*sizeof(*screen));
+    if (!pixmap || !screen)
+	Fatal("Not enough memory\n");
+    param.pixelmask = (1ULL << fb_var.bits_per_pixel)-1;
+    for (i = 0; i < param.width*param.height; i++)
+	pixmap[i] = lrand48() & param.pixelmask;
+    param.pixmap = pixmap;
+
+    /* Compare with the results of a single thread */
+    n = workers_get_threads();
+    if (workers_max_threads() > 1) {
+	workers_set_threads(1);
+	draw_scene(&param);
+	for (y = 0, i = 0; y < param.height; y++)
+	    for (x = 0; x < param.width; x++)
+		screen[i++] = get_pixel(x, y);
+	workers_set_threads(workers_max_threads());
+	fill_rect(0, 0, param.width, param.height, fb_current->black_pixel);
+	draw_scene(&param);
+	for (y = 0, i = 0; y < param.height; y++)
+	    for (x = 0; x < param.width; x++, i++)
+		if (get_pixel(x, y) != screen[i] && !errors++)
+		    Message("Thread mismatch at (%u, %u)\n", x, y);
+    }
+    free(screen);
+    if (errors) {
+	Message("%u pixels differ\n", errors);
+	free(pixmap);
+	workers_set_threads(n);
+	return TEST_FAIL;
+    }
+
+    /* Scaling */
+    for (i = 1; i <= workers_max_threads(); i++) {
+	workers_set_threads(i);
+	if ((rate[0] = benchmark(fill_screen, &param)) < 0 ||
+	    (rate[1] = benchmark(draw_screen, &param)) < 0 ||
+	    (rate[2] = benchmark(copy_screen, &param)) < 0)
+	    break;
+	printf("%u thread%s: fill %.1f, pixmap %.1f, copy %.1f Mpixels/s\n",
+	       i, i > 1 ? "s" : "", rate[0]*param.width*param.height/1e6,
+	       rate[1]*param.width*param.height/1e6,
+	       rate[2]*param.width*(param.height/2)/1e6);
+    }
+    workers_set_threads(n);
+
+    free(pixmap);
+    wait_for_key(10);
+    return TEST_OK;
+}
+
+const struct test test018 = {
+    .name =	"test018",
+    .desc =	"Multi-threaded drawing",
+    .visual =	VISUAL_GENERIC,
+    .func =	test018_func,
+};
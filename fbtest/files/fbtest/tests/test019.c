@@ -0,0 +1,161 @@
+
+/*
+ *  Test019
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "bitstream.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+
+struct param {
+    u32 width;
+    u32 height;
+    const pixel_t *background;
+    const u32 *argb;
+};
+
+    /*
+     *  A random premultiplied ARGB pixel, fully transparent or opaque now and
+     *  then
+     */
+
+static u32 random_argb(void)
+{
+    u32 a, r, g, b;
+
+    switch (lrand48() % 4) {
+	case 0:
+	    return 0;
+
+	case 1:
+	    a = 255;
+	    break;
+
+	default:
+	    a = lrand48() % 256;
+	    break;
+    }
+    r = lrand48() % (a+1);
+    g = lrand48() % (a+1);
+    b = lrand48() % (a+1);
+    return a << 24 | r << 16 | g << 8 | b;
+}
+
+static void draw_scene(const struct param *param)
+{
+    u32 w = param->width, h = param->height;
+
+    draw_pixmap(0, 0, w, h, param->background);
+    blend_pixmap(3, 1, w-7, h-2, param->argb);
+    blend_pixmap(w/3, h/5, 1, h/2, param->argb);
+    blend_rect(1, 2, w-5, h/3, 0x80402000);
+    blend_rect(w/4, h/4, w/2+1, h/2, 0xff123456);
+    blend_rect(5, h/2, w/2, h/3, 0x01010101);
+}
+
+static void blend_screen(unsigned long n, void *data)
+{
+    const struct param *param = data;
+
+    while (n--)
+	blend_rect(0, 0, param->width, param->height, 0x80402010);
+}
+
+static void blend_pixmap_screen(unsigned long n, void *data)
+{
+    const struct param *param = data;
+
+    while (n--)
+	blend_pixmap(0, 0, param->width, param->height, param->argb);
+}
+
+static void benchmark_blend(const char *name,
+			    void (*func)(unsigned long n, void *data),
+			    struct param *param)
+{
+    double rate, scalar;
+    u32 pixels = param->width*param->height;
+
+    if ((rate = benchmark(func, param)) < 0)
+	return;
+    fb_current->no_simd = 1;
+    scalar = benchmark(func, param);
+    fb_current->no_simd = 0;
+    if (scalar < 0)
+	return;
+
+    printf("%s: %.2f Mpixels/s (generic %.2f Mpixels/s, speedup %.2f)\n",
+	   name, rate*pixels/1e6, scalar*pixels/1e6, rate/scalar);
+}
+
+static enum test_res test019_func(void)
+{
+    struct param param;
+    pixel_t *background, *screen, pixelmask;
+    u32 *argb;
+    u32 i, x, y, errors = 0;
+
+    param.width = fb_var.xres;
+    param.height = fb_var.yres;
+    background = malloc(param.width*param.height*sizeof(*background));
+    screen = malloc(param.width*param.height*sizeof(*screen));
+    argb = malloc(param.width*param.height*sizeof(*argb));
+    if (!background || !screen || !argb)
+	Fatal("Not enough memory\n");
+    pixelmask = (1ULL << fb_var.bits_per_pixel)-1;
+    for (i = 0; i < param.width*param.height; i++) {
+	background[i] = lrand48() & pixelmask;
+	argb[i] = random_argb();
+    }
+    param.background = background;
+    param.argb = argb;
+
+    /* Compare with the results of the generic routines */
+    fb_current->no_simd = 1;
+    draw_scene(&param);
+    for (y = 0, i = 0; y < param.height; y++)
+	for (x = 0; x < param.width; x++)
+	    screen[i++] = get_pixel(x, y);
+    fb_current->no_simd = 0;
+    draw_scene(&param);
+    for (y = 0, i = 0; y < param.height; y++)
+	for (x = 0; x < param.width; x++, i++)
+	    if (get_pixel(x, y) != screen[i] && !errors++)
+		Message("Blend mismatch at (%u, %u): 0x%llx != 0x%llx\n", x,
+			y, (unsigned long long)get_pixel(x, y),
+			(unsigned long long)screen[i]);
+    free(screen);
+    free(background);
+    if (errors) {
+	Message("%u pixels differ\n", errors);
+	free(argb);
+	return TEST_FAIL;
+    }
+
+    printf("Vectorized blend: %s\n", blend_name());
+    benchmark_blend("Solid blend", blend_screen, &param);
+    benchmark_blend("Pixmap blend", blend_pixmap_screen, &param);
+
+    free(argb);
+    wait_for_key(10);
+    return TEST_OK;
+}
+
+const struct test test019 = {
+    .name =	"test019",
+    .desc =	"Alpha blending",
+    .visual =	VISUAL_TRUECOLOR,
+    .func =	test019_func,
+};
@@ -0,0 +1,167 @@
+
+/*
+ *  Test020
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+
+#define MAX_VERTICES	4096
+
+struct param {
+    struct point *points;
+    u32 num;
+    enum fill_rule rule;
+};
+
+static void fill_polygons(unsigned long n, void *data)
+{
+    const struct param *param = data;
+
+    while (n--)
+	fill_polygon(param->points, param->num, param->rule, n & 1 ?
+		     fb_current->white_pixel : fb_current->black_pixel);
+}
+
+    /*
+     *  Whether the top left corner of a pixel is inside the polygon
+     */
+
+static int polygon_inside(const struct point *points, u32 num,
+			  enum fill_rule rule, int x, int y)
+{
+    const struct point *a, *b, *p;
+    int wind = 0, dir;
+    u32 i;
+
+    for (i = 0; i < num; i++) {
+	a = &points[i];
+	b = &points[(i+1) % num];
+	dir = 1;
+	if ((int)a->y > (int)b->y) {
+	    p = a;
+	    a = b;
+	    b = p;
+	    dir = -1;
+	}
+	if (y < (int)a->y || y >= (int)b->y)
+	    continue;
+	if ((long long)(y-(int)a->y)*((int)b->x-(int)a->x) <=
+	    (long long)(x-(int)a->x)*((int)b->y-(int)a->y))
+	    wind += dir;
+    }
+    return rule == FILL_EVEN_ODD ? wind & 1 : wind != 0;
+}
+
+static u32 check_polygon(const struct point *points, u32 num,
+			 enum fill_rule rule)
+{
+    u32 x, y, errors = 0;
+    pixel_t pixel;
+
+    fill_rect(0, 0, fb_var.xres, fb_var.yres, fb_current->black_pixel);
+    fill_polygon(points, num, rule, fb_current->white_pixel);
+    for (y = 0; y < fb_var.yres; y++)
+	for (x = 0; x < fb_var.xres; x++) {
+	    pixel = polygon_inside(points, num, rule, x, y)
+		    ? fb_current->white_pixel : fb_current->black_pixel;
+	    if (get_pixel(x, y) != pixel && !errors++)
+		Message("%u vertices, %s: mismatch at (%u, %u)\n", num,
+			rule == FILL_EVEN_ODD ? "even-odd" : "non-zero", x,
+			y);
+	}
+    return errors;
+}
+
+    /*
+     *  Vertices around an ellipse, with a random radius in [r0, r1] of the
+     *  ellipse, visiting the angles turns times
+     */
+
+static void make_polygon(struct point *points, u32 num, int cx, int cy,
+			 int a, int b, double r0, double r1, u32 turns)
+{
+    double phi, r;
+    u32 i;
+
+    for (i = 0; i < num; i++) {
+	phi = 2*M_PI*turns*i/num;
+	r = r0+(r1-r0)*drand48();
+	points[i].x = cx+(int)lround(r*a*cos(phi));
+	points[i].y = cy+(int)lround(r*b*sin(phi));
+    }
+}
+
+static enum test_res test020_func(void)
+{
+    static const u32 sizes[] = { 3, 4, 5, 7, 12, 40 };
+    u32 w = fb_var.xres, h = fb_var.yres;
+    struct point *points;
+    struct param param;
+    u32 i, errors = 0;
+    double rate;
+    int rule;
+
+    if (!(points = malloc(MAX_VERTICES*sizeof(*points))))
+	Fatal("Not enough memory\n");
+
+    for (i = 0; i < sizeof(sizes)/sizeof(*sizes); i++)
+	for (rule = FILL_EVEN_ODD; rule <= FILL_NON_ZERO; rule++) {
+	    /* Convex */
+	    make_polygon(points, sizes[i], w/2, h/2, w/2-1, h/2-1, 1, 1, 1);
+	    errors += check_polygon(points, sizes[i], rule);
+	    /* Star shaped */
+	    make_polygon(points, sizes[i], w/2, h/2, w/2-1, h/2-1, 0.2, 1, 1);
+	    errors += check_polygon(points, sizes[i], rule);
+	    /* Self-intersecting, winding around twice */
+	    make_polygon(points, sizes[i], w/2, h/2, w/2-1, h/2-1, 0.5, 1, 2);
+	    errors += check_polygon(points, sizes[i], rule);
+	    /* Partially off screen */
+	    make_polygon(points, sizes[i], w/3, h/4, w/2, h/2, 0.3, 1.5, 1);
+	    errors += check_polygon(points, sizes[i], rule);
+	}
+    if (errors) {
+	Message("%u pixels differ\n", errors);
+	free(points);
+	return TEST_FAIL;
+    }
+
+    param.points = points;
+    for (param.num = 4; param.num <= MAX_VERTICES; param.num *= 8) {
+	make_polygon(points, param.num, w/2, h/2, w/2-1, h/2-1, 1, 1, 1);
+	param.rule = FILL_EVEN_ODD;
+	if ((rate = benchmark(fill_polygons, &param)) < 0)
+	    break;
+	printf("%u vertices, convex: %.1f polygons/s\n", param.num, rate);
+	make_polygon(points, param.num, w/2, h/2, w/2-1, h/2-1, 0.2, 1, 3);
+	param.rule = FILL_NON_ZERO;
+	if ((rate = benchmark(fill_polygons, &param)) < 0)
+	    break;
+	printf("%u vertices, self-intersecting: %.1f polygons/s\n", param.num,
+	       rate);
+    }
+
+    free(points);
+    wait_for_key(10);
+    return TEST_OK;
+}
+
+const struct test test020 = {
+    .name =	"test020",
+    .desc =	"Filling polygons",
+    .visual =	VISUAL_GENERIC,
+    .func =	test020_func,
+};
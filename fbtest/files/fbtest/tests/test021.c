@@ -0,0 +1,112 @@
+
+/*
+ *  Test021
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "bitstream.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+
+struct param {
+    u32 width;
+    u32 height;
+    const u8 *chunky;
+    u32 pitch;
+};
+
+static void flush_screen(unsigned long n, void *data)
+{
+    const struct param *param = data;
+
+    while (n--)
+	draw_chunky(0, 0, param->width, param->height, param->chunky,
+		    param->pitch);
+}
+
+static void flush_screen_generic(unsigned long n, void *data)
+{
+    const struct param *param = data;
+
+    while (n--)
+	generic_draw_chunky(0, 0, param->width, param->height, param->chunky,
+			    param->pitch);
+}
+
+static u32 check_chunky(const struct param *param, u32 x, u32 y, u32 width,
+			u32 height)
+{
+    u32 i, j, errors = 0;
+    pixel_t pixel;
+
+    fill_rect(0, 0, param->width, param->height, fb_current->black_pixel);
+    draw_chunky(x, y, width, height, param->chunky, param->pitch);
+    for (j = 0; j < param->height; j++)
+	for (i = 0; i < param->width; i++) {
+	    pixel = i >= x && i < x+width && j >= y && j < y+height
+		    ? param->chunky[(j-y)*param->pitch+i-x]
+		    : fb_current->black_pixel;
+	    if (get_pixel(i, j) != pixel && !errors++)
+		Message("%ux%u at (%u, %u): mismatch at (%u, %u)\n", width,
+			height, x, y, i, j);
+	}
+    return errors;
+}
+
+static enum test_res test021_func(void)
+{
+    struct param param;
+    u8 *chunky, mask;
+    u32 i, errors = 0;
+    double rate, generic;
+
+    param.width = fb_var.xres;
+    param.height = fb_var.yres;
+    /* An odd pitch, so lines are not aligned */
+    param.pitch = param.width+3;
+    if (!(chunky = malloc(param.pitch*param.height)))
+	Fatal("Not enough memory\n");
+    mask = fb_var.bits_per_pixel < 8 ? (1 << fb_var.bits_per_pixel)-1 : 0xff;
+    for (i = 0; i < param.pitch*param.height; i++)
+	chunky[i] = lrand48() & mask;
+    param.chunky = chunky;
+
+    /* Full screen, and unaligned rectangles of all widths up to 40 */
+    errors += check_chunky(&param, 0, 0, param.width, param.height);
+    for (i = 1; i <= 40 && !errors; i++)
+	errors += check_chunky(&param, i*7 % 17, i % 5, i, param.height/2);
+    if (errors) {
+	Message("%u pixels differ\n", errors);
+	free(chunky);
+	return TEST_FAIL;
+    }
+
+    printf("Chunky to planar: %s\n", c2p_name());
+    if ((rate = benchmark(flush_screen, &param)) >= 0 &&
+	(generic = benchmark(flush_screen_generic, &param)) >= 0)
+	printf("Full screen: %.2f Mpixels/s (per pixel %.2f Mpixels/s, "
+	       "speedup %.2f)\n", rate*param.width*param.height/1e6,
+	       generic*param.width*param.height/1e6, rate/generic);
+
+    free(chunky);
+    wait_for_key(10);
+    return TEST_OK;
+}
+
+const struct test test021 = {
+    .name =	"test021",
+    .desc =	"Drawing chunky pixels",
+    .visual =	VISUAL_GENERIC,
+    .func =	test021_func,
+};
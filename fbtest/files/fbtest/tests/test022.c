@@ -0,0 +1,158 @@
+
+/*
+ *  Test022
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+
+#define NUM_SHAPES	64
+#define NUM_SPANS	256
+
+struct shape {
+    u32 x, y, a, b;
+    pixel_t pixel;
+};
+
+struct param {
+    struct shape shapes[NUM_SHAPES];
+    struct span spans[NUM_SPANS];
+    void (*circle)(u32 x, u32 y, u32 r, pixel_t pixel);
+    void (*ellipse)(u32 x, u32 y, u32 a, u32 b, pixel_t pixel);
+    void (*spans_func)(const struct span *spans, u32 num, pixel_t pixel);
+};
+
+static void draw_shapes(const struct param *param)
+{
+    const struct shape *s;
+    u32 i;
+
+    for (i = 0, s = param->shapes; i < NUM_SHAPES; i++, s++) {
+	if (i & 1)
+	    param->ellipse(s->x, s->y, s->a, s->b, s->pixel);
+	else
+	    param->circle(s->x, s->y, s->a, s->pixel);
+	if (!(i % 8))
+	    param->spans_func(param->spans, NUM_SPANS, s->pixel);
+    }
+}
+
+static void draw_outlines(unsigned long n, void *data)
+{
+    while (n--)
+	draw_shapes(data);
+}
+
+    /*
+     *  The installed operations, which may be specialized for the depth
+     */
+
+static void circle(u32 x, u32 y, u32 r, pixel_t pixel)
+{
+    draw_circle(x, y, r, pixel);
+}
+
+static void ellipse(u32 x, u32 y, u32 a, u32 b, pixel_t pixel)
+{
+    draw_ellipse(x, y, a, b, pixel);
+}
+
+static void spans(const struct span *spans, u32 num, pixel_t pixel)
+{
+    fill_spans(spans, num, pixel);
+}
+
+static pixel_t *read_screen(pixel_t *screen)
+{
+    u32 x, y;
+
+    for (y = 0; y < fb_var.yres; y++)
+	for (x = 0; x < fb_var.xres; x++)
+	    *screen++ = get_pixel(x, y);
+    return screen;
+}
+
+static enum test_res test022_func(void)
+{
+    u32 w = fb_var.xres, h = fb_var.yres, r = min(w, h)/2;
+    pixel_t pixelmask, *screen, *p;
+    struct param param;
+    struct shape *s;
+    struct span *span;
+    u32 i, x, y, errors = 0;
+    double rate, generic;
+
+    pixelmask = (1ULL << fb_var.bits_per_pixel)-1;
+    for (i = 0, s = param.shapes; i < NUM_SHAPES; i++, s++) {
+	s->a = lrand48() % r;
+	s->b = i % 4 == 1 ? s->a : lrand48() % r;
+	s->x = r+lrand48() % (w-2*r+1);
+	s->y = r+lrand48() % (h-2*r+1);
+	s->pixel = lrand48() & pixelmask;
+    }
+    for (i = 0, span = param.spans; i < NUM_SPANS; i++, span++) {
+	span->x = lrand48() % w;
+	span->y = lrand48() % h;
+	span->length = 1+lrand48() % (i & 1 ? w-span->x : min(w-span->x, 8));
+    }
+
+    /* Compare with the results of the unspecialized generic routines */
+    if (!(screen = malloc(2*w*h*sizeof(*screen))))
+	Fatal("Not enough memory\n");
+    param.circle = circle;
+    param.ellipse = ellipse;
+    param.spans_func = spans;
+    fill_rect(0, 0, w, h, fb_current->black_pixel);
+    draw_shapes(&param);
+    p = read_screen(screen);
+    param.circle = generic_draw_circle;
+    param.ellipse = generic_draw_ellipse;
+    param.spans_func = generic_fill_spans;
+    fill_rect(0, 0, w, h, fb_current->black_pixel);
+    draw_shapes(&param);
+    read_screen(p);
+    for (y = 0, i = 0; y < h; y++)
+	for (x = 0; x < w; x++, i++)
+	    if (screen[i] != p[i] && !errors++)
+		Message("Mismatch at (%u, %u): 0x%llx != 0x%llx\n", x, y,
+			(unsigned long long)screen[i],
+			(unsigned long long)p[i]);
+    free(screen);
+    if (errors) {
+	Message("%u pixels differ\n", errors);
+	return TEST_FAIL;
+    }
+
+    if ((generic = benchmark(draw_outlines, &param)) < 0)
+	goto out;
+    param.circle = circle;
+    param.ellipse = ellipse;
+    param.spans_func = spans;
+    if ((rate = benchmark(draw_outlines, &param)) < 0)
+	goto out;
+    printf("Outlines and spans: %.1f batches/s (generic %.1f batches/s, "
+	   "speedup %.2f)\n", rate, generic, rate/generic);
+
+out:
+    wait_for_key(10);
+    return TEST_OK;
+}
+
+const struct test test022 = {
+    .name =	"test022",
+    .desc =	"Drawing outlines and spans",
+    .visual =	VISUAL_GENERIC,
+    .func =	test022_func,
+};
@@ -0,0 +1,199 @@
+
+/*
+ *  Test023
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "fb.h"
+#include "bitstream.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+
+#define MAX_BITS	(1 << 20)
+#define BUF_WORDS	(MAX_BITS/BITS_PER_LONG+2)
+
+#define NUM_CHECKS	2000
+
+enum op {
+    OP_COPY,
+    OP_COPY_REV,
+    OP_COPY_NOT,
+    OP_FILL,
+};
+
+static const char *op_names[] = {
+    [OP_COPY] =		"bitcpy",
+    [OP_COPY_REV] =	"bitcpy_rev",
+    [OP_COPY_NOT] =	"bitcpy_not",
+    [OP_FILL] =		"bitfill32",
+};
+
+struct param {
+    enum op op;
+    unsigned long *dst;
+    int dst_idx;
+    const unsigned long *src;
+    int src_idx;
+    u32 n;
+};
+
+static void do_op(const struct param *param)
+{
+    switch (param->op) {
+	case OP_COPY:
+	    bitcpy(param->dst, param->dst_idx, param->src, param->src_idx,
+		   param->n);
+	    break;
+
+	case OP_COPY_REV:
+	    bitcpy_rev(param->dst, param->dst_idx, param->src, param->src_idx,
+		       param->n);
+	    break;
+
+	case OP_COPY_NOT:
+	    bitcpy_not(param->dst, param->dst_idx, param->src, param->src_idx,
+		       param->n);
+	    break;
+
+	case OP_FILL:
+	    bitfill32(param->dst, param->dst_idx, 0x5a3cc3a5, param->n);
+	    break;
+    }
+}
+
+static void do_ops(unsigned long n, void *data)
+{
+    while (n--)
+	do_op(data);
+}
+
+static void random_words(unsigned long *p, u32 n)
+{
+    while (n--)
+	*p++ = (unsigned long)mrand48() << 16 << 16 ^ mrand48();
+}
+
+    /*
+     *  Compare the vectorized operations with the scalar reference, on random
+     *  lengths and alignments, for separate and overlapping buffers
+     */
+
+static u32 check_ops(unsigned long *buf, unsigned long *ref)
+{
+    struct param param;
+    u32 i, errors = 0;
+    int offset, tmp;
+
+    for (i = 0; i < NUM_CHECKS; i++) {
+	param.op = i % 4;
+	param.n = 1+lrand48() % (i & 1 ? 64*BITS_PER_LONG : 8*BITS_PER_LONG);
+	param.dst_idx = lrand48() % BITS_PER_LONG;
+	param.src_idx = lrand48() % BITS_PER_LONG;
+	param.dst = buf+8+lrand48() % 8;
+	if (i % 3 || param.op == OP_COPY_NOT) {
+	    param.src = buf+100;
+	} else {
+	    /* Overlapping, in the direction the copy supports */
+	    offset = lrand48() % 8;
+	    param.src = param.op == OP_COPY_REV ? param.dst-offset
+						: param.dst+offset;
+	    if (!offset && (param.op == OP_COPY_REV
+			    ? param.dst_idx < param.src_idx
+			    : param.dst_idx > param.src_idx)) {
+		tmp = param.dst_idx;
+		param.dst_idx = param.src_idx;
+		param.src_idx = tmp;
+	    }
+	}
+
+	random_words(buf, 200);
+	memcpy(ref, buf, 200*sizeof(*buf));
+	do_op(&param);
+	param.dst = ref+(param.dst-buf);
+	param.src = ref+(param.src-buf);
+	fb_current->no_simd = 1;
+	do_op(&param);
+	fb_current->no_simd = 0;
+	if (memcmp(buf, ref, 200*sizeof(*buf)) && !errors++)
+	    Message("%s of %u bits from %d to %d differs\n",
+		    op_names[param.op], param.n, param.src_idx, param.dst_idx);
+    }
+    return errors;
+}
+
+static void benchmark_op(enum op op, u32 n, int dst_idx, int src_idx,
+			 unsigned long *dst, const unsigned long *src)
+{
+    struct param param;
+    double rate, scalar;
+
+    param.op = op;
+    param.dst = dst;
+    param.dst_idx = dst_idx;
+    param.src = src;
+    param.src_idx = src_idx;
+    param.n = n;
+
+    if ((rate = benchmark(do_ops, &param)) < 0)
+	return;
+    fb_current->no_simd = 1;
+    scalar = benchmark(do_ops, &param);
+    fb_current->no_simd = 0;
+    if (scalar < 0)
+	return;
+
+    printf("%-10s %7u bits, shift %3d: %.1f Mbits/s (scalar %.1f Mbits/s, "
+	   "speedup %.2f)\n", op_names[op], n, dst_idx-src_idx, rate*n/1e6,
+	   scalar*n/1e6, rate/scalar);
+}
+
+static enum test_res test023_func(void)
+{
+    static const u32 lengths[] = { 256, 8192, MAX_BITS-64 };
+    unsigned long *dst, *src;
+    u32 i, errors;
+
+    if (!(dst = malloc(2*BUF_WORDS*sizeof(*dst))))
+	Fatal("Not enough memory\n");
+    src = dst+BUF_WORDS;
+    random_words(src, BUF_WORDS);
+
+    errors = check_ops(dst, src);
+    if (errors) {
+	Message("%u operations differ\n", errors);
+	free(dst);
+	return TEST_FAIL;
+    }
+
+    printf("Vectorized bitstream shifts: %s\n", bitshift_name());
+    for (i = 0; i < sizeof(lengths)/sizeof(*lengths); i++) {
+	/* Aligned copies and fills are byte aligned memory operations */
+	benchmark_op(OP_COPY, lengths[i], 5, 5, dst, src);
+	benchmark_op(OP_COPY, lengths[i], 5, 19, dst, src);
+	benchmark_op(OP_COPY_REV, lengths[i], 5, 5, dst, src);
+	benchmark_op(OP_COPY_REV, lengths[i], 19, 5, dst, src);
+	benchmark_op(OP_COPY_NOT, lengths[i], 5, 19, dst, src);
+	benchmark_op(OP_FILL, lengths[i], 5, 5, dst, src);
+    }
+
+    free(dst);
+    wait_for_key(10);
+    return TEST_OK;
+}
+
+const struct test test023 = {
+    .name =	"test023",
+    .desc =	"Bitstream operations",
+    .visual =	VISUAL_GENERIC,
+    .func =	test023_func,
+};
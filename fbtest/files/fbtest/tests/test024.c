@@ -0,0 +1,395 @@
+
+/*
+ *  Test024
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "clip.h"
+#include "dlist.h"
+#include "rotate.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+
+#define NUM_RECTS	8
+#define NUM_SPANS	32
+
+#define PIXMAP_WIDTH	37
+#define PIXMAP_HEIGHT	23
+#define CHUNKY_WIDTH	29
+#define CHUNKY_HEIGHT	31
+#define CHUNKY_PITCH	33
+#define BITMAP_WIDTH	27
+#define BITMAP_HEIGHT	19
+#define BITMAP_PITCH	4
+#define BLEND_WIDTH	19
+#define BLEND_HEIGHT	13
+#define NUM_POINTS	7
+
+struct rect {
+    u32 x, y, width, height;
+    pixel_t pixel;
+};
+
+struct scene {
+    u32 size;
+    struct rect fills[NUM_RECTS], outlines[NUM_RECTS], lines[NUM_RECTS];
+    struct span spans[NUM_SPANS];
+    pixel_t span_pixel;
+    struct rect pixmap, chunky, bitmap, copy, clip, circle, ellipse;
+    struct rect polygon, blend, blend_pixmap;
+    u32 copy_x, copy_y, blend_argb;
+    struct point points[NUM_POINTS];
+    pixel_t pixmap_data[PIXMAP_WIDTH*PIXMAP_HEIGHT];
+    u8 chunky_data[CHUNKY_HEIGHT*CHUNKY_PITCH];
+    u8 bitmap_data[BITMAP_HEIGHT*BITMAP_PITCH];
+    u32 blend_data[BLEND_WIDTH*BLEND_HEIGHT];
+    int can_blend;
+};
+
+static void random_rect(struct rect *r, u32 size, u32 max_size,
+			pixel_t pixelmask)
+{
+    r->width = 1+lrand48() % max_size;
+    r->height = 1+lrand48() % max_size;
+    r->x = lrand48() % (size-r->width+1);
+    r->y = lrand48() % (size-r->height+1);
+    r->pixel = lrand48() & pixelmask;
+}
+
+static void fixed_rect(struct rect *r, u32 size, u32 width, u32 height,
+		       pixel_t pixelmask)
+{
+    r->width = width;
+    r->height = height;
+    r->x = lrand48() % (size-width+1);
+    r->y = lrand48() % (size-height+1);
+    r->pixel = lrand48() & pixelmask;
+}
+
+    /* A premultiplied ARGB8888 value */
+static u32 random_argb(void)
+{
+    u32 a = lrand48() % 256;
+
+    return a << 24 | lrand48() % (a+1) << 16 | lrand48() % (a+1) << 8 |
+	   lrand48() % (a+1);
+}
+
+static void scene_init(struct scene *scene, u32 size)
+{
+    pixel_t pixelmask = (1ULL << fb_var.bits_per_pixel)-1;
+    u32 i;
+
+    scene->size = size;
+    for (i = 0; i < NUM_RECTS; i++) {
+	random_rect(&scene->fills[i], size, size/2, pixelmask);
+	random_rect(&scene->outlines[i], size, size/2, pixelmask);
+	random_rect(&scene->lines[i], size, size, pixelmask);
+    }
+    for (i = 0; i < NUM_SPANS; i++) {
+	scene->spans[i].y = lrand48() % size;
+	scene->spans[i].length = 1+lrand48() % size;
+	scene->spans[i].x = lrand48() % (size-scene->spans[i].length+1);
+    }
+    scene->span_pixel = lrand48() & pixelmask;
+
+    fixed_rect(&scene->pixmap, size, PIXMAP_WIDTH, PIXMAP_HEIGHT, pixelmask);
+    for (i = 0; i < PIXMAP_WIDTH*PIXMAP_HEIGHT; i++)
+	scene->pixmap_data[i] = lrand48() & pixelmask;
+    fixed_rect(&scene->chunky, size, CHUNKY_WIDTH, CHUNKY_HEIGHT, pixelmask);
+    for (i = 0; i < CHUNKY_HEIGHT*CHUNKY_PITCH; i++)
+	scene->chunky_data[i] = lrand48() & pixelmask & 0xff;
+    fixed_rect(&scene->bitmap, size, BITMAP_WIDTH, BITMAP_HEIGHT, pixelmask);
+    for (i = 0; i < BITMAP_HEIGHT*BITMAP_PITCH; i++)
+	scene->bitmap_data[i] = lrand48();
+
+    /* Overlapping copy, and a fill larger than its clip rectangle */
+    random_rect(&scene->copy, size-8, size/2, pixelmask);
+    scene->copy_x = scene->copy.x+lrand48() % 8;
+    scene->copy_y = scene->copy.y+lrand48() % 8;
+    random_rect(&scene->clip, size, size/2, pixelmask);
+    /* A circle, with an outline one pixel outside, centered on the screen */
+    fixed_rect(&scene->circle, size/2, 1, 1, pixelmask);
+    scene->circle.x += size/4;
+    scene->circle.y += size/4;
+    scene->circle.width = 1+lrand48() % (size/4-2);
+    fixed_rect(&scene->ellipse, size/2, 1, 1, pixelmask);
+    scene->ellipse.x += size/4;
+    scene->ellipse.y += size/4;
+    scene->ellipse.width = lrand48() % (size/4);
+    scene->ellipse.height = lrand48() % (size/4);
+
+    /* A self-intersecting polygon, and one covering a rectangle */
+    for (i = 0; i < NUM_POINTS; i++) {
+	scene->points[i].x = lrand48() % (size+1);
+	scene->points[i].y = lrand48() % (size+1);
+    }
+    random_rect(&scene->polygon, size, size/2, pixelmask);
+
+    /* Blending needs an RGB visual */
+    scene->can_blend = fb_fix.visual == FB_VISUAL_TRUECOLOR ||
+		       fb_fix.visual == FB_VISUAL_DIRECTCOLOR;
+    random_rect(&scene->blend, size, size/2, pixelmask);
+    scene->blend_argb = random_argb();
+    fixed_rect(&scene->blend_pixmap, size, BLEND_WIDTH, BLEND_HEIGHT,
+	       pixelmask);
+    for (i = 0; i < BLEND_WIDTH*BLEND_HEIGHT; i++)
+	scene->blend_data[i] = random_argb();
+}
+
+    /*
+     *  Draw the scene in logical coordinates
+     */
+
+static void scene_draw(const struct scene *s)
+{
+    const struct rect *r;
+    struct point points[4];
+    u32 i;
+
+    fill_rect(0, 0, s->size, s->size, fb_current->black_pixel);
+    for (i = 0, r = s->fills; i < NUM_RECTS; i++, r++)
+	fill_rect(r->x, r->y, r->width, r->height, r->pixel);
+    for (i = 0, r = s->outlines; i < NUM_RECTS; i++, r++)
+	draw_rect(r->x, r->y, r->width, r->height, r->pixel);
+    for (i = 0, r = s->lines; i < NUM_RECTS; i++, r++) {
+	draw_hline(r->x, r->y, r->width, r->pixel);
+	draw_vline(r->x, r->y, r->height, r->pixel);
+	set_pixel(r->y, r->x, r->pixel);
+	draw_line(r->x, r->y, r->x+r->width-1, r->y+r->height-1, r->pixel);
+	draw_line(r->x+r->width-1, r->y, r->x, r->y+r->height-1, r->pixel);
+    }
+    fill_spans(s->spans, NUM_SPANS, s->span_pixel);
+
+    r = &s->pixmap;
+    draw_pixmap(r->x, r->y, r->width, r->height, s->pixmap_data);
+    r = &s->chunky;
+    draw_chunky(r->x, r->y, r->width, r->height, s->chunky_data,
+		CHUNKY_PITCH);
+    r = &s->bitmap;
+    expand_bitmap(r->x, r->y, r->width, r->height, s->bitmap_data,
+		  BITMAP_PITCH, fb_current->black_pixel, r->pixel);
+
+    r = &s->copy;
+    copy_rect(s->copy_x, s->copy_y, r->width, r->height, r->x, r->y);
+    r = &s->clip;
+    clip_push(r->x, r->y, r->width, r->height);
+    fill_rect(0, 0, s->size, s->size, r->pixel);
+    clip_pop();
+    r = &s->circle;
+    fill_circle(r->x, r->y, r->width, r->pixel);
+    draw_circle(r->x, r->y, r->width+1, s->span_pixel);
+    r = &s->ellipse;
+    fill_ellipse(r->x, r->y, r->width, r->height, r->pixel);
+    draw_ellipse(r->x, r->y, r->width+1, r->height+2, s->span_pixel);
+
+    fill_polygon(s->points, NUM_POINTS, FILL_EVEN_ODD, s->polygon.pixel);
+    r = &s->polygon;
+    points[0].x = points[3].x = r->x;
+    points[0].y = points[1].y = r->y;
+    points[1].x = points[2].x = r->x+r->width;
+    points[2].y = points[3].y = r->y+r->height;
+    fill_polygon(points, 4, FILL_NON_ZERO, s->span_pixel);
+
+    if (s->can_blend) {
+	r = &s->blend;
+	blend_rect(r->x, r->y, r->width, r->height, s->blend_argb);
+	r = &s->blend_pixmap;
+	blend_pixmap(r->x, r->y, r->width, r->height, s->blend_data);
+    }
+}
+
+    /*
+     *  Map a logical pixel to the frame buffer, independently of rotate.c
+     */
+
+static void map_pixel(u32 angle, u32 x, u32 y, u32 *px, u32 *py)
+{
+    switch (angle) {
+	case FB_ROTATE_CW:
+	    *px = fb_var.xres-1-y;
+	    *py = x;
+	    break;
+
+	case FB_ROTATE_UD:
+	    *px = fb_var.xres-1-x;
+	    *py = fb_var.yres-1-y;
+	    break;
+
+	case FB_ROTATE_CCW:
+	    *px = y;
+	    *py = fb_var.yres-1-x;
+	    break;
+
+	default:
+	    *px = x;
+	    *py = y;
+	    break;
+    }
+}
+
+static u32 check_scene(struct scene *scene, const pixel_t *ref, u32 angle)
+{
+    u32 size = scene->size, x, y, px, py, errors = 0;
+    pixel_t pixel;
+
+    fill_rect(0, 0, fb_var.xres, fb_var.yres, fb_current->black_pixel);
+    rotate_init(angle);
+    if (angle == FB_ROTATE_CW || angle == FB_ROTATE_CCW
+	? rotate_xres() != fb_var.yres || rotate_yres() != fb_var.xres
+	: rotate_xres() != fb_var.xres || rotate_yres() != fb_var.yres) {
+	Message("Rotation %u: wrong logical screen size %ux%u\n", angle,
+		rotate_xres(), rotate_yres());
+	errors++;
+    }
+    scene_draw(scene);
+    rotate_cleanup();
+
+    for (y = 0; y < size; y++)
+	for (x = 0; x < size; x++) {
+	    map_pixel(angle, x, y, &px, &py);
+	    pixel = get_pixel(px, py);
+	    if (pixel != ref[y*size+x] && !errors++)
+		Message("Rotation %u: mismatch at (%u, %u): 0x%llx != 0x%llx\n",
+			angle, x, y, (unsigned long long)pixel,
+			(unsigned long long)ref[y*size+x]);
+	}
+    return errors;
+}
+
+    /*
+     *  Display lists started while rotated sort logical lines into bands, so
+     *  on a non-square screen they must cover the logical screen, not the
+     *  physical one
+     */
+
+static void screen_draw(pixel_t pixel0, pixel_t pixel1)
+{
+    u32 w = rotate_xres(), h = rotate_yres();
+    struct point points[3] = { { 0, h/2 }, { w/2, 0 }, { w/3, h } };
+
+    fill_rect(0, 0, w, h, pixel0);
+    draw_rect(0, 0, w, h, pixel1);
+    draw_line(0, 0, w-1, h-1, pixel1);
+    draw_line(w-1, 0, 0, h-1, pixel1);
+    fill_rect(w/2, h-h/4, w/2, h/4, pixel1);
+    fill_polygon(points, 3, FILL_EVEN_ODD, pixel1);
+}
+
+static u32 check_dlist(pixel_t *ref, u32 angle)
+{
+    pixel_t pixelmask = (1ULL << fb_var.bits_per_pixel)-1;
+    pixel_t pixel0 = lrand48() & pixelmask, pixel1 = ~pixel0 & pixelmask;
+    u32 x, y, errors = 0;
+    pixel_t pixel;
+
+    fill_rect(0, 0, fb_var.xres, fb_var.yres, fb_current->black_pixel);
+    rotate_init(angle);
+    screen_draw(pixel0, pixel1);
+    rotate_cleanup();
+    for (y = 0; y < fb_var.yres; y++)
+	for (x = 0; x < fb_var.xres; x++)
+	    ref[y*fb_var.xres+x] = get_pixel(x, y);
+
+    fill_rect(0, 0, fb_var.xres, fb_var.yres, fb_current->black_pixel);
+    rotate_init(angle);
+    dlist_begin();
+    screen_draw(pixel0, pixel1);
+    dlist_end();
+    rotate_cleanup();
+    for (y = 0; y < fb_var.yres; y++)
+	for (x = 0; x < fb_var.xres; x++) {
+	    pixel = get_pixel(x, y);
+	    if (pixel != ref[y*fb_var.xres+x] && !errors++)
+		Message("Rotation %u: display list mismatch at (%u, %u): "
+			"0x%llx != 0x%llx\n", angle, x, y,
+			(unsigned long long)pixel,
+			(unsigned long long)ref[y*fb_var.xres+x]);
+	}
+    return errors;
+}
+
+static void draw_rotated(unsigned long n, void *data)
+{
+    while (n--)
+	draw_pixmap(0, 0, rotate_xres(), rotate_yres(), data);
+}
+
+static void draw_rotated_pixels(unsigned long n, void *data)
+{
+    u32 w = rotate_xres(), h = rotate_yres(), x, y;
+    const pixel_t *pixmap;
+
+    while (n--)
+	for (y = 0, pixmap = data; y < h; y++)
+	    for (x = 0; x < w; x++)
+		set_pixel(x, y, *pixmap++);
+}
+
+static enum test_res test024_func(void)
+{
+    u32 size = min(fb_var.xres, fb_var.yres), x, y, angle, errors = 0;
+    pixel_t pixelmask, *ref, *pixmap;
+    struct scene *scene;
+    double rate, pixels;
+
+    if (!(scene = malloc(sizeof(*scene))) ||
+	!(ref = malloc(size*size*sizeof(*ref))))
+	Fatal("Not enough memory\n");
+    scene_init(scene, size);
+
+    /* The unrotated scene, as seen in logical coordinates */
+    scene_draw(scene);
+    for (y = 0; y < size; y++)
+	for (x = 0; x < size; x++)
+	    ref[y*size+x] = get_pixel(x, y);
+
+    for (angle = FB_ROTATE_CW; angle <= FB_ROTATE_CCW; angle++)
+	errors += check_scene(scene, ref, angle);
+    free(ref);
+    free(scene);
+
+    if (!(pixmap = malloc(fb_var.xres*fb_var.yres*sizeof(*pixmap))))
+	Fatal("Not enough memory\n");
+    for (angle = FB_ROTATE_CW; angle <= FB_ROTATE_CCW; angle++)
+	errors += check_dlist(pixmap, angle);
+    if (errors) {
+	free(pixmap);
+	Message("%u pixels differ\n", errors);
+	return TEST_FAIL;
+    }
+
+    /* A full screen logical back buffer */
+    pixelmask = (1ULL << fb_var.bits_per_pixel)-1;
+    for (x = 0; x < fb_var.xres*fb_var.yres; x++)
+	pixmap[x] = lrand48() & pixelmask;
+    rotate_init(FB_ROTATE_CW);
+    if ((rate = benchmark(draw_rotated, pixmap)) >= 0 &&
+	(pixels = benchmark(draw_rotated_pixels, pixmap)) >= 0)
+	printf("Rotated pixmap: %.2f Mpixels/s (per pixel %.2f Mpixels/s, "
+	       "speedup %.2f)\n", rate*fb_var.xres*fb_var.yres/1e6,
+	       pixels*fb_var.xres*fb_var.yres/1e6, rate/pixels);
+    rotate_init(FB_ROTATE_UR);
+    free(pixmap);
+
+    wait_for_key(10);
+    return TEST_OK;
+}
+
+const struct test test024 = {
+    .name =	"test024",
+    .desc =	"Rotated drawing",
+    .visual =	VISUAL_GENERIC,
+    .func =	test024_func,
+};
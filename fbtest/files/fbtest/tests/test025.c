@@ -0,0 +1,99 @@
+
+/*
+ *  Test025
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "shadow.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+
+#define NUM_LINES	200
+
+    /*
+     *  Compare the shadow frame buffer with the real frame buffer, as mapped
+     *  by fb_map()
+     */
+
+static u32 check_flushed(void)
+{
+    const u8 *real = (u8 *)fb_current->map_addr+fb_current->map_offset;
+    u32 i, errors = 0;
+
+    shadow_flush();
+    for (i = 0; i < fb_fix.smem_len; i++)
+	if (fb_current->fb[i] != real[i] && !errors++)
+	    Message("Not flushed at offset %u (line %u)\n", i,
+		    i/fb_fix.line_length);
+    return errors;
+}
+
+    /*
+     *  Lines partially outside of the screen, which the clip layer accepts,
+     *  are flushed one at a time, so the dirty tiles of each must cover its
+     *  visible part
+     */
+
+static enum test_res test025_func(void)
+{
+    int w = fb_var.xres, h = fb_var.yres, own = !fb_current->shadow;
+    int lines[][4] = {
+	{ -10, 5, 100, 5 },
+	{ -40, 20, 100, 60 },
+	{ 5, -10, 5, 100 },
+	{ w+30, h-1, w/2, h/2 },
+	{ w/2, h+30, -30, h/2 },
+    };
+    u32 i, errors = 0;
+    pixel_t pixel = fb_current->white_pixel;
+    int *l;
+
+    if (own)
+	shadow_init();
+
+    fill_rect(0, 0, w, h, fb_current->black_pixel);
+    errors += check_flushed();
+    for (i = 0; i < NUM_LINES && !errors; i++) {
+	l = lines[i % (sizeof(lines)/sizeof(*lines))];
+	if (i >= sizeof(lines)/sizeof(*lines)) {
+	    l[0] = lrand48() % (2*w)-w/2;
+	    l[1] = lrand48() % (2*h)-h/2;
+	    l[2] = lrand48() % (2*w)-w/2;
+	    l[3] = lrand48() % (2*h)-h/2;
+	}
+	draw_line(l[0], l[1], l[2], l[3], pixel);
+	if ((errors = check_flushed()))
+	    Message("Line from (%d, %d) to (%d, %d)\n", l[0], l[1], l[2],
+		    l[3]);
+	pixel = pixel == fb_current->white_pixel ? fb_current->black_pixel
+						 : fb_current->white_pixel;
+    }
+
+    if (own)
+	shadow_cleanup();
+    if (errors) {
+	Message("%u bytes differ\n", errors);
+	return TEST_FAIL;
+    }
+
+    wait_for_key(10);
+    return TEST_OK;
+}
+
+const struct test test025 = {
+    .name =	"test025",
+    .desc =	"Shadow frame buffer flush",
+    .visual =	VISUAL_GENERIC,
+    .func =	test025_func,
+};
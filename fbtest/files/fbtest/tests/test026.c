@@ -0,0 +1,91 @@
+
+/*
+ *  Test026
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <stdlib.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "clip.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+
+#define NUM_LINES	500
+#define AREA_SIZE	64
+
+    /*
+     *  A clipped line must consist of the visible pixels of the whole line,
+     *  so the parts drawn using different clip rectangles join seamlessly
+     */
+
+static enum test_res test026_func(void)
+{
+    u32 w = min(fb_var.xres, (u32)AREA_SIZE);
+    u32 h = min(fb_var.yres, (u32)AREA_SIZE);
+    int x1, y1, x2, y2, cx, cy, cw, ch;
+    pixel_t pixel = fb_current->white_pixel, *ref;
+    u32 i, x, y, errors = 0;
+
+    if (!(ref = malloc(w*h*sizeof(*ref))))
+	Fatal("Not enough memory\n");
+
+    for (i = 0; i < NUM_LINES && !errors; i++) {
+	x1 = lrand48() % w;
+	y1 = lrand48() % h;
+	if (i & 1) {
+	    /* Short lines */
+	    x2 = min(max(x1+(int)(lrand48() % 7)-3, 0), (int)w-1);
+	    y2 = min(max(y1+(int)(lrand48() % 7)-3, 0), (int)h-1);
+	} else {
+	    x2 = lrand48() % w;
+	    y2 = lrand48() % h;
+	}
+	cw = 1+lrand48() % w;
+	ch = 1+lrand48() % h;
+	cx = lrand48() % (w-cw+1);
+	cy = lrand48() % (h-ch+1);
+
+	/* The whole line, masked by the clip rectangle */
+	fill_rect(0, 0, w, h, fb_current->black_pixel);
+	generic_draw_line(x1, y1, x2, y2, pixel);
+	for (y = 0; y < h; y++)
+	    for (x = 0; x < w; x++)
+		ref[y*w+x] = (int)x >= cx && (int)x < cx+cw &&
+			     (int)y >= cy && (int)y < cy+ch
+			     ? get_pixel(x, y) : fb_current->black_pixel;
+
+	fill_rect(0, 0, w, h, fb_current->black_pixel);
+	clip_push(cx, cy, cw, ch);
+	draw_line(x1, y1, x2, y2, pixel);
+	clip_pop();
+	for (y = 0; y < h; y++)
+	    for (x = 0; x < w; x++)
+		if (get_pixel(x, y) != ref[y*w+x] && !errors++)
+		    Message("Line from (%d, %d) to (%d, %d), clipped to "
+			    "%dx%d at (%d, %d): mismatch at (%u, %u)\n", x1,
+			    y1, x2, y2, cw, ch, cx, cy, x, y);
+    }
+    free(ref);
+    if (errors) {
+	Message("%u pixels differ\n", errors);
+	return TEST_FAIL;
+    }
+
+    wait_for_key(10);
+    return TEST_OK;
+}
+
+const struct test test026 = {
+    .name =	"test026",
+    .desc =	"Clipped lines",
+    .visual =	VISUAL_GENERIC,
+    .func =	test026_func,
+};
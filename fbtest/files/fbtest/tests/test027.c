@@ -0,0 +1,172 @@
+
+/*
+ *  Test027
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <stdlib.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+
+#define NUM_SHAPES	64
+#define MAX_WIDTH	100
+#define MAX_HEIGHT	20
+#define BITMAP_PITCH	((MAX_WIDTH+7)/8)
+
+struct shape {
+    u32 x, y, a, b;
+    pixel_t pixel0, pixel1;
+};
+
+struct param {
+    struct shape lines[NUM_SHAPES], pixmaps[NUM_SHAPES], bitmaps[NUM_SHAPES];
+    pixel_t pixmap[MAX_WIDTH*MAX_HEIGHT], masked[MAX_WIDTH*MAX_HEIGHT];
+    u8 bitmap[MAX_HEIGHT*BITMAP_PITCH];
+    void (*line)(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel);
+    void (*pixmap_func)(u32 x, u32 y, u32 width, u32 height,
+			const pixel_t *pixmap);
+    void (*bitmap_func)(u32 x, u32 y, u32 width, u32 height, const u8 *data,
+			u32 pitch, pixel_t pixel0, pixel_t pixel1);
+    const pixel_t *pixmap_data;
+};
+
+static void draw_shapes(const struct param *param)
+{
+    const struct shape *s;
+    u32 i;
+
+    for (i = 0; i < NUM_SHAPES; i++) {
+	s = &param->lines[i];
+	param->line(s->x, s->y, s->a, s->b, s->pixel0);
+	s = &param->pixmaps[i];
+	param->pixmap_func(s->x, s->y, s->a, s->b, param->pixmap_data);
+	s = &param->bitmaps[i];
+	param->bitmap_func(s->x, s->y, s->a, s->b, param->bitmap,
+			   BITMAP_PITCH, s->pixel0, s->pixel1);
+    }
+}
+
+    /*
+     *  The installed operations, which may be specialized for the depth
+     */
+
+static void line(u32 x1, u32 y1, u32 x2, u32 y2, pixel_t pixel)
+{
+    draw_line(x1, y1, x2, y2, pixel);
+}
+
+static void pixmap(u32 x, u32 y, u32 width, u32 height,
+		   const pixel_t *pixmap)
+{
+    draw_pixmap(x, y, width, height, pixmap);
+}
+
+static void bitmap(u32 x, u32 y, u32 width, u32 height, const u8 *data,
+		   u32 pitch, pixel_t pixel0, pixel_t pixel1)
+{
+    expand_bitmap(x, y, width, height, data, pitch, pixel0, pixel1);
+}
+
+static void random_rect(struct shape *s, u32 w, u32 h, pixel_t pixelmask)
+{
+    s->a = 1+lrand48() % min(w, (u32)MAX_WIDTH);
+    s->b = 1+lrand48() % min(h, (u32)MAX_HEIGHT);
+    s->x = lrand48() % (w-s->a+1);
+    s->y = lrand48() % (h-s->b+1);
+    s->pixel0 = lrand48() & pixelmask;
+    s->pixel1 = lrand48() & pixelmask;
+}
+
+static pixel_t *read_screen(pixel_t *screen)
+{
+    u32 x, y;
+
+    for (y = 0; y < fb_var.yres; y++)
+	for (x = 0; x < fb_var.xres; x++)
+	    *screen++ = get_pixel(x, y);
+    return screen;
+}
+
+    /*
+     *  The native line, pixmap and bitmap operations, which batch pixels into
+     *  words at 1, 2 and 4 bpp, must draw the same pixels as the generic
+     *  ones. Pixmap values have stray bits above the depth, which must not
+     *  leak into neighbouring pixels.
+     */
+
+static enum test_res test027_func(void)
+{
+    u32 w = fb_var.xres, h = fb_var.yres, i, x, y, errors = 0;
+    pixel_t pixelmask, *screen, *p;
+    struct param *param;
+    struct shape *s;
+
+    if (!(param = malloc(sizeof(*param))) ||
+	!(screen = malloc(2*w*h*sizeof(*screen))))
+	Fatal("Not enough memory\n");
+
+    pixelmask = (1ULL << fb_var.bits_per_pixel)-1;
+    for (i = 0; i < NUM_SHAPES; i++) {
+	s = &param->lines[i];
+	s->x = lrand48() % w;
+	s->y = lrand48() % h;
+	s->a = lrand48() % w;
+	s->b = i & 1 ? s->y : lrand48() % h;
+	s->pixel0 = lrand48() & pixelmask;
+	random_rect(&param->pixmaps[i], w, h, pixelmask);
+	random_rect(&param->bitmaps[i], w, h, pixelmask);
+    }
+    for (i = 0; i < MAX_WIDTH*MAX_HEIGHT; i++) {
+	param->masked[i] = lrand48() & pixelmask;
+	param->pixmap[i] = param->masked[i] | (lrand48() & ~pixelmask);
+    }
+    for (i = 0; i < MAX_HEIGHT*BITMAP_PITCH; i++)
+	param->bitmap[i] = lrand48();
+
+    /* Compare with the results of the unspecialized generic routines */
+    param->line = line;
+    param->pixmap_func = pixmap;
+    param->bitmap_func = bitmap;
+    param->pixmap_data = param->pixmap;
+    fill_rect(0, 0, w, h, fb_current->black_pixel);
+    draw_shapes(param);
+    p = read_screen(screen);
+    param->line = generic_draw_line;
+    param->pixmap_func = generic_draw_pixmap;
+    param->bitmap_func = generic_expand_bitmap;
+    param->pixmap_data = param->masked;
+    fill_rect(0, 0, w, h, fb_current->black_pixel);
+    draw_shapes(param);
+    read_screen(p);
+    for (y = 0, i = 0; y < h; y++)
+	for (x = 0; x < w; x++, i++)
+	    if (screen[i] != p[i] && !errors++)
+		Message("Mismatch at (%u, %u): 0x%llx != 0x%llx\n", x, y,
+			(unsigned long long)screen[i],
+			(unsigned long long)p[i]);
+    free(screen);
+    free(param);
+    if (errors) {
+	Message("%u pixels differ\n", errors);
+	return TEST_FAIL;
+    }
+
+    wait_for_key(10);
+    return TEST_OK;
+}
+
+const struct test test027 = {
+    .name =	"test027",
+    .desc =	"Native lines, pixmaps and bitmaps",
+    .visual =	VISUAL_GENERIC,
+    .func =	test027_func,
+};
@@ -0,0 +1,210 @@
+
+/*
+ *  Test028
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <stdlib.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "visual.h"
+#include "test.h"
+#include "util.h"
+
+
+#define NUM_SHAPES	64
+
+    /*
+     *  Reference image, built one pixel at a time. Each shape also records the
+     *  leftmost and rightmost pixel of its outline on every line, so it can be
+     *  filled afterwards.
+     */
+
+struct ref {
+    u32 w, h;
+    u8 *image;
+    int *left, *right;
+};
+
+static void ref_plot(struct ref *ref, int x, int y)
+{
+    ref->image[y*ref->w+x] = 1;
+    if (x < ref->left[y])
+	ref->left[y] = x;
+    if (x > ref->right[y])
+	ref->right[y] = x;
+}
+
+static void ref_points(struct ref *ref, int cx, int cy, int x, int y)
+{
+    ref_plot(ref, cx-x, cy-y);
+    ref_plot(ref, cx+x, cy-y);
+    ref_plot(ref, cx-x, cy+y);
+    ref_plot(ref, cx+x, cy+y);
+}
+
+    /*
+     *  The midpoint circle and the Bresenham ellipse, plotting all symmetric
+     *  points of every step
+     */
+
+static void ref_circle(struct ref *ref, int cx, int cy, int r)
+{
+    int x = 0, y = r, d = 1-r;
+
+    while (x <= y) {
+	ref_points(ref, cx, cy, x, y);
+	ref_points(ref, cx, cy, y, x);
+	if (d < 0)
+	    d += 2*x+3;
+	else {
+	    d += 2*(x-y)+5;
+	    y--;
+	}
+	x++;
+    }
+}
+
+static void ref_ellipse_quadrant(struct ref *ref, int cx, int cy, int a, int b,
+				 int swap)
+{
+    int a2 = a*a, b2 = b*b, x = 0, y = b;
+    int S = a2*(1-2*b)+2*b2;
+    int T = b2-2*a2*(2*b-1);
+    int dT1 = 4*b2;
+    int dS1 = dT1+2*b2;
+    int dS2 = -4*a2*(b-1);
+    int dT2 = dS2+2*a2;
+
+    while (1) {
+	if (swap)
+	    ref_points(ref, cx, cy, y, x);
+	else
+	    ref_points(ref, cx, cy, x, y);
+	if (y <= 0)
+	    break;
+	if (S < 0) {
+	    S += dS1;
+	    T += dT1;
+	    dS1 += 4*b2;
+	    dT1 += 4*b2;
+	    x++;
+	} else if (T < 0) {
+	    S += dS1+dS2;
+	    T += dT1+dT2;
+	    dS1 += 4*b2;
+	    dT1 += 4*b2;
+	    dS2 += 4*a2;
+	    dT2 += 4*a2;
+	    x++;
+	    y--;
+	} else {
+	    S += dS2;
+	    T += dT2;
+	    dS2 += 4*a2;
+	    dT2 += 4*a2;
+	    y--;
+	}
+    }
+}
+
+static void ref_ellipse(struct ref *ref, int cx, int cy, int a, int b)
+{
+    if (a == b)
+	ref_circle(ref, cx, cy, a);
+    else if (a < b)
+	ref_ellipse_quadrant(ref, cx, cy, a, b, 0);
+    else
+	ref_ellipse_quadrant(ref, cx, cy, b, a, 1);
+}
+
+static void ref_next(struct ref *ref, int fill)
+{
+    u32 y;
+    int x;
+
+    for (y = 0; y < ref->h; y++) {
+	if (fill)
+	    for (x = ref->left[y]; x <= ref->right[y]; x++)
+		ref->image[y*ref->w+x] = 1;
+	ref->left[y] = ref->w;
+	ref->right[y] = -1;
+    }
+}
+
+    /*
+     *  Circles and ellipses, outlined and filled, must match the reference,
+     *  including the degenerate cases of radius 0, which used to hang
+     */
+
+static enum test_res test028_func(void)
+{
+    u32 w = fb_var.xres, h = fb_var.yres, r = min(w, h)/2;
+    u32 i, x, y, cx, cy, a, b, errors = 0;
+    pixel_t pixel = fb_current->black_pixel ^ 1;
+    struct ref ref;
+
+    ref.w = w;
+    ref.h = h;
+    if (!(ref.image = calloc(w*h, 1)) ||
+	!(ref.left = malloc(h*sizeof(*ref.left))) ||
+	!(ref.right = malloc(h*sizeof(*ref.right))))
+	Fatal("Not enough memory\n");
+    ref_next(&ref, 0);
+
+    fill_rect(0, 0, w, h, fb_current->black_pixel);
+    for (i = 0; i < NUM_SHAPES; i++) {
+	/* The first shapes have a zero radius or semi-axis */
+	a = i < 2 || i == 6 ? 0 : lrand48() % r;
+	b = i % 4 < 2 ? a : i == 3 || i == 7 ? 0 : lrand48() % r;
+	cx = max(a, b)+lrand48() % (w-2*max(a, b));
+	cy = max(a, b)+lrand48() % (h-2*max(a, b));
+	switch (i % 4) {
+	    case 0:
+		draw_circle(cx, cy, a, pixel);
+		ref_circle(&ref, cx, cy, a);
+		break;
+	    case 1:
+		fill_circle(cx, cy, a, pixel);
+		ref_circle(&ref, cx, cy, a);
+		break;
+	    case 2:
+		draw_ellipse(cx, cy, a, b, pixel);
+		ref_ellipse(&ref, cx, cy, a, b);
+		break;
+	    case 3:
+		fill_ellipse(cx, cy, a, b, pixel);
+		ref_ellipse(&ref, cx, cy, a, b);
+		break;
+	}
+	ref_next(&ref, i & 1);
+    }
+
+    for (y = 0, i = 0; y < h; y++)
+	for (x = 0; x < w; x++, i++)
+	    if ((get_pixel(x, y) != fb_current->black_pixel) != ref.image[i] &&
+		!errors++)
+		Message("Mismatch at (%u, %u)\n", x, y);
+    free(ref.right);
+    free(ref.left);
+    free(ref.image);
+    if (errors) {
+	Message("%u pixels differ\n", errors);
+	return TEST_FAIL;
+    }
+
+    wait_for_key(10);
+    return TEST_OK;
+}
+
+const struct test test028 = {
+    .name =	"test028",
+    .desc =	"Circles and ellipses against a reference",
+    .visual =	VISUAL_GENERIC,
+    .func =	test028_func,
+};
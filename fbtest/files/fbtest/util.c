@@ -21,6 +21,8 @@
 #include "types.h"
 #include "fb.h"
 #include "util.h"
+#include "shadow.h"
+#include "dlist.h"
 
 
 #define TXT_MESSAGE	TXT_GREEN
@@ -37,9 +39,13 @@
 static void PrintMessage(const char *prefix, const char *fmt, va_list ap)
 {
     fflush(stdout);
+    flockfile(stderr);
     fputs(prefix, stderr);
+    if (Opt_NumFbdev > 1 && fb_current)
+	fprintf(stderr, "%s: ", fb_current->dev);
     vfprintf(stderr, fmt, ap);
     fputs(TXT_NORMAL, stderr);
+    funlockfile(stderr);
 }
 
 
@@ -125,6 +131,8 @@ void Fatal(const char *fmt, ...)
 
 void wait_for_key(int timeout)
 {
+    dlist_submit();
+    shadow_flush();
     /* FIXME: no keypress handling yet */
     sleep(2);
 }
@@ -138,6 +146,8 @@ void wait_ms(int ms)
 {
     struct timespec req;
 
+    dlist_submit();
+    shadow_flush();
     req.tv_sec = ms/1000;
     req.tv_nsec = (ms % 1000)*1000000;
     nanosleep(&req, NULL);
@@ -145,26 +155,33 @@ void wait_ms(int ms)
 
 
     /*
-     *  Benchmark a routine
+     *  Time stamp in microseconds
      */
 
-static uint64_t get_ticks(void)
+u64 get_ticks(void)
 {
     struct timeval tv;
 
     gettimeofday(&tv, NULL);
-    return (uint64_t)tv.tv_sec*1000000 + tv.tv_usec;
+    return (u64)tv.tv_sec*1000000 + tv.tv_usec;
 }
 
+
+    /*
+     *  Benchmark a routine
+     */
+
 double benchmark(void (*func)(unsigned long n, void *data), void *data)
 {
-    uint64_t ticks;
+    u64 ticks;
     unsigned long n = 1;
 
     printf("Benchmarking... ");
     while (n <<= 1) {
 	ticks = get_ticks();
 	func(n, data);
+	dlist_submit();
+	shadow_flush();
 	ticks = get_ticks() - ticks;
 	if (ticks >= 500000)
 	    break;
@@ -0,0 +1,679 @@
+/*
+ *  Virtual frame buffer device
+ *
+ *  This emulates a frame buffer device in normal memory, so all drawing and
+ *  visual operations can be tested and benchmarked on a host without a
+ *  display.
+ *
+ *  The device is selected using `-f vfb[:option,option,...]', with options:
+ *
+ *    <xres>x<yres>[-<bpp>]	Visible resolution and depth
+ *    xres=, yres=, bpp=	Same as above
+ *    vxres=, vyres=		Virtual resolution
+ *    type=			packed, planes, ilbm, or iplan2
+ *    visual=			mono01, mono10, truecolor, pseudocolor,
+ *				static_pseudocolor, or directcolor
+ *    grayscale			Grayscale instead of color
+ *    red=, green=, blue=,	Color bitfield as <length>@<offset>
+ *    transp=
+ *    pad=			Line length alignment (in bytes)
+ *    line_length=		Explicit line length (in bytes)
+ *    xpanstep=, ypanstep=,	Panning and wrapping capabilities
+ *    ywrapstep=
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "types.h"
+#include "fb.h"
+#include "util.h"
+
+
+#define VFB_NAME		"vfb"
+
+#define VFB_DEFAULT_XRES	640
+#define VFB_DEFAULT_YRES	480
+#define VFB_DEFAULT_BPP		8
+#define VFB_DEFAULT_REFRESH	60
+
+    /*
+     *  Device state, per frame buffer context
+     */
+
+struct vfb {
+    struct fb_var_screeninfo var;
+    struct fb_fix_screeninfo fix;
+    u32 pad, line_length;
+    void *mem;
+    u32 mem_len;
+    u16 *red, *green, *blue, *transp;
+    u32 cmap_len;
+};
+
+#define VFB		((struct vfb *)fb_current->devpriv)
+
+#define vfb_var		(VFB->var)
+#define vfb_fix		(VFB->fix)
+#define vfb_pad		(VFB->pad)
+#define vfb_line_length	(VFB->line_length)
+#define vfb_mem		(VFB->mem)
+#define vfb_mem_len	(VFB->mem_len)
+#define vfb_red		(VFB->red)
+#define vfb_green	(VFB->green)
+#define vfb_blue	(VFB->blue)
+#define vfb_transp	(VFB->transp)
+#define vfb_cmap_len	(VFB->cmap_len)
+
+
+    /*
+     *  Default color bitfields for truecolor and directcolor
+     */
+
+static void vfb_default_bitfields(void)
+{
+    struct fb_var_screeninfo *var = &vfb_var;
+
+    switch (var->bits_per_pixel) {
+	case 15:
+	    var->red.offset = 10;	var->red.length = 5;
+	    var->green.offset = 5;	var->green.length = 5;
+	    var->blue.offset = 0;	var->blue.length = 5;
+	    break;
+
+	case 16:
+	    var->red.offset = 11;	var->red.length = 5;
+	    var->green.offset = 5;	var->green.length = 6;
+	    var->blue.offset = 0;	var->blue.length = 5;
+	    break;
+
+	case 24:
+	case 32:
+	    var->red.offset = 16;	var->red.length = 8;
+	    var->green.offset = 8;	var->green.length = 8;
+	    var->blue.offset = 0;	var->blue.length = 8;
+	    break;
+
+	default:
+	    /* Same layout as pseudocolor: all components are the index */
+	    var->red.length = var->bits_per_pixel;
+	    var->green.length = var->bits_per_pixel;
+	    var->blue.length = var->bits_per_pixel;
+	    break;
+    }
+}
+
+
+    /*
+     *  Parse the device options
+     */
+
+static void vfb_parse_bitfield(const char *opt, const char *val,
+			       struct fb_bitfield *bf)
+{
+    if (sscanf(val, "%u@%u", &bf->length, &bf->offset) != 2)
+	Fatal("vfb: Invalid bitfield %s=%s\n", opt, val);
+}
+
+static u32 vfb_parse_u32(const char *opt, const char *val)
+{
+    char *end;
+    unsigned long x;
+
+    x = strtoul(val, &end, 0);
+    if (!*val || *end)
+	Fatal("vfb: Invalid value %s=%s\n", opt, val);
+    return x;
+}
+
+static const struct {
+    const char *name;
+    u32 type, type_aux;
+} vfb_types[] = {
+    { "packed", FB_TYPE_PACKED_PIXELS, 0 },
+    { "planes", FB_TYPE_PLANES, 0 },
+    { "ilbm", FB_TYPE_INTERLEAVED_PLANES, 0 },
+    { "iplan2", FB_TYPE_INTERLEAVED_PLANES, 2 },
+};
+
+static const struct {
+    const char *name;
+    u32 visual;
+} vfb_visuals[] = {
+    { "mono01", FB_VISUAL_MONO01 },
+    { "mono10", FB_VISUAL_MONO10 },
+    { "truecolor", FB_VISUAL_TRUECOLOR },
+    { "pseudocolor", FB_VISUAL_PSEUDOCOLOR },
+    { "static_pseudocolor", FB_VISUAL_STATIC_PSEUDOCOLOR },
+    { "directcolor", FB_VISUAL_DIRECTCOLOR },
+};
+
+#define ARRAY_SIZE(a)	(sizeof(a)/sizeof(*(a)))
+
+static void vfb_parse_option(char *opt, int *visual_set, int *bitfields_set)
+{
+    struct fb_var_screeninfo *var = &vfb_var;
+    char *val;
+    unsigned int i;
+
+    if (sscanf(opt, "%ux%u-%u", &var->xres, &var->yres,
+	       &var->bits_per_pixel) >= 2)
+	return;
+
+    val = strchr(opt, '=');
+    if (val)
+	*val++ = '\0';
+
+    if (!strcmp(opt, "grayscale")) {
+	var->grayscale = 1;
+	return;
+    }
+    if (!val)
+	Fatal("vfb: Unknown option %s\n", opt);
+
+    if (!strcmp(opt, "xres"))
+	var->xres = vfb_parse_u32(opt, val);
+    else if (!strcmp(opt, "yres"))
+	var->yres = vfb_parse_u32(opt, val);
+    else if (!strcmp(opt, "vxres"))
+	var->xres_virtual = vfb_parse_u32(opt, val);
+    else if (!strcmp(opt, "vyres"))
+	var->yres_virtual = vfb_parse_u32(opt, val);
+    else if (!strcmp(opt, "bpp"))
+	var->bits_per_pixel = vfb_parse_u32(opt, val);
+    else if (!strcmp(opt, "pad"))
+	vfb_pad = vfb_parse_u32(opt, val);
+    else if (!strcmp(opt, "line_length"))
+	vfb_line_length = vfb_parse_u32(opt, val);
+    else if (!strcmp(opt, "xpanstep"))
+	vfb_fix.xpanstep = vfb_parse_u32(opt, val);
+    else if (!strcmp(opt, "ypanstep"))
+	vfb_fix.ypanstep = vfb_parse_u32(opt, val);
+    else if (!strcmp(opt, "ywrapstep"))
+	vfb_fix.ywrapstep = vfb_parse_u32(opt, val);
+    else if (!strcmp(opt, "red")) {
+	vfb_parse_bitfield(opt, val, &var->red);
+	*bitfields_set = 1;
+    } else if (!strcmp(opt, "green")) {
+	vfb_parse_bitfield(opt, val, &var->green);
+	*bitfields_set = 1;
+    } else if (!strcmp(opt, "blue")) {
+	vfb_parse_bitfield(opt, val, &var->blue);
+	*bitfields_set = 1;
+    } else if (!strcmp(opt, "transp")) {
+	vfb_parse_bitfield(opt, val, &var->transp);
+	*bitfields_set = 1;
+    } else if (!strcmp(opt, "type")) {
+	for (i = 0; i < ARRAY_SIZE(vfb_types); i++)
+	    if (!strcmp(val, vfb_types[i].name))
+		break;
+	if (i == ARRAY_SIZE(vfb_types))
+	    Fatal("vfb: Unknown type %s\n", val);
+	vfb_fix.type = vfb_types[i].type;
+	vfb_fix.type_aux = vfb_types[i].type_aux;
+    } else if (!strcmp(opt, "visual")) {
+	for (i = 0; i < ARRAY_SIZE(vfb_visuals); i++)
+	    if (!strcmp(val, vfb_visuals[i].name))
+		break;
+	if (i == ARRAY_SIZE(vfb_visuals))
+	    Fatal("vfb: Unknown visual %s\n", val);
+	vfb_fix.visual = vfb_visuals[i].visual;
+	*visual_set = 1;
+    } else
+	Fatal("vfb: Unknown option %s\n", opt);
+}
+
+
+    /*
+     *  Calculate the memory layout for a given mode
+     *
+     *  For interleaved bitplanes, line_length and type_aux are the length of
+     *  one plane in a line (except for iplan2, where type_aux is the
+     *  interleave in bytes and line_length covers all planes)
+     */
+
+static int vfb_layout(const struct fb_var_screeninfo *var,
+		      struct fb_fix_screeninfo *fix, u32 *size)
+{
+    u32 bpp = var->bits_per_pixel;
+    u32 pad = vfb_pad ? vfb_pad : 1;
+    u32 len, min_len;
+
+    if (!bpp || bpp > 32)
+	return -1;
+
+    switch (fix->type) {
+	case FB_TYPE_PACKED_PIXELS:
+	    min_len = (var->xres_virtual*bpp+7)/8;
+	    break;
+
+	case FB_TYPE_PLANES:
+	    min_len = (var->xres_virtual+7)/8;
+	    break;
+
+	case FB_TYPE_INTERLEAVED_PLANES:
+	    if (fix->type_aux == 2) {
+		if (var->xres_virtual % 16)
+		    return -1;
+		min_len = var->xres_virtual/8*bpp;
+	    } else
+		min_len = (var->xres_virtual+7)/8;
+	    break;
+
+	default:
+	    return -1;
+    }
+
+    len = (min_len+pad-1)/pad*pad;
+    if (vfb_line_length) {
+	if (vfb_line_length < min_len)
+	    return -1;
+	len = vfb_line_length;
+    }
+
+    switch (fix->type) {
+	case FB_TYPE_PACKED_PIXELS:
+	    fix->line_length = len;
+	    *size = len*var->yres_virtual;
+	    break;
+
+	case FB_TYPE_PLANES:
+	    fix->line_length = len;
+	    *size = len*var->yres_virtual*bpp;
+	    break;
+
+	case FB_TYPE_INTERLEAVED_PLANES:
+	    if (fix->type_aux == 2) {
+		fix->line_length = len;
+		*size = len*var->yres_virtual;
+	    } else {
+		fix->type_aux = len;
+		fix->line_length = len;
+		*size = len*bpp*var->yres_virtual;
+	    }
+	    break;
+    }
+    return 0;
+}
+
+
+    /*
+     *  Colormap
+     */
+
+static int vfb_cmap_size(void)
+{
+    const struct fb_var_screeninfo *var = &vfb_var;
+
+    switch (vfb_fix.visual) {
+	case FB_VISUAL_PSEUDOCOLOR:
+	case FB_VISUAL_STATIC_PSEUDOCOLOR:
+	    return 1 << var->bits_per_pixel;
+
+	case FB_VISUAL_DIRECTCOLOR:
+	    return 1 << max(max(var->red.length, var->green.length),
+			    max(var->blue.length, var->transp.length));
+
+	default:
+	    return 0;
+    }
+}
+
+static u16 *vfb_alloc_component(u32 len)
+{
+    u16 *p;
+
+    if (!(p = calloc(len, sizeof(u16))))
+	Fatal("vfb: calloc %zu: %s\n", len*sizeof(u16), strerror(errno));
+    return p;
+}
+
+static int vfb_get_cmap(typeof(fb_cmap) *cmap)
+{
+    u32 n;
+
+    if (cmap->start >= vfb_cmap_len || cmap->len > vfb_cmap_len-cmap->start) {
+	errno = EINVAL;
+	return -1;
+    }
+    n = cmap->len*sizeof(u16);
+    memcpy(cmap->red, vfb_red+cmap->start, n);
+    memcpy(cmap->green, vfb_green+cmap->start, n);
+    memcpy(cmap->blue, vfb_blue+cmap->start, n);
+    if (cmap->transp)
+	memcpy(cmap->transp, vfb_transp+cmap->start, n);
+    return 0;
+}
+
+static int vfb_put_cmap(const typeof(fb_cmap) *cmap)
+{
+    u32 n;
+
+    if (vfb_fix.visual == FB_VISUAL_STATIC_PSEUDOCOLOR ||
+	cmap->start >= vfb_cmap_len || cmap->len > vfb_cmap_len-cmap->start) {
+	errno = EINVAL;
+	return -1;
+    }
+    n = cmap->len*sizeof(u16);
+    memcpy(vfb_red+cmap->start, cmap->red, n);
+    memcpy(vfb_green+cmap->start, cmap->green, n);
+    memcpy(vfb_blue+cmap->start, cmap->blue, n);
+    if (cmap->transp)
+	memcpy(vfb_transp+cmap->start, cmap->transp, n);
+    return 0;
+}
+
+
+    /*
+     *  Mode setting and panning
+     */
+
+static int vfb_check_pan(const struct fb_var_screeninfo *var)
+{
+    const struct fb_var_screeninfo *cur = &vfb_var;
+
+    if (var->vmode & FB_VMODE_YWRAP) {
+	if (!vfb_fix.ywrapstep || var->yoffset % vfb_fix.ywrapstep ||
+	    var->yoffset >= cur->yres_virtual ||
+	    var->xoffset)
+	    return -1;
+    } else {
+	if (var->xoffset+cur->xres > cur->xres_virtual ||
+	    var->yoffset+cur->yres > cur->yres_virtual)
+	    return -1;
+	if ((var->xoffset &&
+	     (!vfb_fix.xpanstep || var->xoffset % vfb_fix.xpanstep)) ||
+	    (var->yoffset &&
+	     (!vfb_fix.ypanstep || var->yoffset % vfb_fix.ypanstep)))
+	    return -1;
+    }
+    return 0;
+}
+
+static int vfb_pan_display(const struct fb_var_screeninfo *var)
+{
+    if (vfb_check_pan(var)) {
+	errno = EINVAL;
+	return -1;
+    }
+    vfb_var.xoffset = var->xoffset;
+    vfb_var.yoffset = var->yoffset;
+    if (var->vmode & FB_VMODE_YWRAP)
+	vfb_var.vmode |= FB_VMODE_YWRAP;
+    else
+	vfb_var.vmode &= ~FB_VMODE_YWRAP;
+    return 0;
+}
+
+static int vfb_set_var(struct fb_var_screeninfo *var)
+{
+    struct fb_fix_screeninfo fix = vfb_fix;
+    struct fb_var_screeninfo old = vfb_var;
+    u32 size;
+
+    /* The pixel format is fixed at open time */
+    if (var->bits_per_pixel != vfb_var.bits_per_pixel ||
+	var->grayscale != vfb_var.grayscale ||
+	memcmp(&var->red, &vfb_var.red, sizeof(var->red)) ||
+	memcmp(&var->green, &vfb_var.green, sizeof(var->green)) ||
+	memcmp(&var->blue, &vfb_var.blue, sizeof(var->blue)) ||
+	memcmp(&var->transp, &vfb_var.transp, sizeof(var->transp)) ||
+	var->nonstd) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    if (!var->xres || !var->yres) {
+	errno = EINVAL;
+	return -1;
+    }
+    if (var->xres_virtual < var->xres)
+	var->xres_virtual = var->xres;
+    if (var->yres_virtual < var->yres)
+	var->yres_virtual = var->yres;
+    if (vfb_layout(var, &fix, &size) || size > vfb_mem_len) {
+	errno = EINVAL;
+	return -1;
+    }
+
+    if ((var->activate & FB_ACTIVATE_MASK) == FB_ACTIVATE_TEST)
+	return 0;
+
+    vfb_var = *var;
+    vfb_var.xoffset = old.xoffset;
+    vfb_var.yoffset = old.yoffset;
+    vfb_var.vmode = (vfb_var.vmode & ~FB_VMODE_YWRAP) |
+		    (old.vmode & FB_VMODE_YWRAP);
+    if (vfb_pan_display(var)) {
+	vfb_var = old;
+	errno = EINVAL;
+	return -1;
+    }
+    vfb_var.activate = FB_ACTIVATE_NOW;
+    vfb_fix = fix;
+    *var = vfb_var;
+    return 0;
+}
+
+
+    /*
+     *  Vertical blank emulation
+     *
+     *  The refresh rate follows from the video timings if present
+     */
+
+static u64 vfb_frame_nsecs(void)
+{
+    const struct fb_var_screeninfo *var = &vfb_var;
+    u64 htotal, vtotal, nsecs;
+
+    htotal = var->xres+var->left_margin+var->right_margin+var->hsync_len;
+    vtotal = var->yres+var->upper_margin+var->lower_margin+var->vsync_len;
+    nsecs = (u64)var->pixclock*htotal*vtotal/1000;
+    /* No timings, or too short to wait for */
+    if (!nsecs)
+	return 1000000000/VFB_DEFAULT_REFRESH;
+    return nsecs;
+}
+
+static int vfb_wait_for_vsync(void)
+{
+    struct timespec ts;
+    u64 now, period;
+
+    period = vfb_frame_nsecs();
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (u64)ts.tv_sec*1000000000+ts.tv_nsec;
+    now = (now/period+1)*period;
+    ts.tv_sec = now/1000000000;
+    ts.tv_nsec = now % 1000000000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+	   EINTR);
+    return 0;
+}
+
+
+    /*
+     *  Backend operations
+     */
+
+static int vfb_probe(const char *dev)
+{
+    size_t n = strlen(VFB_NAME);
+
+    return !strncmp(dev, VFB_NAME, n) && (!dev[n] || dev[n] == ':');
+}
+
+static int vfb_open(const char *dev)
+{
+    struct fb_var_screeninfo *var;
+    int visual_set = 0, bitfields_set = 0;
+    char *options, *opt, *next;
+    u32 size;
+
+    if (!(fb_current->devpriv = calloc(1, sizeof(struct vfb))))
+	return -1;
+    var = &vfb_var;
+    var->xres = VFB_DEFAULT_XRES;
+    var->yres = VFB_DEFAULT_YRES;
+    var->bits_per_pixel = VFB_DEFAULT_BPP;
+    vfb_fix.type = FB_TYPE_PACKED_PIXELS;
+
+    dev += strlen(VFB_NAME);
+    if (*dev == ':') {
+	if (!(options = strdup(dev+1)))
+	    goto fail;
+	for (opt = options; opt; opt = next) {
+	    if ((next = strchr(opt, ',')))
+		*next++ = '\0';
+	    if (*opt)
+		vfb_parse_option(opt, &visual_set, &bitfields_set);
+	}
+	free(options);
+    }
+
+    if (var->xres_virtual < var->xres)
+	var->xres_virtual = var->xres;
+    if (var->yres_virtual < var->yres)
+	var->yres_virtual = var->yres;
+
+    if (!visual_set) {
+	if (var->bits_per_pixel == 1)
+	    vfb_fix.visual = FB_VISUAL_MONO10;
+	else if (var->bits_per_pixel <= 8 ||
+		 vfb_fix.type != FB_TYPE_PACKED_PIXELS)
+	    vfb_fix.visual = FB_VISUAL_PSEUDOCOLOR;
+	else
+	    vfb_fix.visual = FB_VISUAL_TRUECOLOR;
+    }
+    if (!bitfields_set) {
+	if (vfb_fix.visual == FB_VISUAL_TRUECOLOR ||
+	    vfb_fix.visual == FB_VISUAL_DIRECTCOLOR)
+	    vfb_default_bitfields();
+	else if (vfb_fix.visual != FB_VISUAL_MONO01 &&
+		 vfb_fix.visual != FB_VISUAL_MONO10) {
+	    var->red.length = var->bits_per_pixel;
+	    var->green.length = var->bits_per_pixel;
+	    var->blue.length = var->bits_per_pixel;
+	}
+    }
+
+    if (vfb_layout(var, &vfb_fix, &size))
+	Fatal("vfb: Unsupported mode %ux%u-%u (virtual %ux%u)\n", var->xres,
+	      var->yres, var->bits_per_pixel, var->xres_virtual,
+	      var->yres_virtual);
+
+    strncpy(vfb_fix.id, "Virtual FB", sizeof(vfb_fix.id));
+    vfb_fix.smem_len = size;
+    vfb_fix.accel = FB_ACCEL_NONE;
+    var->activate = FB_ACTIVATE_NOW;
+    var->height = var->width = -1;
+
+    /* Page-aligned and zero-filled, like the real thing */
+    vfb_mem_len = size;
+    vfb_mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (vfb_mem == MAP_FAILED) {
+	vfb_mem = NULL;
+	goto fail;
+    }
+
+    vfb_cmap_len = vfb_cmap_size();
+    if (vfb_cmap_len) {
+	vfb_red = vfb_alloc_component(vfb_cmap_len);
+	vfb_green = vfb_alloc_component(vfb_cmap_len);
+	vfb_blue = vfb_alloc_component(vfb_cmap_len);
+	vfb_transp = vfb_alloc_component(vfb_cmap_len);
+    }
+
+    Message("vfb: %ux%u-%u (virtual %ux%u), line_length %u, smem_len %u\n",
+	    var->xres, var->yres, var->bits_per_pixel, var->xres_virtual,
+	    var->yres_virtual, vfb_fix.line_length, vfb_fix.smem_len);
+    return 0;
+
+fail:
+    free(fb_current->devpriv);
+    fb_current->devpriv = NULL;
+    return -1;
+}
+
+static void vfb_close(void)
+{
+    if (vfb_mem)
+	munmap(vfb_mem, vfb_mem_len);
+    free(vfb_red);
+    free(vfb_green);
+    free(vfb_blue);
+    free(vfb_transp);
+    free(fb_current->devpriv);
+    fb_current->devpriv = NULL;
+}
+
+static int vfb_ioctl(unsigned long request, void *arg)
+{
+    switch (request) {
+	case FBIOGET_VSCREENINFO:
+	    *(struct fb_var_screeninfo *)arg = vfb_var;
+	    return 0;
+
+	case FBIOPUT_VSCREENINFO:
+	    return vfb_set_var(arg);
+
+	case FBIOGET_FSCREENINFO:
+	    *(struct fb_fix_screeninfo *)arg = vfb_fix;
+	    return 0;
+
+	case FBIOGETCMAP:
+	    return vfb_get_cmap(arg);
+
+	case FBIOPUTCMAP:
+	    return vfb_put_cmap(arg);
+
+	case FBIOPAN_DISPLAY:
+	    return vfb_pan_display(arg);
+
+	case FBIOBLANK:
+	    return 0;
+
+	case FBIO_WAITFORVSYNC:
+	    return vfb_wait_for_vsync();
+
+	default:
+	    errno = ENOTTY;
+	    return -1;
+    }
+}
+
+static void *vfb_mmap(u32 len)
+{
+    if (len > ((vfb_mem_len+getpagesize()-1) & ~(getpagesize()-1))) {
+	errno = EINVAL;
+	return MAP_FAILED;
+    }
+    return vfb_mem;
+}
+
+static int vfb_munmap(void *addr, u32 len)
+{
+    return 0;
+}
+
+const struct devops vfb_devops = {
+    .name =	"vfb (virtual frame buffer device)",
+    .probe =	vfb_probe,
+    .open =	vfb_open,
+    .close =	vfb_close,
+    .ioctl =	vfb_ioctl,
+    .mmap =	vfb_mmap,
+    .munmap =	vfb_munmap,
+};
@@ -12,16 +12,13 @@
 #include <stdlib.h>
 
 #include "types.h"
+#include "fb.h"
 #include "visual.h"
 #include "visops.h"
-#include "fb.h"
 #include "color.h"
 #include "clut.h"
 #include "util.h"
 
-
-static u32 cmap_len;
-
 static void directcolor_update_cmap(void);
 
 
@@ -31,6 +28,7 @@ static void directcolor_update_cmap(void);
 
 static int directcolor_init(void)
 {
+    struct fb_context *ctx = fb_current;
     u32 minbflen, maxbflen, i;
     pixel_t *table;
     pixel_t pixel;
@@ -46,36 +44,35 @@ static int directcolor_init(void)
 		   fb_var.blue.length);
     maxbflen = max(max(fb_var.red.length, fb_var.green.length),
 		   max(fb_var.blue.length, fb_var.transp.length));
-    idx_bits = minbflen;
-    idx_len = 1<<idx_bits;
-    table = malloc(idx_len*sizeof(pixel_t));
-    for (i = 0; i < idx_len; i++) {
+    ctx->idx_bits = minbflen;
+    ctx->idx_len = 1<<ctx->idx_bits;
+    table = malloc(ctx->idx_len*sizeof(pixel_t));
+    for (i = 0; i < ctx->idx_len; i++) {
 	pixel = rgb_pixel(i, i, i);
 	table[i] = pixel;
     }
-    idx_pixel = table;
+    ctx->idx_pixel = table;
 
     /* Grayscale */
-    gray_bits = idx_bits;
-    gray_len = idx_len;
-    gray_pixel = table;
+    ctx->gray_bits = ctx->idx_bits;
+    ctx->gray_len = ctx->idx_len;
+    ctx->gray_pixel = table;
 
     /* Monochrome */
-    black_pixel = idx_pixel[0];
-    white_pixel = idx_pixel[1];
+    ctx->black_pixel = ctx->idx_pixel[0];
+    ctx->white_pixel = ctx->idx_pixel[1];
 
     /* Directcolor */
-    cmap_len = 1<<maxbflen;
-    clut = malloc(cmap_len*sizeof(rgba_t));
+    ctx->clut = malloc((1<<maxbflen)*sizeof(rgba_t));
 
     Message("Available visuals:\n");
     Message("  Monochrome\n");
-    Message("  Grayscale %d\n", gray_len);
-    Message("  Pseudocolor %d\n", idx_len);
-    Message("  Truecolor %d:%d:%d:%d\n", red_bits, green_bits, blue_bits,
-	    alpha_bits);
-    Message("  Directcolor %d:%d:%d:%d\n", red_bits, green_bits, blue_bits,
-	    alpha_bits);
+    Message("  Grayscale %d\n", ctx->gray_len);
+    Message("  Pseudocolor %d\n", ctx->idx_len);
+    Message("  Truecolor %d:%d:%d:%d\n", ctx->red_bits, ctx->green_bits,
+	    ctx->blue_bits, ctx->alpha_bits);
+    Message("  Directcolor %d:%d:%d:%d\n", ctx->red_bits, ctx->green_bits,
+	    ctx->blue_bits, ctx->alpha_bits);
 
     return 1;
 }
@@ -87,8 +84,12 @@ static int directcolor_init(void)
 
 static void directcolor_set_mono(void)
 {
-    clut[0].r = clut[0].g = clut[0].b = 0x0000; clut[0].a = 0xffff;
-    clut[1].r = clut[1].g = clut[1].b = 0xffff; clut[1].a = 0xffff;
+    struct fb_context *ctx = fb_current;
+
+    ctx->clut[0].r = ctx->clut[0].g = ctx->clut[0].b = 0x0000;
+    ctx->clut[0].a = 0xffff;
+    ctx->clut[1].r = ctx->clut[1].g = ctx->clut[1].b = 0xffff;
+    ctx->clut[1].a = 0xffff;
     directcolor_update_cmap();
 }
 
@@ -99,7 +100,7 @@ static void directcolor_set_mono(void)
 
 static void directcolor_set_linear(void)
 {
-    clut_create_linear(clut, idx_len);
+    clut_create_linear(fb_current->clut, fb_current->idx_len);
     directcolor_update_cmap();
 }
 
@@ -138,17 +139,18 @@ static int directcolor_set_visual(enum visual_id id)
 
 static void directcolor_update_cmap(void)
 {
+    struct fb_context *ctx = fb_current;
     u32 i;
 
-    for (i = 0; i < cmap_len; i++) {
-	if (i < red_len)
-	    fb_cmap.red[i] = clut[i].r;
-	if (i < green_len)
-	    fb_cmap.green[i] = clut[i].g;
-	if (i < blue_len)
-	    fb_cmap.blue[i] = clut[i].b;
-	if (fb_cmap.transp && i < alpha_len)
-	    fb_cmap.transp[i] = clut[i].a;
+    for (i = 0; i < fb_cmap.len; i++) {
+	if (i < ctx->red_len)
+	    fb_cmap.red[i] = ctx->clut[i].r;
+	if (i < ctx->green_len)
+	    fb_cmap.green[i] = ctx->clut[i].g;
+	if (i < ctx->blue_len)
+	    fb_cmap.blue[i] = ctx->clut[i].b;
+	if (fb_cmap.transp && i < ctx->alpha_len)
+	    fb_cmap.transp[i] = ctx->clut[i].a;
     }
     fb_set_cmap();
 }
@@ -10,19 +10,23 @@
  */
 
 #include "types.h"
+#include "fb.h"
 #include "visual.h"
 #include "visops.h"
-#include "fb.h"
 #include "color.h"
 #include "util.h"
 
 
 void grayscale_create_tables(void)
 {
-    gray_bits = fb_var.bits_per_pixel;
-    gray_len = 1<<fb_var.bits_per_pixel;
-    gray_pixel = create_component_table(gray_len, fb_var.red.offset,
-					fb_var.red.msb_right, gray_bits);
+    struct fb_context *ctx = fb_current;
+
+    ctx->gray_bits = fb_var.bits_per_pixel;
+    ctx->gray_len = 1<<fb_var.bits_per_pixel;
+    ctx->gray_pixel = create_component_table(ctx->gray_len,
+					     fb_var.red.offset,
+					     fb_var.red.msb_right,
+					     ctx->gray_bits);
 }
 
 
@@ -32,6 +36,8 @@ void grayscale_create_tables(void)
 
 static int grayscale_init(void)
 {
+    struct fb_context *ctx = fb_current;
+
     if (fb_fix.visual != FB_VISUAL_TRUECOLOR || !fb_var.grayscale)
 	return 0;
 
@@ -39,12 +45,12 @@ static int grayscale_init(void)
     grayscale_create_tables();
 
     /* Monochrome */
-    black_pixel = gray_pixel[0];
-    white_pixel = gray_pixel[gray_len-1];
+    ctx->black_pixel = ctx->gray_pixel[0];
+    ctx->white_pixel = ctx->gray_pixel[ctx->gray_len-1];
 
     Message("Available visuals:\n");
     Message("  Monochrome\n");
-    Message("  Grayscale %d\n", gray_len);
+    Message("  Grayscale %d\n", ctx->gray_len);
 
     return 1;
 }
@@ -75,18 +81,19 @@ static int grayscale_set_visual(enum visual_id id)
 
 pixel_t grayscale_match_color(const rgba_t *color, rgba_t *error)
 {
+    struct fb_context *ctx = fb_current;
     rgba_t approx;
     u32 g;
 
-    g = CONVERT_RANGE(color->r+color->g+color->b, 3*65535, gray_len-1);
+    g = CONVERT_RANGE(color->r+color->g+color->b, 3*65535, ctx->gray_len-1);
     if (error) {
-	approx.r = EXPAND_TO_16BIT(g, gray_len-1);
-	approx.g = EXPAND_TO_16BIT(g, gray_len-1);
-	approx.b = EXPAND_TO_16BIT(g, gray_len-1);
+	approx.r = EXPAND_TO_16BIT(g, ctx->gray_len-1);
+	approx.g = EXPAND_TO_16BIT(g, ctx->gray_len-1);
+	approx.b = EXPAND_TO_16BIT(g, ctx->gray_len-1);
 	approx.a = 0xffff;
 	color_sub(error, color, &approx);
     }
-    return gray_pixel[g];
+    return ctx->gray_pixel[g];
 }
 
 
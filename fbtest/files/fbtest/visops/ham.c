@@ -10,9 +10,9 @@
  */
 
 #include "types.h"
+#include "fb.h"
 #include "visual.h"
 #include "visops.h"
-#include "fb.h"
 #include "util.h"
 
 
@@ -22,6 +22,8 @@
 
 static int ham_init(void)
 {
+    struct fb_context *ctx = fb_current;
+
     if (fb_fix.visual != FB_VISUAL_PSEUDOCOLOR || fb_var.grayscale ||
 	(fb_var.bits_per_pixel != 6 && fb_var.bits_per_pixel != 8) ||
 	fb_var.nonstd != FB_NONSTD_HAM)
@@ -35,13 +37,13 @@ static int ham_init(void)
 
     Message("Available visuals:\n");
     Message("  Monochrome\n");
-    Message("  Grayscale %d\n", gray_len);
-    Message("  Pseudocolor %d\n", idx_len);
-    if (idx_len >= 8) {
-	Message("  Truecolor %d:%d:%d:%d\n", red_bits, green_bits, blue_bits,
-		alpha_bits);
-	Message("  Directcolor %d:%d:%d:%d\n", red_bits, green_bits, blue_bits,
-		alpha_bits);
+    Message("  Grayscale %d\n", ctx->gray_len);
+    Message("  Pseudocolor %d\n", ctx->idx_len);
+    if (ctx->idx_len >= 8) {
+	Message("  Truecolor %d:%d:%d:%d\n", ctx->red_bits, ctx->green_bits,
+		ctx->blue_bits, ctx->alpha_bits);
+	Message("  Directcolor %d:%d:%d:%d\n", ctx->red_bits, ctx->green_bits,
+		ctx->blue_bits, ctx->alpha_bits);
     }
 
     return 0;
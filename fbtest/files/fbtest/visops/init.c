@@ -9,7 +9,12 @@
  *  more details.
  */
 
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "types.h"
+#include "fb.h"
 #include "visual.h"
 #include "visops.h"
 #include "util.h"
@@ -30,25 +35,23 @@ static const struct visops *all_visops[] = {
 };
 
 
-    /*
-     *  Current fbdev visual
-     */
-
-struct visops visops;
-
-
     /*
      *  Initialization
      */
 
 void visops_init(void)
 {
+    struct fb_context *ctx = fb_current;
     int i;
 
+    if (!ctx->visops &&
+	!(ctx->visops = calloc(1, sizeof(struct visops))))
+	Fatal("calloc %zu: %s\n", sizeof(struct visops), strerror(errno));
+
     for (i = 0; all_visops[i]; i++)
 	if (all_visops[i]->init()) {
-	    visops = *all_visops[i];
-	    Message("Using visops %s\n", visops.name);
+	    *ctx->visops = *all_visops[i];
+	    Message("Using visops %s\n", ctx->visops->name);
 	    return;
 	}
 
@@ -10,17 +10,16 @@
  */
 
 #include "types.h"
+#include "fb.h"
 #include "visual.h"
 #include "visops.h"
-#include "fb.h"
 #include "color.h"
 #include "clut.h"
 #include "util.h"
 
 
-static rgba_t mono_clut[2];
-
-static pixel_t mono_gray_pixel[2];
+static const pixel_t mono01_gray_pixel[2] = { 1, 0 };
+static const pixel_t mono10_gray_pixel[2] = { 0, 1 };
 
 
     /*
@@ -29,15 +28,15 @@ static pixel_t mono_gray_pixel[2];
 
 static int mono_init(void)
 {
+    struct fb_context *ctx = fb_current;
+
     switch (fb_fix.visual) {
 	case FB_VISUAL_MONO01:
-	    black_pixel = 1;
-	    white_pixel = 0;
+	    ctx->gray_pixel = mono01_gray_pixel;
 	    break;
 
 	case FB_VISUAL_MONO10:
-	    black_pixel = 0;
-	    white_pixel = 1;
+	    ctx->gray_pixel = mono10_gray_pixel;
 	    break;
 
 	default:
@@ -45,19 +44,16 @@ static int mono_init(void)
     }
 
     /* Monochrome */
-    mono_clut[black_pixel] = clut_mono[0];
-    mono_clut[white_pixel] = clut_mono[1];
+    ctx->black_pixel = ctx->gray_pixel[0];
+    ctx->white_pixel = ctx->gray_pixel[1];
 
     /* Grayscale */
-    gray_len = 2;
-    gray_bits = 1;
-    mono_gray_pixel[0] = black_pixel;
-    mono_gray_pixel[1] = white_pixel;
-    gray_pixel = mono_gray_pixel;
+    ctx->gray_len = 2;
+    ctx->gray_bits = 1;
 
     Message("Available visuals:\n");
     Message("  Monochrome\n");
-    Message("  Grayscale %d\n", gray_len);
+    Message("  Grayscale %d\n", ctx->gray_len);
 
     return 1;
 }
@@ -90,10 +86,10 @@ static pixel_t mono_match_color(const rgba_t *color, rgba_t *error)
 {
     u32 idx;
 
-    idx = color_find(color, mono_clut, 2);
+    idx = color_find(color, clut_mono, 2);
     if (error)
-	color_sub(error, color, &mono_clut[idx]);
-    return idx;
+	color_sub(error, color, &clut_mono[idx]);
+    return fb_current->gray_pixel[idx];
 }
 
 
@@ -12,57 +12,59 @@
 #include <stdlib.h>
 
 #include "types.h"
+#include "fb.h"
 #include "visual.h"
 #include "visops.h"
-#include "fb.h"
 #include "color.h"
 #include "clut.h"
 #include "util.h"
 
 
-static int pseudocolor_cmap;
-
 static void pseudocolor_update_cmap(void);
 
 
 void pseudocolor_create_tables(u32 bpp)
 {
+    struct fb_context *ctx = fb_current;
+
     /* Pseudocolor */
-    idx_bits = bpp;
-    idx_len = 1<<bpp;
-    idx_pixel = create_component_table(idx_len, fb_var.red.offset,
-				       fb_var.red.msb_right,
-				       fb_var.bits_per_pixel);
-    clut = malloc(idx_len*sizeof(rgba_t));
+    ctx->idx_bits = bpp;
+    ctx->idx_len = 1<<bpp;
+    ctx->idx_pixel = create_component_table(ctx->idx_len, fb_var.red.offset,
+					    fb_var.red.msb_right,
+					    fb_var.bits_per_pixel);
+    ctx->clut = malloc(ctx->idx_len*sizeof(rgba_t));
 
     /* Grayscale */
-    gray_bits = idx_bits;
-    gray_len = idx_len;
-    gray_pixel = idx_pixel;
+    ctx->gray_bits = ctx->idx_bits;
+    ctx->gray_len = ctx->idx_len;
+    ctx->gray_pixel = ctx->idx_pixel;
 
     /* Monochrome */
-    black_pixel = idx_pixel[0];
-    white_pixel = idx_pixel[1];
+    ctx->black_pixel = ctx->idx_pixel[0];
+    ctx->white_pixel = ctx->idx_pixel[1];
 
     /* Truecolor/Directcolor emulation */
     if (bpp >= 3) {
-	red_bits = green_bits = blue_bits = bpp/3;
+	ctx->red_bits = ctx->green_bits = ctx->blue_bits = bpp/3;
 	switch (bpp % 3) {
 	    case 2:
-		red_bits++;
+		ctx->red_bits++;
 	    case 1:
-		green_bits++;
+		ctx->green_bits++;
 	}
 
-	red_len = 1<<red_bits;
-	green_len = 1<<green_bits;
-	blue_len = 1<<blue_bits;
-	red_pixel = create_component_table(red_len, green_bits+blue_bits,
-					   fb_var.red.msb_right, bpp);
-	green_pixel = create_component_table(green_len, blue_bits,
-					   fb_var.red.msb_right, bpp);
-	blue_pixel = create_component_table(blue_len, 0, fb_var.red.msb_right,
-					   bpp);
+	ctx->red_len = 1<<ctx->red_bits;
+	ctx->green_len = 1<<ctx->green_bits;
+	ctx->blue_len = 1<<ctx->blue_bits;
+	ctx->red_pixel = create_component_table(ctx->red_len,
+						ctx->green_bits+ctx->blue_bits,
+						fb_var.red.msb_right, bpp);
+	ctx->green_pixel = create_component_table(ctx->green_len,
+						  ctx->blue_bits,
+						  fb_var.red.msb_right, bpp);
+	ctx->blue_pixel = create_component_table(ctx->blue_len, 0,
+						 fb_var.red.msb_right, bpp);
     }
 }
 
@@ -73,6 +75,8 @@ void pseudocolor_create_tables(u32 bpp)
 
 static int pseudocolor_init(void)
 {
+    struct fb_context *ctx = fb_current;
+
     if (fb_fix.visual != FB_VISUAL_PSEUDOCOLOR || fb_var.grayscale)
 	return 0;
 
@@ -80,13 +84,13 @@ static int pseudocolor_init(void)
 
     Message("Available visuals:\n");
     Message("  Monochrome\n");
-    Message("  Grayscale %d\n", gray_len);
-    Message("  Pseudocolor %d\n", idx_len);
-    if (idx_len >= 8) {
-	Message("  Truecolor %d:%d:%d:%d\n", red_bits, green_bits, blue_bits,
-		alpha_bits);
-	Message("  Directcolor %d:%d:%d:%d\n", red_bits, green_bits, blue_bits,
-		alpha_bits);
+    Message("  Grayscale %d\n", ctx->gray_len);
+    Message("  Pseudocolor %d\n", ctx->idx_len);
+    if (ctx->idx_len >= 8) {
+	Message("  Truecolor %d:%d:%d:%d\n", ctx->red_bits, ctx->green_bits,
+		ctx->blue_bits, ctx->alpha_bits);
+	Message("  Directcolor %d:%d:%d:%d\n", ctx->red_bits, ctx->green_bits,
+		ctx->blue_bits, ctx->alpha_bits);
     }
 
     return 1;
@@ -99,9 +103,12 @@ static int pseudocolor_init(void)
 
 static void pseudocolor_set_mono(void)
 {
-    clut[0].r = clut[0].g = clut[0].b = 0x0000; clut[0].a = 0xffff;
-    clut[1].r = clut[1].g = clut[1].b = 0xffff; clut[1].a = 0xffff;
-    pseudocolor_cmap = 1;
+    struct fb_context *ctx = fb_current;
+
+    ctx->clut[0].r = ctx->clut[0].g = ctx->clut[0].b = 0x0000;
+    ctx->clut[0].a = 0xffff;
+    ctx->clut[1].r = ctx->clut[1].g = ctx->clut[1].b = 0xffff;
+    ctx->clut[1].a = 0xffff;
     pseudocolor_update_cmap();
 }
 
@@ -112,8 +119,7 @@ static void pseudocolor_set_mono(void)
 
 static void pseudocolor_set_grayscale(void)
 {
-    clut_create_linear(clut, idx_len);
-    pseudocolor_cmap = 1;
+    clut_create_linear(fb_current->clut, fb_current->idx_len);
     pseudocolor_update_cmap();
 }
 
@@ -124,11 +130,13 @@ static void pseudocolor_set_grayscale(void)
 
 static int pseudocolor_set_truecolor(void)
 {
-    if (idx_len < 8)
+    struct fb_context *ctx = fb_current;
+
+    if (ctx->idx_len < 8)
 	return 0;
 
-    clut_create_rgbcube(clut, red_len, green_len, blue_len);
-    pseudocolor_cmap = 1;
+    clut_create_rgbcube(ctx->clut, ctx->red_len, ctx->green_len,
+			ctx->blue_len);
     pseudocolor_update_cmap();
     return 1;
 }
@@ -140,10 +148,8 @@ static int pseudocolor_set_truecolor(void)
 
 static int pseudocolor_set_directcolor(void)
 {
-    if (idx_len < 8)
+    if (fb_current->idx_len < 8)
 	return 0;
-
-    pseudocolor_cmap = 0;
     return 1;
 }
 
@@ -152,11 +158,9 @@ int pseudocolor_set_visual(enum visual_id id)
 {
     switch (id) {
 	case VISUAL_PSEUDOCOLOR:
-	    pseudocolor_cmap = 1;
 	    break;
 
 	case VISUAL_GENERIC:
-	    pseudocolor_cmap = 1;
 	    clut_init_nice();
 	    break;
 
@@ -187,24 +191,25 @@ int pseudocolor_set_visual(enum visual_id id)
 
 static void pseudocolor_update_cmap(void)
 {
+    struct fb_context *ctx = fb_current;
     u32 i, r, g, b;
 
-    if (pseudocolor_cmap) {
-	for (i = 0; i < idx_len; i++) {
-	    fb_cmap.red[i] = clut[i].r;
-	    fb_cmap.green[i] = clut[i].g;
-	    fb_cmap.blue[i] = clut[i].b;
+    if (ctx->visual != VISUAL_DIRECTCOLOR) {
+	for (i = 0; i < ctx->idx_len; i++) {
+	    fb_cmap.red[i] = ctx->clut[i].r;
+	    fb_cmap.green[i] = ctx->clut[i].g;
+	    fb_cmap.blue[i] = ctx->clut[i].b;
 	    if (fb_cmap.transp)
-		fb_cmap.transp[i] = clut[i].a;
+		fb_cmap.transp[i] = ctx->clut[i].a;
 	}
     } else {
 	i = 0;
-	for (r = 0; r < red_len; r++) {
-	    for (g = 0; g < green_len; g++) {
-		for (b = 0; b < blue_len; b++) {
-		    fb_cmap.red[i] = clut[r].r;
-		    fb_cmap.green[i] = clut[g].g;
-		    fb_cmap.blue[i] = clut[b].b;
+	for (r = 0; r < ctx->red_len; r++) {
+	    for (g = 0; g < ctx->green_len; g++) {
+		for (b = 0; b < ctx->blue_len; b++) {
+		    fb_cmap.red[i] = ctx->clut[r].r;
+		    fb_cmap.green[i] = ctx->clut[g].g;
+		    fb_cmap.blue[i] = ctx->clut[b].b;
 		    if (fb_cmap.transp)
 			fb_cmap.transp[i] = 0xffff;
 		    i++;
@@ -222,12 +227,13 @@ static void pseudocolor_update_cmap(void)
 
 pixel_t pseudocolor_match_color(const rgba_t *color, rgba_t *error)
 {
+    struct fb_context *ctx = fb_current;
     u32 idx;
 
-    idx = color_find(color, clut, idx_len);
+    idx = color_find(color, ctx->clut, ctx->idx_len);
     if (error)
-	color_sub(error, color, &clut[idx]);
-    return idx_pixel[idx];
+	color_sub(error, color, &ctx->clut[idx]);
+    return ctx->idx_pixel[idx];
 }
 
 const struct visops pseudocolor_visops = {
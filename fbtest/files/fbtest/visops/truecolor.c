@@ -12,29 +12,27 @@
 #include <stdlib.h>
 
 #include "types.h"
+#include "fb.h"
 #include "visual.h"
 #include "visops.h"
-#include "fb.h"
 #include "clut.h"
 #include "color.h"
 #include "util.h"
 
 
-static pixel_t *truecolor_idx_pixel;
-
-
 #define CREATE_COMPONENT_TABLE(tn, cn)					\
     do {								\
-	tn ## _bits = fb_var.cn.length;					\
-	tn ## _len = 1<<tn ## _bits;					\
-	tn ## _pixel = create_component_table(tn ## _len,		\
-					      fb_var.cn.offset,		\
-					      fb_var.cn.msb_right,	\
-					      fb_var.bits_per_pixel);	\
+	ctx->tn ## _bits = fb_var.cn.length;				\
+	ctx->tn ## _len = 1<<ctx->tn ## _bits;				\
+	ctx->tn ## _pixel = create_component_table(ctx->tn ## _len,	\
+						   fb_var.cn.offset,	\
+						   fb_var.cn.msb_right,	\
+						   fb_var.bits_per_pixel); \
     } while (0);
 
 void truecolor_create_tables(void)
 {
+    struct fb_context *ctx = fb_current;
     pixel_t *table;
     pixel_t pixel;
     u32 i;
@@ -46,26 +44,27 @@ void truecolor_create_tables(void)
     CREATE_COMPONENT_TABLE(alpha, transp);
 
     /* Grayscale */
-    gray_bits = min(min(red_bits, green_bits), blue_bits);
-    gray_len = 1<<gray_bits;
-    table = malloc(gray_len*sizeof(pixel_t));
-    for (i = 0; i < gray_len; i++) {
-	pixel = rgb_pixel(CONVERT_RANGE(i, gray_len-1, red_len-1),
-			  CONVERT_RANGE(i, gray_len-1, green_len-1),
-			  CONVERT_RANGE(i, gray_len-1, blue_len-1));
+    ctx->gray_bits = min(min(ctx->red_bits, ctx->green_bits), ctx->blue_bits);
+    ctx->gray_len = 1<<ctx->gray_bits;
+    table = malloc(ctx->gray_len*sizeof(pixel_t));
+    for (i = 0; i < ctx->gray_len; i++) {
+	pixel = rgb_pixel(CONVERT_RANGE(i, ctx->gray_len-1, ctx->red_len-1),
+			  CONVERT_RANGE(i, ctx->gray_len-1, ctx->green_len-1),
+			  CONVERT_RANGE(i, ctx->gray_len-1, ctx->blue_len-1));
 	table[i] = pixel;
     }
-    gray_pixel = table;
+    ctx->gray_pixel = table;
 
     /* Monochrome */
-    black_pixel = rgb_pixel(0, 0, 0);
-    white_pixel = rgb_pixel(red_len-1, green_len-1, blue_len-1);
+    ctx->black_pixel = rgb_pixel(0, 0, 0);
+    ctx->white_pixel = rgb_pixel(ctx->red_len-1, ctx->green_len-1,
+				 ctx->blue_len-1);
 
     /* Pseudocolor emulation */
-    idx_bits = min(red_bits+green_bits+blue_bits, 9);
-    idx_len = 1<<idx_bits;
-    idx_pixel = truecolor_idx_pixel = malloc(idx_len*sizeof(pixel_t));
-    clut = malloc(idx_len*sizeof(rgba_t));
+    ctx->idx_bits = min(ctx->red_bits+ctx->green_bits+ctx->blue_bits, 9);
+    ctx->idx_len = 1<<ctx->idx_bits;
+    ctx->idx_pixel = malloc(ctx->idx_len*sizeof(pixel_t));
+    ctx->clut = malloc(ctx->idx_len*sizeof(rgba_t));
     clut_init_nice();
 }
 
@@ -78,6 +77,8 @@ void truecolor_create_tables(void)
 
 static int truecolor_init(void)
 {
+    struct fb_context *ctx = fb_current;
+
     if (fb_fix.visual != FB_VISUAL_TRUECOLOR || fb_var.grayscale)
 	return 0;
 
@@ -85,9 +86,9 @@ static int truecolor_init(void)
 
     Message("Available visuals:\n");
     Message("  Monochrome\n");
-    Message("  Grayscale %d\n", gray_len);
-    Message("  Truecolor %d:%d:%d:%d\n", red_bits, green_bits, blue_bits,
-	    alpha_bits);
+    Message("  Grayscale %d\n", ctx->gray_len);
+    Message("  Truecolor %d:%d:%d:%d\n", ctx->red_bits, ctx->green_bits,
+	    ctx->blue_bits, ctx->alpha_bits);
 
     return 1;
 }
@@ -119,14 +120,16 @@ static int truecolor_set_visual(enum visual_id id)
 
 static void truecolor_update_cmap(void)
 {
+    struct fb_context *ctx = fb_current;
+    pixel_t *idx = (pixel_t *)ctx->idx_pixel;
     u32 i, r, g, b, a;
 
-    for (i = 0; i < idx_len; i++) {
-	r = COMPRESS_FROM_16BIT(clut[i].r, red_len-1);
-	g = COMPRESS_FROM_16BIT(clut[i].g, green_len-1);
-	b = COMPRESS_FROM_16BIT(clut[i].b, blue_len-1);
-	a = COMPRESS_FROM_16BIT(clut[i].a, alpha_len-1);
-	truecolor_idx_pixel[i] = rgba_pixel(r, g, b, a);
+    for (i = 0; i < ctx->idx_len; i++) {
+	r = COMPRESS_FROM_16BIT(ctx->clut[i].r, ctx->red_len-1);
+	g = COMPRESS_FROM_16BIT(ctx->clut[i].g, ctx->green_len-1);
+	b = COMPRESS_FROM_16BIT(ctx->clut[i].b, ctx->blue_len-1);
+	a = COMPRESS_FROM_16BIT(ctx->clut[i].a, ctx->alpha_len-1);
+	idx[i] = rgba_pixel(r, g, b, a);
     }
 }
 
@@ -137,18 +140,19 @@ static void truecolor_update_cmap(void)
 
 pixel_t truecolor_match_color(const rgba_t *color, rgba_t *error)
 {
+    struct fb_context *ctx = fb_current;
     rgba_t approx;
     u32 r, g, b, a;
 
-    r = COMPRESS_FROM_16BIT(color->r, red_len-1);
-    g = COMPRESS_FROM_16BIT(color->g, green_len-1);
-    b = COMPRESS_FROM_16BIT(color->b, blue_len-1);
-    a = COMPRESS_FROM_16BIT(color->a, alpha_len-1);
+    r = COMPRESS_FROM_16BIT(color->r, ctx->red_len-1);
+    g = COMPRESS_FROM_16BIT(color->g, ctx->green_len-1);
+    b = COMPRESS_FROM_16BIT(color->b, ctx->blue_len-1);
+    a = COMPRESS_FROM_16BIT(color->a, ctx->alpha_len-1);
     if (error) {
-	approx.r = EXPAND_TO_16BIT(r, red_len-1);
-	approx.g = EXPAND_TO_16BIT(g, green_len-1);
-	approx.b = EXPAND_TO_16BIT(b, blue_len-1);
-	approx.a = EXPAND_TO_16BIT(a, alpha_len-1);
+	approx.r = EXPAND_TO_16BIT(r, ctx->red_len-1);
+	approx.g = EXPAND_TO_16BIT(g, ctx->green_len-1);
+	approx.b = EXPAND_TO_16BIT(b, ctx->blue_len-1);
+	approx.a = EXPAND_TO_16BIT(a, ctx->alpha_len-1);
 	color_sub(error, color, &approx);
     }
     return rgba_pixel(r, g, b, a);
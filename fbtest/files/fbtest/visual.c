@@ -12,9 +12,9 @@
 #include <stdlib.h>
 
 #include "types.h"
+#include "fb.h"
 #include "visual.h"
 #include "visops.h"
-#include "fb.h"
 #include "util.h"
 
 
@@ -24,50 +24,28 @@
 
 int visual_set(enum visual_id id)
 {
-    return visops.set_visual(id);
+    int old = fb_current->visual;
+
+    /* The visual operations may look at the new visual */
+    fb_current->visual = id;
+    if (fb_current->visops->set_visual(id))
+	return 1;
+    fb_current->visual = old;
+    return 0;
 }
 
 
-    /*
-     *  Monochrome
-     */
-
-pixel_t black_pixel, white_pixel;
-
-
-    /*
-     *  Grayscale
-     */
-
-u32 gray_len, gray_bits;
-const pixel_t *gray_pixel;
-
-
     /*
      *  CLUT for Pseudocolor and Directcolor
      */
 
-u32 idx_len, idx_bits;
-const pixel_t *idx_pixel;
-rgba_t *clut;
-
-
 void clut_update(void)
 {
-    if (visops.update_cmap)
-	visops.update_cmap();
+    if (fb_current->visops->update_cmap)
+	fb_current->visops->update_cmap();
 }
 
 
-    /*
-     *  RGB(A) for Truecolor and DirectColor
-     */
-
-u32 red_len, green_len, blue_len, alpha_len;
-u32 red_bits, green_bits, blue_bits, alpha_bits;
-const pixel_t *red_pixel, *green_pixel, *blue_pixel, *alpha_pixel;
-
-
     /*
      *  Reverse the bits in a 32-bit word
      */
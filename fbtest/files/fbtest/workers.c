@@ -0,0 +1,392 @@
+/*
+ *  Worker threads
+ *
+ *  A layer on top of the frame buffer level drawing operations splits large
+ *  fill_rect(), copy_rect() and draw_pixmap() calls into horizontal bands,
+ *  which are drawn in parallel by a pool of worker threads and the calling
+ *  thread. Small operations stay on the calling thread, as waking up the
+ *  workers costs more than it gains.
+ *
+ *  Band boundaries are placed on lines starting on a cache line boundary, so
+ *  no two threads ever write to the same cache line. Overlapping copies are
+ *  done in chunks of at most the vertical distance between source and
+ *  destination, in the same order a single thread would use, and only the
+ *  lines within a chunk are done in parallel.
+ *
+ *  The workers use the context of the thread owning the pool, which is
+ *  blocked until all bands are done. The frame buffer level operations don't
+ *  modify the context, so this is safe.
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License. See the file COPYING in the main directory of this archive for
+ *  more details.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "types.h"
+#include "fb.h"
+#include "drawops.h"
+#include "workers.h"
+#include "util.h"
+
+
+#define WORKERS_MAX		16		/* threads, including the caller */
+#define WORKERS_ALIGN		64		/* bytes, cache line size */
+#define WORKERS_THRESHOLD	(256*1024)	/* bytes, to go parallel */
+#define WORKERS_MIN_BAND	(64*1024)	/* bytes per band */
+
+enum workers_op {
+    WORKERS_FILL_RECT,
+    WORKERS_COPY_RECT,
+    WORKERS_DRAW_PIXMAP,
+};
+
+struct workers_job {
+    u32 op;
+    u32 x, y, width;
+    u32 sx, sy;
+    pixel_t pixel;
+    const pixel_t *pixmap;
+    u32 bands[WORKERS_MAX+1];	/* first line of each band */
+    u32 num_bands;
+};
+
+    /*
+     *  Worker state, per frame buffer context
+     */
+
+struct workers;
+
+struct worker {
+    struct workers *workers;
+    u32 index;
+    pthread_t thread;
+};
+
+struct workers {
+    struct fb_context *ctx;
+    struct worker threads[WORKERS_MAX];	/* threads[0] is the caller */
+    u32 num_threads;		/* including the caller */
+    u32 active;			/* threads to use */
+    pthread_mutex_t lock;
+    pthread_cond_t start, done;
+    unsigned long generation;
+    u32 pending;
+    int quit;
+    struct workers_job job;
+    struct drawops below;
+};
+
+#define workers_below	(fb_current->workers->below)
+
+
+    /*
+     *  Draw one band of the current job
+     */
+
+static void workers_run_band(const struct workers_job *job, u32 i)
+{
+    u32 y0 = job->bands[i], y1 = job->bands[i+1];
+
+    switch (job->op) {
+	case WORKERS_FILL_RECT:
+	    (workers_below.fill_rect)(job->x, y0, job->width, y1-y0,
+				      job->pixel);
+	    break;
+
+	case WORKERS_COPY_RECT:
+	    (workers_below.copy_rect)(job->x, y0, job->width, y1-y0, job->sx,
+				      job->sy+y0-job->y);
+	    break;
+
+	case WORKERS_DRAW_PIXMAP:
+	    (workers_below.draw_pixmap)(job->x, y0, job->width, y1-y0,
+					job->pixmap+(y0-job->y)*job->width);
+	    break;
+    }
+}
+
+static void *workers_thread(void *data)
+{
+    struct worker *worker = data;
+    struct workers *workers = worker->workers;
+    unsigned long generation = 0;
+
+    fb_select(workers->ctx);
+    pthread_mutex_lock(&workers->lock);
+    while (1) {
+	while (generation == workers->generation && !workers->quit)
+	    pthread_cond_wait(&workers->start, &workers->lock);
+	if (workers->quit)
+	    break;
+	generation = workers->generation;
+	pthread_mutex_unlock(&workers->lock);
+
+	if (worker->index < workers->job.num_bands)
+	    workers_run_band(&workers->job, worker->index);
+
+	pthread_mutex_lock(&workers->lock);
+	if (!--workers->pending)
+	    pthread_cond_signal(&workers->done);
+    }
+    pthread_mutex_unlock(&workers->lock);
+    return NULL;
+}
+
+
+    /*
+     *  Split lines y to y+height of the job into bands of about equal size,
+     *  starting on cache line boundaries
+     *
+     *  Returns the number of bands
+     */
+
+static u32 workers_split(struct workers_job *job, u32 height, u32 bytes)
+{
+    unsigned long screen = (unsigned long)fb_current->draw_screen;
+    u32 next_line = fb_current->draw_next_line;
+    u32 n, i, g, first, line, prev;
+
+    n = min(fb_current->workers->active, bytes/WORKERS_MIN_BAND);
+    if (n < 2)
+	return 0;
+
+    /* Separate planes must be aligned, too */
+    if (fb_fix.type == FB_TYPE_PLANES &&
+	fb_current->draw_next_plane % WORKERS_ALIGN)
+	return 0;
+
+    /* Aligned lines are g lines apart, find the first one */
+    for (g = WORKERS_ALIGN; next_line % g; g /= 2)
+	;
+    g = WORKERS_ALIGN/g;
+    for (first = job->y; first < job->y+g; first++)
+	if (!((screen+first*next_line) % WORKERS_ALIGN))
+	    break;
+    if (first == job->y+g || first >= job->y+height)
+	return 0;
+
+    job->bands[0] = prev = job->y;
+    for (i = 1, job->num_bands = 0; i < n; i++) {
+	line = job->y+(u64)height*i/n;
+	line = line <= first ? first : first+(line-first+g/2)/g*g;
+	if (line <= prev || line >= job->y+height)
+	    continue;
+	job->bands[++job->num_bands] = prev = line;
+    }
+    job->bands[++job->num_bands] = job->y+height;
+    return job->num_bands;
+}
+
+
+    /*
+     *  Draw the current job in parallel
+     */
+
+static void workers_run(void)
+{
+    struct workers *workers = fb_current->workers;
+
+    pthread_mutex_lock(&workers->lock);
+    workers->pending = workers->num_threads-1;
+    workers->generation++;
+    pthread_cond_broadcast(&workers->start);
+    pthread_mutex_unlock(&workers->lock);
+
+    workers_run_band(&workers->job, 0);
+
+    pthread_mutex_lock(&workers->lock);
+    while (workers->pending)
+	pthread_cond_wait(&workers->done, &workers->lock);
+    pthread_mutex_unlock(&workers->lock);
+}
+
+
+    /*
+     *  Drawing operations layer
+     */
+
+static void workers_fill_rect(u32 x, u32 y, u32 width, u32 height,
+			      pixel_t pixel)
+{
+    struct workers_job *job = &fb_current->workers->job;
+    u32 bytes = width*height/8*fb_var.bits_per_pixel;
+
+    job->op = WORKERS_FILL_RECT;
+    job->x = x;
+    job->y = y;
+    job->width = width;
+    job->pixel = pixel;
+    if (bytes < WORKERS_THRESHOLD || !workers_split(job, height, bytes)) {
+	(workers_below.fill_rect)(x, y, width, height, pixel);
+	return;
+    }
+    workers_run();
+}
+
+static void workers_draw_pixmap(u32 x, u32 y, u32 width, u32 height,
+				const pixel_t *pixmap)
+{
+    struct workers_job *job = &fb_current->workers->job;
+    u32 bytes = width*height/8*fb_var.bits_per_pixel;
+
+    job->op = WORKERS_DRAW_PIXMAP;
+    job->x = x;
+    job->y = y;
+    job->width = width;
+    job->pixmap = pixmap;
+    if (bytes < WORKERS_THRESHOLD || !workers_split(job, height, bytes)) {
+	(workers_below.draw_pixmap)(x, y, width, height, pixmap);
+	return;
+    }
+    workers_run();
+}
+
+static void workers_copy_rect(u32 dx, u32 dy, u32 width, u32 height, u32 sx,
+			      u32 sy)
+{
+    struct workers_job *job = &fb_current->workers->job;
+    u32 line_bytes = width/8*fb_var.bits_per_pixel;
+    u32 chunk, h, y, n;
+
+    job->op = WORKERS_COPY_RECT;
+    job->x = dx;
+    job->width = width;
+    job->sx = sx;
+
+    /*
+     *  Unless source and destination overlap at different lines, all lines
+     *  are independent, else copy chunks not overlapping their own source,
+     *  starting with the one farthest away from the source
+     */
+    chunk = height;
+    if (dy != sy && dx < sx+width && sx < dx+width && dy < sy+height &&
+	sy < dy+height)
+	chunk = dy > sy ? dy-sy : sy-dy;
+    if (chunk*line_bytes < WORKERS_THRESHOLD) {
+	(workers_below.copy_rect)(dx, dy, width, height, sx, sy);
+	return;
+    }
+
+    for (n = 0; n < height; n += h) {
+	h = min(chunk, height-n);
+	y = dy > sy ? height-n-h : n;
+	job->y = dy+y;
+	job->sy = sy+y;
+	if (workers_split(job, h, h*line_bytes))
+	    workers_run();
+	else
+	    (workers_below.copy_rect)(dx, dy+y, width, h, sx, sy+y);
+    }
+}
+
+static const struct drawops workers_drawops = {
+    .name =		"workers",
+    .fill_rect =	workers_fill_rect,
+    .draw_pixmap =	workers_draw_pixmap,
+    .copy_rect =	workers_copy_rect,
+};
+
+
+    /*
+     *  Number of threads to use, including the calling thread
+     */
+
+u32 workers_get_threads(void)
+{
+    return fb_current->workers ? fb_current->workers->active : 1;
+}
+
+u32 workers_max_threads(void)
+{
+    return fb_current->workers ? fb_current->workers->num_threads : 1;
+}
+
+void workers_set_threads(u32 n)
+{
+    struct workers *workers = fb_current->workers;
+
+    if (workers)
+	workers->active = max(1U, min(n, workers->num_threads));
+}
+
+
+    /*
+     *  Initialization
+     *
+     *  The layer must be directly on top of the frame buffer level
+     *  operations, so drawops_init() must be called first, and all other
+     *  layers later
+     */
+
+void workers_init(void)
+{
+    struct workers *workers;
+    long n = Opt_Threads;
+    int i, error;
+
+    Debug("workers_init()\n");
+    if (fb_current->workers)
+	return;
+
+    if (n <= 0)
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+    n = min(n, (long)WORKERS_MAX);
+    if (n < 2)
+	return;
+
+    if (!(workers = calloc(1, sizeof(*workers))))
+	Fatal("calloc %zu: %s\n", sizeof(*workers), strerror(errno));
+    workers->ctx = fb_current;
+    pthread_mutex_init(&workers->lock, NULL);
+    pthread_cond_init(&workers->start, NULL);
+    pthread_cond_init(&workers->done, NULL);
+    fb_current->workers = workers;
+    drawops_push_layer(&workers_drawops, &workers_below);
+
+    workers->num_threads = workers->active = n;
+    for (i = 1; i < n; i++) {
+	workers->threads[i].workers = workers;
+	workers->threads[i].index = i;
+	if ((error = pthread_create(&workers->threads[i].thread, NULL,
+				    workers_thread, &workers->threads[i])))
+	    Fatal("pthread_create: %s\n", strerror(error));
+    }
+
+    Message("Using %u threads for large drawing operations\n",
+	    workers->num_threads);
+}
+
+
+    /*
+     *  Clean up
+     */
+
+void workers_cleanup(void)
+{
+    struct workers *workers = fb_current->workers;
+    u32 i;
+
+    if (!workers)
+	return;
+
+    Debug("workers_cleanup()\n");
+    pthread_mutex_lock(&workers->lock);
+    workers->quit = 1;
+    pthread_cond_broadcast(&workers->start);
+    pthread_mutex_unlock(&workers->lock);
+    for (i = 1; i < workers->num_threads; i++)
+	pthread_join(workers->threads[i].thread, NULL);
+
+    drawops_pop_layer(&workers->below);
+    fb_current->workers = NULL;
+    pthread_cond_destroy(&workers->done);
+    pthread_cond_destroy(&workers->start);
+    pthread_mutex_destroy(&workers->lock);
+    free(workers);
+}